@@ -157,6 +157,13 @@ u32 interrupts_getPrivateTimerTicksPerSecond();
 void interrupts_enableTimerGlobalInts();
 void interrupts_disableTimerGlobalInts();
 
+// Returns the latest ADC conversion.
+uint32_t interrupts_getAdcData();
+
+// Returns the current value of the private timer counter, which counts down
+// from the load value.
+u32 interrupts_getPrivateTimerCounterValue(void);
+
 void isr_function();
 
 extern volatile int interrupts_isrFlagGlobal;
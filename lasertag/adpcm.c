@@ -0,0 +1,254 @@
+#include "adpcm.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HOST_BUILD
+#include "sounds/ouch48k.adpcm.h"
+#include "sounds/ouch48k.wav.h"
+#endif
+
+#define INIT_VAL 0
+#define STEP_INDEX_MAX 88
+#define NIBBLE_SIGN 0x8
+#define NIBBLE_MASK 0xF
+#define NIBBLE_BITS 4
+#define BYTE_MASK 0xFF
+#define BYTE_BITS 8
+#define HEADER_STEP_INDEX 2 // Byte of the block header with the step index.
+
+// IMA-ADPCM quantizer step sizes and how each code moves through them.
+static const int16_t stepTable[STEP_INDEX_MAX + 1] = {
+    7,     8,     9,     10,    11,    12,    13,    14,    16,    17,
+    19,    21,    23,    25,    28,    31,    34,    37,    41,    45,
+    50,    55,    60,    66,    73,    80,    88,    97,    107,   118,
+    130,   143,   157,   173,   190,   209,   230,   253,   279,   307,
+    337,   371,   408,   449,   494,   544,   598,   658,   724,   796,
+    876,   963,   1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
+    2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,
+    5894,  6484,  7132,  7845,  8630,  9493,  10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767};
+static const int8_t indexTable[NIBBLE_MASK + 1] = {-1, -1, -1, -1, 2, 4, 6, 8,
+                                                   -1, -1, -1, -1, 2, 4, 6, 8};
+
+// Applies one 4-bit code to the predictor and step index.
+static inline void decodeNibble(int32_t *predictor, int32_t *stepIndex,
+                                uint8_t nibble) {
+  int32_t step = stepTable[*stepIndex];
+  int32_t diff = step >> 3;
+  if (nibble & 0x4)
+    diff += step;
+  if (nibble & 0x2)
+    diff += step >> 1;
+  if (nibble & 0x1)
+    diff += step >> 2;
+  int32_t p = (nibble & NIBBLE_SIGN) ? *predictor - diff : *predictor + diff;
+  *predictor = p > INT16_MAX ? INT16_MAX : p < INT16_MIN ? INT16_MIN : p;
+  int32_t i = *stepIndex + indexTable[nibble];
+  *stepIndex = i < INIT_VAL         ? INIT_VAL
+               : i > STEP_INDEX_MAX ? STEP_INDEX_MAX
+                                    : i;
+}
+
+// Starts decoding data[] from its first sample.
+void adpcm_initDecoder(adpcm_decoder_t *decoder, const uint8_t data[]) {
+  decoder->data = data;
+  decoder->index = INIT_VAL;
+  decoder->predictor = INIT_VAL;
+  decoder->stepIndex = INIT_VAL;
+}
+
+// Decodes the next count samples into out[], a block at a time.
+void adpcm_decode(adpcm_decoder_t *decoder, int16_t out[], uint32_t count) {
+  int32_t predictor = decoder->predictor;
+  int32_t stepIndex = decoder->stepIndex;
+  while (count > INIT_VAL) {
+    const uint8_t *block =
+        decoder->data +
+        decoder->index / ADPCM_SAMPLES_PER_BLOCK * ADPCM_BLOCK_SIZE;
+    uint32_t offset = decoder->index % ADPCM_SAMPLES_PER_BLOCK;
+    if (offset == INIT_VAL) { // the header holds the first sample
+      predictor = (int16_t)(block[0] | block[1] << BYTE_BITS);
+      stepIndex = block[HEADER_STEP_INDEX];
+      if (stepIndex > STEP_INDEX_MAX)
+        stepIndex = STEP_INDEX_MAX;
+      *out++ = predictor;
+      decoder->index++;
+      count--;
+      continue;
+    }
+    uint32_t remaining = ADPCM_SAMPLES_PER_BLOCK - offset;
+    uint32_t n = count < remaining ? count : remaining;
+    const uint8_t *codes = block + ADPCM_BLOCK_HEADER_SIZE;
+    for (uint32_t i = offset - 1; i < offset - 1 + n; i++) {
+      uint8_t byte = codes[i >> 1];
+      decodeNibble(&predictor, &stepIndex,
+                   (i & 1) ? byte >> NIBBLE_BITS : byte & NIBBLE_MASK);
+      *out++ = predictor;
+    }
+    decoder->index += n;
+    count -= n;
+  }
+  decoder->predictor = predictor;
+  decoder->stepIndex = stepIndex;
+}
+
+// Returns the code that takes predictor closest to sample, and applies it.
+static uint8_t encodeNibble(int32_t sample, int32_t *predictor,
+                            int32_t *stepIndex) {
+  int32_t step = stepTable[*stepIndex];
+  int32_t diff = sample - *predictor;
+  uint8_t nibble = INIT_VAL;
+  if (diff < INIT_VAL) {
+    nibble = NIBBLE_SIGN;
+    diff = -diff;
+  }
+  if (diff >= step) {
+    nibble |= 0x4;
+    diff -= step;
+  }
+  if (diff >= step >> 1) {
+    nibble |= 0x2;
+    diff -= step >> 1;
+  }
+  if (diff >= step >> 2)
+    nibble |= 0x1;
+  decodeNibble(predictor, stepIndex, nibble);
+  return nibble;
+}
+
+// Encodes count samples into out[]. The step index carries over from one
+// block to the next.
+uint32_t adpcm_encode(const int16_t in[], uint32_t count, uint8_t out[]) {
+  int32_t stepIndex = INIT_VAL;
+  uint32_t size = INIT_VAL;
+  for (uint32_t start = INIT_VAL; start < count;
+       start += ADPCM_SAMPLES_PER_BLOCK) {
+    uint8_t *block = &out[size];
+    memset(block, INIT_VAL, ADPCM_BLOCK_SIZE);
+    int32_t predictor = in[start];
+    block[0] = predictor & BYTE_MASK;
+    block[1] = (predictor >> BYTE_BITS) & BYTE_MASK;
+    block[HEADER_STEP_INDEX] = stepIndex;
+    uint8_t *codes = block + ADPCM_BLOCK_HEADER_SIZE;
+    for (uint32_t i = 1; i < ADPCM_SAMPLES_PER_BLOCK && start + i < count;
+         i++) {
+      uint8_t nibble = encodeNibble(in[start + i], &predictor, &stepIndex);
+      codes[(i - 1) >> 1] |= ((i - 1) & 1) ? nibble << NIBBLE_BITS : nibble;
+    }
+    size += ADPCM_BLOCK_SIZE;
+  }
+  return size;
+}
+
+/*******************************************************
+ ****************** Test Routines **********************
+ ******************************************************/
+
+#define TEST_SAMPLE_COUNT (3 * ADPCM_SAMPLES_PER_BLOCK + 123) // partial block
+#define TEST_AMPLITUDE 12000.0
+#define TEST_START_FREQUENCY 0.001 // cycles per sample
+#define TEST_SWEEP_RATE 0.0001     // added per sample
+#define TEST_CLICK_INDEX 700       // a step change mid-block
+#define TEST_CLICK_SIZE 8000
+#define TEST_MAX_CHUNK 7 // decode in pieces of 1..TEST_MAX_CHUNK samples
+#define TEST_MIN_SNR_DB 20.0
+#define TEST_PI 3.14159265358979323846
+
+static int16_t testIn[TEST_SAMPLE_COUNT];
+static uint8_t testEncoded[ADPCM_ENCODED_SIZE(TEST_SAMPLE_COUNT)];
+static int16_t testWhole[TEST_SAMPLE_COUNT];
+static int16_t testPieces[TEST_SAMPLE_COUNT];
+
+// Returns the signal-to-noise ratio of decoded[] against original[], in dB.
+static double testSnr(const int16_t original[], const int16_t decoded[],
+                      uint32_t count) {
+  double signal = INIT_VAL, noise = INIT_VAL;
+  for (uint32_t i = INIT_VAL; i < count; i++) {
+    double error = (double)decoded[i] - original[i];
+    signal += (double)original[i] * original[i];
+    noise += error * error;
+  }
+  return noise == INIT_VAL ? INFINITY : 10.0 * log10(signal / noise);
+}
+
+#ifdef HOST_BUILD
+static int16_t testOuch[OUCH48K_WAV_NUMBER_OF_SAMPLES];
+static int16_t testOuchDecoded[OUCH48K_WAV_NUMBER_OF_SAMPLES];
+static uint8_t testOuchEncoded[ADPCM_ENCODED_SIZE(
+    OUCH48K_WAV_NUMBER_OF_SAMPLES)];
+
+// Checks the generated ouch48k.adpcm.c against adpcm_encode() of the PCM it
+// came from, and the decoded sound against that PCM.
+static bool testAsset(bool printMessageFlag) {
+  bool success = true;
+  for (uint32_t i = INIT_VAL; i < OUCH48K_WAV_NUMBER_OF_SAMPLES; i++) {
+    testOuch[i] = (int32_t)ouch48k_wav[i] - (INT16_MAX + 1); // offset-binary
+    // clamp samples that wrapped around, as wav2adpcm.py does
+    if (i > INIT_VAL && abs(testOuch[i] - testOuch[i - 1]) > INT16_MAX)
+      testOuch[i] = testOuch[i - 1] > INIT_VAL ? INT16_MAX : INT16_MIN;
+  }
+  uint32_t size = adpcm_encode(testOuch, OUCH48K_WAV_NUMBER_OF_SAMPLES,
+                               testOuchEncoded);
+  if (OUCH48K_ADPCM_NUMBER_OF_SAMPLES != OUCH48K_WAV_NUMBER_OF_SAMPLES ||
+      size != OUCH48K_ADPCM_SIZE ||
+      memcmp(testOuchEncoded, ouch48k_adpcm, size) != INIT_VAL)
+    success = false;
+  adpcm_decoder_t decoder;
+  adpcm_initDecoder(&decoder, ouch48k_adpcm);
+  adpcm_decode(&decoder, testOuchDecoded, OUCH48K_WAV_NUMBER_OF_SAMPLES);
+  double snr =
+      testSnr(testOuch, testOuchDecoded, OUCH48K_WAV_NUMBER_OF_SAMPLES);
+  if (snr < TEST_MIN_SNR_DB)
+    success = false;
+  if (printMessageFlag)
+    printf("ouch48k: %u bytes instead of %u, SNR %.1f dB\n", size,
+           (uint32_t)(OUCH48K_WAV_NUMBER_OF_SAMPLES * sizeof(uint16_t)), snr);
+  return success;
+}
+#endif
+
+// Checks decoding in pieces against decoding at once, and the round trip
+// against the original.
+bool adpcm_runTest(bool printMessageFlag) {
+  bool success = true;
+  double phase = INIT_VAL;
+  for (uint32_t i = INIT_VAL; i < TEST_SAMPLE_COUNT; i++) {
+    phase += TEST_START_FREQUENCY + i * TEST_SWEEP_RATE;
+    testIn[i] = TEST_AMPLITUDE * sin(2 * TEST_PI * phase) +
+                (i >= TEST_CLICK_INDEX ? TEST_CLICK_SIZE : INIT_VAL);
+  }
+  uint32_t size = adpcm_encode(testIn, TEST_SAMPLE_COUNT, testEncoded);
+  if (size != sizeof(testEncoded))
+    success = false;
+  adpcm_decoder_t decoder;
+  adpcm_initDecoder(&decoder, testEncoded);
+  adpcm_decode(&decoder, testWhole, TEST_SAMPLE_COUNT);
+  adpcm_initDecoder(&decoder, testEncoded);
+  for (uint32_t i = INIT_VAL, chunk = 1; i < TEST_SAMPLE_COUNT;
+       i += chunk, chunk = chunk % TEST_MAX_CHUNK + 1) {
+    if (chunk > TEST_SAMPLE_COUNT - i)
+      chunk = TEST_SAMPLE_COUNT - i;
+    adpcm_decode(&decoder, &testPieces[i], chunk);
+  }
+  if (memcmp(testWhole, testPieces, sizeof(testWhole)) != INIT_VAL)
+    success = false;
+  // each block starts from an exact sample
+  for (uint32_t i = INIT_VAL; i < TEST_SAMPLE_COUNT;
+       i += ADPCM_SAMPLES_PER_BLOCK) {
+    if (testWhole[i] != testIn[i])
+      success = false;
+  }
+  double snr = testSnr(testIn, testWhole, TEST_SAMPLE_COUNT);
+  if (snr < TEST_MIN_SNR_DB)
+    success = false;
+  if (printMessageFlag)
+    printf("sweep: %u samples in %u bytes, SNR %.1f dB\n", TEST_SAMPLE_COUNT,
+           size, snr);
+#ifdef HOST_BUILD
+  success &= testAsset(printMessageFlag);
+#endif
+  printf("ADPCM test %s\n", success ? "passed" : "failed");
+  return success;
+}
@@ -0,0 +1,59 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef ADPCM_H_
+#define ADPCM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// IMA-ADPCM for the sound arrays: 4 bits per sample instead of 16. Samples
+// are packed in blocks of ADPCM_BLOCK_SIZE bytes, laid out like the blocks of
+// an IMA-ADPCM .wav file: a 4-byte header holding the first sample (signed,
+// little-endian) and the step index, then 2 samples per byte, low nibble
+// first. Each block can be decoded on its own, so a sound can be decoded a
+// few samples at a time as it plays. The sounds are packed by
+// sounds/packSounds.py, which encodes exactly like adpcm_encode().
+
+#define ADPCM_BLOCK_SIZE 256 // Bytes per block.
+#define ADPCM_BLOCK_HEADER_SIZE 4
+#define ADPCM_SAMPLES_PER_BLOCK                                                \
+  (2 * (ADPCM_BLOCK_SIZE - ADPCM_BLOCK_HEADER_SIZE) + 1)
+// Bytes that hold count samples.
+#define ADPCM_ENCODED_SIZE(count)                                              \
+  (((count) + ADPCM_SAMPLES_PER_BLOCK - 1) / ADPCM_SAMPLES_PER_BLOCK *         \
+   ADPCM_BLOCK_SIZE)
+
+// Where a decoder is in an array of blocks.
+typedef struct {
+  const uint8_t *data; // The blocks.
+  uint32_t index;      // Next sample to decode.
+  int32_t predictor;   // Last sample decoded.
+  int32_t stepIndex;
+} adpcm_decoder_t;
+
+// Starts decoding data[] from its first sample.
+void adpcm_initDecoder(adpcm_decoder_t *decoder, const uint8_t data[]);
+
+// Decodes the next count samples into out[]. The caller keeps track of how
+// many samples the array holds.
+void adpcm_decode(adpcm_decoder_t *decoder, int16_t out[], uint32_t count);
+
+// Encodes count samples into out[], which must hold ADPCM_ENCODED_SIZE(count)
+// bytes. The last block is padded with zeros. Returns the bytes written.
+uint32_t adpcm_encode(const int16_t in[], uint32_t count, uint8_t out[]);
+
+// Checks that decoding in pieces matches decoding at once and that encoded
+// signals come back close to the original. In the host build it also checks
+// sounds/ouch48k.adpcm.c against adpcm_encode() of the PCM array it was made
+// from. Returns true if the test passes. Prints informational messages if
+// printMessageFlag is true.
+bool adpcm_runTest(bool printMessageFlag);
+
+#endif /* ADPCM_H_ */
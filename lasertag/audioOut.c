@@ -0,0 +1,307 @@
+#include "audioOut.h"
+#include "pl330.h"
+#include "sound.h" // I2S register offsets.
+#include "soundMixer.h"
+#include "xil_io.h"
+#include "xparameters.h"
+#include <stdio.h>
+
+#ifdef ZYBO_BOARD
+#include "xil_cache.h"
+#endif
+#ifdef HOST_BUILD
+#include "host.h"
+#endif
+
+#define INIT_VAL 0
+#define AUDIO_CTRL_BASEADDR XPAR_AXI_I2S_ADI_1_S_AXI_BASEADDR
+#define DMA_BASEADDR XPAR_XDMAPS_1_BASEADDR // The secure DMA controller.
+#define DMA_CHANNEL 0
+#define DMA_PERIPHERAL 0 // DMA0_REQ, wired to the I2S TX DMA request.
+#define DMA_MANAGER_THREAD 0
+#define DMA_CHANNEL_THREAD 1
+#define I2S_TX_FIFO_RESET 0b010
+#define I2S_TX_ENABLE 0b001 // Also clears mute.
+#define I2S_DISABLE 0b000
+#define CHANNELS_PER_FRAME 2 // Left then right.
+#define BLOCK_WORDS (AUDIO_OUT_BLOCK_FRAMES * CHANNELS_PER_FRAME)
+#define BUFFER_WORDS (AUDIO_OUT_BLOCK_COUNT * BLOCK_WORDS)
+#define WORD_SIZE_LOG2 2 // 4-byte beats.
+#define BURST_WORDS 8    // One cache line per DMA request.
+#define BURSTS_PER_BLOCK (BLOCK_WORDS / BURST_WORDS)
+#define CACHE_LINE_SIZE 32
+#define PROGRAM_MAX_SIZE 64
+#define BLOCK_EVENTS ((1 << AUDIO_OUT_BLOCK_COUNT) - 1) // DMASEV n per block n.
+
+_Static_assert(BLOCK_WORDS % BURST_WORDS == 0,
+               "a block must be a whole number of bursts");
+_Static_assert(BURSTS_PER_BLOCK <= PL330_LP_MAX_ITERATIONS,
+               "a block must fit in one DMA loop");
+
+// The DMA controller sees physical addresses, which are the same as ours on
+// the board. The host model hands out 32-bit stand-ins for 64-bit pointers.
+#ifdef HOST_BUILD
+#define BUS_ADDRESS(p, bytes) host_getDmaAddress(p, bytes)
+#else
+#define BUS_ADDRESS(p, bytes) ((uint32_t)(uintptr_t)(p))
+#endif
+
+// The DMA reads memory, not the data cache.
+#ifdef ZYBO_BOARD
+#define FLUSH_TO_MEMORY(p, bytes) Xil_DCacheFlushRange((INTPTR)(p), bytes)
+#else
+#define FLUSH_TO_MEMORY(p, bytes)
+#endif
+
+// Both blocks, one after the other. Each DMA burst is a whole cache line.
+static uint32_t buffer[BUFFER_WORDS] __attribute__((aligned(CACHE_LINE_SIZE)));
+static uint8_t program[PROGRAM_MAX_SIZE];
+static uint32_t programSize;
+static bool blockSilent[AUDIO_OUT_BLOCK_COUNT]; // No voice when mixed.
+static bool running;
+static uint32_t underrunCount;
+static uint32_t blockCount;
+
+// Converts a mixed sample to a TX FIFO word.
+uint32_t audioOut_fifoWord(int16_t sample) {
+  return (uint32_t)(int32_t)sample << AUDIO_OUT_FIFO_SAMPLE_SHIFT;
+}
+
+// Appends one byte of a DMA instruction to program[].
+static void emit(uint8_t byte) { program[programSize++] = byte; }
+
+// Appends a DMAMOV of value into register (PL330_MOV_*).
+static void emitMov(uint8_t reg, uint32_t value) {
+  emit(PL330_DMAMOV);
+  emit(reg);
+  for (uint32_t i = INIT_VAL; i < sizeof(value); i++) {
+    emit(value >> (i * 8)); // little-endian
+  }
+}
+
+// Appends the end of a loop that started at loopStart.
+static void emitLoopEnd(uint8_t lpend, uint32_t loopStart) {
+  uint32_t jump = programSize - loopStart;
+  emit(lpend);
+  emit(jump);
+}
+
+// Writes the DMA program. It copies the blocks to the TX FIFO a burst at a
+// time, whenever the I2S controller asks for one, and signals event n after
+// block n. Then it starts over from the first block, forever.
+static void writeProgram() {
+  uint32_t ccr = PL330_CCR_SRC_INC | PL330_CCR_SRC_SIZE(WORD_SIZE_LOG2) |
+                 PL330_CCR_SRC_BURST_LEN(BURST_WORDS - 1) |
+                 PL330_CCR_DST_SIZE(WORD_SIZE_LOG2) |
+                 PL330_CCR_DST_BURST_LEN(BURST_WORDS - 1);
+  programSize = INIT_VAL;
+  emitMov(PL330_MOV_CCR, ccr);
+  emitMov(PL330_MOV_DAR, AUDIO_CTRL_BASEADDR + I2S_TX_FIFO_REG);
+  emit(PL330_DMAFLUSHP); // forget requests from before the FIFO was reset
+  emit(DMA_PERIPHERAL << 3);
+  uint32_t bufferStart = programSize;
+  emitMov(PL330_MOV_SAR, BUS_ADDRESS(buffer, sizeof(buffer)));
+  for (uint32_t block = INIT_VAL; block < AUDIO_OUT_BLOCK_COUNT; block++) {
+    emit(PL330_DMALP);
+    emit(BURSTS_PER_BLOCK - 1);
+    uint32_t burstStart = programSize;
+    emit(PL330_DMAWFP | PL330_WFP_BURST);
+    emit(DMA_PERIPHERAL << 3);
+    emit(PL330_DMALD | PL330_COND_BURST);
+    emit(PL330_DMASTP | PL330_COND_BURST);
+    emit(DMA_PERIPHERAL << 3);
+    emitLoopEnd(PL330_DMALPEND | PL330_LPEND_NOT_FOREVER, burstStart);
+    emit(PL330_DMASEV);
+    emit(block << 3);
+  }
+  emitLoopEnd(PL330_DMALPEND, bufferStart); // forever
+  emit(PL330_DMAEND);
+  FLUSH_TO_MEMORY(program, programSize);
+}
+
+// Has the DMA controller's debug thread run one instruction.
+static void runDebugInstruction(uint32_t inst0, uint32_t inst1) {
+  while (Xil_In32(DMA_BASEADDR + PL330_DBGSTATUS_OFFSET) &
+         PL330_DBGSTATUS_BUSY)
+    ;
+  Xil_Out32(DMA_BASEADDR + PL330_DBGINST0_OFFSET, inst0);
+  Xil_Out32(DMA_BASEADDR + PL330_DBGINST1_OFFSET, inst1);
+  Xil_Out32(DMA_BASEADDR + PL330_DBGCMD_OFFSET, PL330_DBGCMD_EXECUTE);
+}
+
+// Stops the DMA channel and clears its events.
+static void killChannel() {
+  runDebugInstruction(PL330_DBGINST0(INIT_VAL, PL330_DMAKILL, DMA_CHANNEL,
+                                     DMA_CHANNEL_THREAD),
+                      INIT_VAL);
+  Xil_Out32(DMA_BASEADDR + PL330_INTCLR_OFFSET, BLOCK_EVENTS);
+}
+
+// Mixes the next block of samples into block [block] of the buffer.
+static void mixBlock(uint32_t block) {
+  int16_t samples[AUDIO_OUT_BLOCK_FRAMES];
+  blockSilent[block] = soundMixer_activeVoiceCount() == INIT_VAL;
+  soundMixer_render(samples, AUDIO_OUT_BLOCK_FRAMES);
+  uint32_t *words = &buffer[block * BLOCK_WORDS];
+  for (uint32_t i = INIT_VAL; i < AUDIO_OUT_BLOCK_FRAMES; i++) {
+    uint32_t word = audioOut_fifoWord(samples[i]);
+    words[i * CHANNELS_PER_FRAME] = word;     // left
+    words[i * CHANNELS_PER_FRAME + 1] = word; // right
+  }
+  FLUSH_TO_MEMORY(words, BLOCK_WORDS * sizeof(uint32_t));
+  blockCount++;
+}
+
+// Must call this prior to using any audioOut functions.
+void audioOut_init() {
+  audioOut_stop();
+  writeProgram();
+  for (uint32_t i = INIT_VAL; i < AUDIO_OUT_BLOCK_COUNT; i++) {
+    blockSilent[i] = true;
+  }
+  underrunCount = blockCount = INIT_VAL;
+}
+
+// Mixes the first two blocks, enables the TX FIFO and starts the DMA.
+void audioOut_start() {
+  killChannel();
+  for (uint32_t i = INIT_VAL; i < AUDIO_OUT_BLOCK_COUNT; i++) {
+    mixBlock(i);
+  }
+  Xil_Out32(AUDIO_CTRL_BASEADDR + I2S_RESET_REG, I2S_TX_FIFO_RESET);
+  Xil_Out32(AUDIO_CTRL_BASEADDR + I2S_CTRL_REG, I2S_TX_ENABLE);
+  // events 0 and 1 latch as irqs, which stay raised until cleared
+  Xil_Out32(DMA_BASEADDR + PL330_INTEN_OFFSET,
+            Xil_In32(DMA_BASEADDR + PL330_INTEN_OFFSET) | BLOCK_EVENTS);
+  runDebugInstruction(PL330_DBGINST0(DMA_CHANNEL, PL330_DMAGO, INIT_VAL,
+                                     DMA_MANAGER_THREAD),
+                      BUS_ADDRESS(program, sizeof(program)));
+  running = true;
+}
+
+// Stops the DMA and disables the TX FIFO.
+void audioOut_stop() {
+  killChannel();
+  Xil_Out32(AUDIO_CTRL_BASEADDR + I2S_CTRL_REG, I2S_DISABLE);
+  running = false;
+}
+
+// Returns true between audioOut_start() and audioOut_stop(), unless the DMA
+// channel faulted.
+bool audioOut_isRunning() {
+  uint32_t status =
+      Xil_In32(DMA_BASEADDR + PL330_CS0_OFFSET) & PL330_CS_STATUS_MASK;
+  return running && status != PL330_CS_STOPPED && status != PL330_CS_FAULTING;
+}
+
+// Refills each block the DMA has finished since the last call.
+uint32_t audioOut_service() {
+  if (!running)
+    return INIT_VAL;
+  uint32_t done =
+      Xil_In32(DMA_BASEADDR + PL330_INTSTATUS_OFFSET) & BLOCK_EVENTS;
+  if (done == INIT_VAL)
+    return INIT_VAL;
+  // clear first so that a block that finishes while mixing isn't missed
+  Xil_Out32(DMA_BASEADDR + PL330_INTCLR_OFFSET, done);
+  if (done == BLOCK_EVENTS)
+    underrunCount++;
+  uint32_t refillCount = INIT_VAL;
+  for (uint32_t i = INIT_VAL; i < AUDIO_OUT_BLOCK_COUNT; i++) {
+    if (done & (1 << i)) {
+      mixBlock(i);
+      refillCount++;
+    }
+  }
+  return refillCount;
+}
+
+// Returns true if neither block has anything but silence in it.
+bool audioOut_isSilent() {
+  for (uint32_t i = INIT_VAL; i < AUDIO_OUT_BLOCK_COUNT; i++) {
+    if (!blockSilent[i])
+      return false;
+  }
+  return true;
+}
+
+// Returns the number of underruns since audioOut_init().
+uint32_t audioOut_getUnderrunCount() { return underrunCount; }
+
+// Returns the number of blocks mixed since audioOut_init().
+uint32_t audioOut_getBlockCount() { return blockCount; }
+
+/*******************************************************
+ ****************** Test Routines **********************
+ ******************************************************/
+
+#ifdef HOST_BUILD
+
+#define TEST_SOUND_SIZE (3 * AUDIO_OUT_BLOCK_FRAMES + 100)
+// Frames captured, well past the end of the sound.
+#define TEST_FRAME_COUNT (6 * AUDIO_OUT_BLOCK_FRAMES)
+// Frames played between audioOut_service() calls.
+#define TEST_STEP_FRAMES 64
+#define TEST_RAMP_STEP 37 // so the samples wrap and use every bit
+#define TEST_PRIORITY 1
+
+static uint16_t testSound[TEST_SOUND_SIZE];
+static int16_t testExpected[TEST_FRAME_COUNT];
+static uint32_t testCaptured[TEST_FRAME_COUNT * CHANNELS_PER_FRAME];
+
+// Plays testSound[] through the register model and checks what reaches the
+// I2S controller against soundMixer_render(), then lets the service fall
+// behind.
+bool audioOut_runTest(bool printMessageFlag) {
+  bool success = true;
+  for (uint32_t i = INIT_VAL; i < TEST_SOUND_SIZE; i++) {
+    testSound[i] = SOUND_MIXER_SAMPLE_MIDSCALE + i * TEST_RAMP_STEP;
+  }
+  soundMixer_init();
+  soundMixer_start(testSound, TEST_SOUND_SIZE, INT16_MAX, TEST_PRIORITY);
+  soundMixer_render(testExpected, TEST_FRAME_COUNT);
+  // the same sound, through the DMA
+  host_resetAudio();
+  audioOut_init();
+  soundMixer_start(testSound, TEST_SOUND_SIZE, INT16_MAX, TEST_PRIORITY);
+  audioOut_start();
+  if (!audioOut_isRunning())
+    success = false;
+  uint32_t capturedCount = INIT_VAL;
+  while (capturedCount < TEST_FRAME_COUNT * CHANNELS_PER_FRAME) {
+    host_runAudio(TEST_STEP_FRAMES);
+    audioOut_service();
+    capturedCount +=
+        host_readAudio(&testCaptured[capturedCount],
+                       TEST_FRAME_COUNT * CHANNELS_PER_FRAME - capturedCount);
+  }
+  for (uint32_t i = INIT_VAL; i < TEST_FRAME_COUNT; i++) {
+    uint32_t word = audioOut_fifoWord(testExpected[i]);
+    if (testCaptured[i * CHANNELS_PER_FRAME] != word ||
+        testCaptured[i * CHANNELS_PER_FRAME + 1] != word)
+      success = false;
+  }
+  if (!audioOut_isSilent() || host_getAudioUnderrunCount() != INIT_VAL ||
+      audioOut_getUnderrunCount() != INIT_VAL || !audioOut_isRunning())
+    success = false;
+  // servicing too late lets the DMA start a block again before its refill
+  soundMixer_start(testSound, TEST_SOUND_SIZE, INT16_MAX, TEST_PRIORITY);
+  host_runAudio(AUDIO_OUT_BLOCK_COUNT * AUDIO_OUT_BLOCK_FRAMES);
+  audioOut_service();
+  if (audioOut_getUnderrunCount() != 1 || audioOut_isSilent())
+    success = false;
+  audioOut_stop();
+  host_readAudio(testCaptured, TEST_FRAME_COUNT * CHANNELS_PER_FRAME);
+  host_runAudio(TEST_STEP_FRAMES);
+  if (audioOut_isRunning() ||
+      host_readAudio(testCaptured, TEST_FRAME_COUNT) != INIT_VAL)
+    success = false;
+  soundMixer_stopAll();
+  if (printMessageFlag)
+    printf("%u blocks mixed, %u program bytes\n", audioOut_getBlockCount(),
+           programSize);
+  printf("Audio out test %s\n", success ? "passed" : "failed");
+  return success;
+}
+
+#endif
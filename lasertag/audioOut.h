@@ -0,0 +1,71 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef AUDIOOUT_H_
+#define AUDIOOUT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// DMA back-end for sound.c. Instead of sound_tick() writing every sample into
+// the I2S TX FIFO, a channel of the PS DMA controller (PL330) copies them from
+// a ping-pong buffer of two blocks, paced by the I2S controller's DMA request
+// line, and loops over the buffer forever. Each time it finishes a block it
+// raises an event; audioOut_service() sees the event, mixes the next block
+// with soundMixer_render() into the block that just played and clears the
+// event. sound_tick() only has work to do once per block.
+// The DMA interrupt isn't connected to the GIC, so the events are polled.
+// In the host build, Xil_In32() and Xil_Out32() reach a model of the I2S
+// controller and the DMA controller (platforms/host/audioModel.c) that runs
+// the same DMA program.
+
+#define AUDIO_OUT_BLOCK_FRAMES 256 // Stereo frames per block (5.3 ms).
+#define AUDIO_OUT_BLOCK_COUNT 2    // Ping and pong.
+#define AUDIO_OUT_FIFO_SAMPLE_SHIFT 8 // 16-bit mixer samples to 24-bit words.
+
+// Must call this prior to using any audioOut functions. Stops the DMA
+// channel and writes its program.
+void audioOut_init();
+
+// Mixes the first two blocks, enables the TX FIFO and starts the DMA.
+void audioOut_start();
+
+// Stops the DMA and disables the TX FIFO.
+void audioOut_stop();
+
+// Returns true between audioOut_start() and audioOut_stop(), unless the DMA
+// channel faulted.
+bool audioOut_isRunning();
+
+// Call this more often than once per block. Refills each block the DMA has
+// finished since the last call and returns how many were refilled. If both
+// were finished, the DMA has started playing a block again before it was
+// refilled: that counts as an underrun.
+uint32_t audioOut_service();
+
+// Returns true if neither block has anything but silence in it, i.e. no voice
+// was playing when they were mixed.
+bool audioOut_isSilent();
+
+// Returns the number of underruns since audioOut_init().
+uint32_t audioOut_getUnderrunCount();
+
+// Returns the number of blocks mixed since audioOut_init().
+uint32_t audioOut_getBlockCount();
+
+// Converts a mixed sample to a TX FIFO word.
+uint32_t audioOut_fifoWord(int16_t sample);
+
+// Plays sounds through the register model and checks that what reaches the
+// I2S controller matches soundMixer_render(), and that underruns are only
+// counted when audioOut_service() is late. Host build only. Returns true if
+// the test passes. Prints informational messages if printMessageFlag is true.
+bool audioOut_runTest(bool printMessageFlag);
+
+#endif /* AUDIOOUT_H_ */
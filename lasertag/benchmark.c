@@ -0,0 +1,244 @@
+#include "benchmark.h"
+#include "detector.h"
+#include "filter.h"
+#include "isr.h"
+#include "lockoutTimer.h"
+#include <stdlib.h>
+
+#ifdef ZYBO_BOARD
+#include "xtime_l.h"
+#define TICKS_PER_SECOND COUNTS_PER_SECOND // ARM global timer
+#else
+#include <time.h>
+#define TICKS_PER_SECOND 1000000000ULL // nanoseconds
+#endif
+
+// Constants
+#define INIT_VAL 0
+#define SAMPLE_COUNT 100000 // one second of ADC samples
+#define BATCH_SIZE 250 // ADC samples drained at once, multiple of decimation
+#define BATCH_COUNT (SAMPLE_COUNT / BATCH_SIZE)
+#define MAX_CALL_COUNT (SAMPLE_COUNT / FILTER_FIR_DECIMATION_FACTOR)
+#define CALIBRATION_COUNT 1001
+#define SHOT_FREQUENCY_NUMBER 3
+#define SHOT_PERIOD 25000 // 250 ms shot, then 250 ms of noise only
+#define ADC_MIDSCALE 2048
+#define ADC_PULSE_AMPLITUDE 1024
+#define NOISE_MASK 0x3F // 64 counts peak-to-peak
+#define NOISE_OFFSET 32
+#define NOISE_SHIFT 24
+#define LCG_MULTIPLIER 1664525u // Numerical Recipes LCG, same on every host
+#define LCG_INCREMENT 1013904223u
+#define LCG_SEED 1u
+#define P50 50
+#define P99 99
+#define PERCENT 100
+#define NANOSECONDS_PER_SECOND 1e9
+
+#if FILTER_FREQUENCY_COUNT != 10
+#error "benchmark.c stage names assume 10 frequencies"
+#endif
+
+static const char *stageNames[BENCHMARK_STAGE_COUNT] = {
+    "drain", "fir",  "iir0", "iir1",  "iir2", "iir3",    "iir4", "iir5",
+    "iir6",  "iir7", "iir8", "iir9", "power", "hit", "detector"};
+
+// Raw timings, in ticks with the timer overhead already removed.
+static uint32_t callTicks[BENCHMARK_STAGE_COUNT][MAX_CALL_COUNT];
+static uint32_t callCount[BENCHMARK_STAGE_COUNT];
+static benchmark_result_t results[BENCHMARK_STAGE_COUNT];
+static uint64_t timerOverhead;
+static uint32_t noiseState;
+
+// Reads the benchmark timer.
+static inline uint64_t readTicks() {
+#ifdef ZYBO_BOARD
+  XTime now;
+  XTime_GetTime(&now);
+  return now;
+#else
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * TICKS_PER_SECOND + now.tv_nsec;
+#endif
+}
+
+// Records one call of stage that started at startTicks.
+static inline void recordCall(benchmark_stage_t stage, uint64_t startTicks) {
+  uint64_t elapsed = readTicks() - startTicks;
+  callTicks[stage][callCount[stage]++] =
+      elapsed > timerOverhead ? elapsed - timerOverhead : INIT_VAL;
+}
+
+// qsort() comparison for uint32_t.
+static int compareTicks(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *)a;
+  uint32_t y = *(const uint32_t *)b;
+  return (x > y) - (x < y);
+}
+
+// Measures the median cost of reading the timer twice.
+static void calibrateTimer() {
+  timerOverhead = INIT_VAL;
+  callCount[BENCHMARK_STAGE_DRAIN] = INIT_VAL;
+  for (uint32_t i = INIT_VAL; i < CALIBRATION_COUNT; i++) {
+    recordCall(BENCHMARK_STAGE_DRAIN, readTicks());
+  }
+  qsort(callTicks[BENCHMARK_STAGE_DRAIN], CALIBRATION_COUNT, sizeof(uint32_t),
+        compareTicks);
+  timerOverhead = callTicks[BENCHMARK_STAGE_DRAIN][CALIBRATION_COUNT / 2];
+}
+
+// Returns ADC sample n of the workload: shots on one frequency separated by
+// noise. Uses its own generator so the workload never changes.
+static uint32_t workloadSample(uint32_t n) {
+  int32_t value = ADC_MIDSCALE;
+  uint32_t tickCount = filter_frequencyTickTable[SHOT_FREQUENCY_NUMBER];
+  if ((n / SHOT_PERIOD) % 2 == INIT_VAL)
+    value += (n % tickCount) < tickCount / 2 ? ADC_PULSE_AMPLITUDE
+                                             : -ADC_PULSE_AMPLITUDE;
+  noiseState = noiseState * LCG_MULTIPLIER + LCG_INCREMENT;
+  value += (int32_t)((noiseState >> NOISE_SHIFT) & NOISE_MASK) - NOISE_OFFSET;
+  return value;
+}
+
+// Starts a pass over the workload with fresh filters and ADC buffer.
+static void startPass() {
+  bool ignoredFrequencies[FILTER_FREQUENCY_COUNT] = {false};
+  isr_init();
+  detector_init(ignoredFrequencies);
+  noiseState = LCG_SEED;
+}
+
+// Adds the next batch of the workload to the ADC buffer as the ISR would.
+static void addBatch(uint32_t batch) {
+  for (uint32_t i = INIT_VAL; i < BATCH_SIZE; i++) {
+    isr_addDataToAdcBuffer(workloadSample(batch * BATCH_SIZE + i));
+    lockoutTimer_tick(); // so that the lockout after a hit ends
+  }
+}
+
+// Times every stage of the hot path separately.
+static void runStagePass() {
+  uint32_t rawAdcValues[BATCH_SIZE];
+  double powerValues[FILTER_FREQUENCY_COUNT];
+  uint16_t frequencyNumber;
+  startPass();
+  for (uint32_t batch = INIT_VAL; batch < BATCH_COUNT; batch++) {
+    addBatch(batch);
+    uint64_t start = readTicks();
+    uint32_t count = isr_drainAdcBuffer(rawAdcValues, BATCH_SIZE);
+    recordCall(BENCHMARK_STAGE_DRAIN, start);
+    for (uint32_t i = INIT_VAL; i < count; i += FILTER_FIR_DECIMATION_FACTOR) {
+      start = readTicks();
+      for (uint32_t j = INIT_VAL; j < FILTER_FIR_DECIMATION_FACTOR; j++) {
+        filter_decimatingFirFilter(
+            detector_getScaledAdcValue(rawAdcValues[i + j]));
+      }
+      recordCall(BENCHMARK_STAGE_FIR, start);
+      for (uint16_t f = INIT_VAL; f < FILTER_FREQUENCY_COUNT; f++) {
+        start = readTicks();
+        filter_iirSosFilter(f);
+        recordCall(BENCHMARK_STAGE_IIR_0 + f, start);
+      }
+      start = readTicks();
+      for (uint16_t f = INIT_VAL; f < FILTER_FREQUENCY_COUNT; f++) {
+        powerValues[f] = filter_computePower(f, false, false);
+      }
+      recordCall(BENCHMARK_STAGE_POWER, start);
+      start = readTicks();
+      detector_checkForHit(powerValues, &frequencyNumber);
+      recordCall(BENCHMARK_STAGE_HIT, start);
+    }
+  }
+}
+
+// Times detector() as the main loop would call it.
+static void runDetectorPass() {
+  startPass();
+  for (uint32_t batch = INIT_VAL; batch < BATCH_COUNT; batch++) {
+    addBatch(batch);
+    uint64_t start = readTicks();
+    detector(false);
+    recordCall(BENCHMARK_STAGE_DETECTOR, start);
+    detector_clearHit();
+  }
+}
+
+// Turns the raw timings of a stage into its results.
+static void computeResult(benchmark_stage_t stage) {
+  uint32_t count = callCount[stage];
+  benchmark_result_t *result = &results[stage];
+  uint64_t total = INIT_VAL;
+  for (uint32_t i = INIT_VAL; i < count; i++) {
+    total += callTicks[stage][i];
+  }
+  qsort(callTicks[stage], count, sizeof(uint32_t), compareTicks);
+  result->callCount = count;
+  result->totalSeconds = (double)total / TICKS_PER_SECOND;
+  result->p50Seconds =
+      (double)callTicks[stage][(count - 1) * P50 / PERCENT] / TICKS_PER_SECOND;
+  result->p99Seconds =
+      (double)callTicks[stage][(count - 1) * P99 / PERCENT] / TICKS_PER_SECOND;
+  result->maxSeconds = (double)callTicks[stage][count - 1] / TICKS_PER_SECOND;
+}
+
+// Runs the workload and collects the results.
+void benchmark_run(bool printFlag) {
+  calibrateTimer();
+  for (uint16_t stage = INIT_VAL; stage < BENCHMARK_STAGE_COUNT; stage++) {
+    callCount[stage] = INIT_VAL;
+  }
+  runStagePass();
+  runDetectorPass();
+  for (uint16_t stage = INIT_VAL; stage < BENCHMARK_STAGE_COUNT; stage++) {
+    computeResult(stage);
+  }
+  if (!printFlag)
+    return;
+  printf("benchmark: %u ADC samples, timer overhead %.1f ns\n", SAMPLE_COUNT,
+         (double)timerOverhead / TICKS_PER_SECOND * NANOSECONDS_PER_SECOND);
+  printf("%-9s %6s %9s %9s %9s %9s %10s %12s\n", "stage", "calls", "mean ns",
+         "p50 ns", "p99 ns", "max ns", "ns/sample", "samples/s");
+  for (uint16_t stage = INIT_VAL; stage < BENCHMARK_STAGE_COUNT; stage++) {
+    const benchmark_result_t *r = &results[stage];
+    printf("%-9s %6u %9.1f %9.1f %9.1f %9.1f %10.2f %12.0f\n",
+           stageNames[stage], r->callCount,
+           r->totalSeconds / r->callCount * NANOSECONDS_PER_SECOND,
+           r->p50Seconds * NANOSECONDS_PER_SECOND,
+           r->p99Seconds * NANOSECONDS_PER_SECOND,
+           r->maxSeconds * NANOSECONDS_PER_SECOND,
+           r->totalSeconds / SAMPLE_COUNT * NANOSECONDS_PER_SECOND,
+           SAMPLE_COUNT / r->totalSeconds);
+  }
+}
+
+// Returns the results of the last benchmark_run() for a stage.
+const benchmark_result_t *benchmark_getResult(benchmark_stage_t stage) {
+  return &results[stage];
+}
+
+// Returns a short name for a stage.
+const char *benchmark_getStageName(benchmark_stage_t stage) {
+  return stageNames[stage];
+}
+
+// Returns the number of ADC samples in the workload.
+uint32_t benchmark_getSampleCount() { return SAMPLE_COUNT; }
+
+// Writes the results of the last benchmark_run() to stream as CSV.
+void benchmark_printCsv(FILE *stream) {
+  fprintf(stream, "stage,calls,mean_ns,p50_ns,p99_ns,max_ns,ns_per_sample,"
+                  "samples_per_s\n");
+  for (uint16_t stage = INIT_VAL; stage < BENCHMARK_STAGE_COUNT; stage++) {
+    const benchmark_result_t *r = &results[stage];
+    fprintf(stream, "%s,%u,%.1f,%.1f,%.1f,%.1f,%.3f,%.0f\n", stageNames[stage],
+            r->callCount,
+            r->totalSeconds / r->callCount * NANOSECONDS_PER_SECOND,
+            r->p50Seconds * NANOSECONDS_PER_SECOND,
+            r->p99Seconds * NANOSECONDS_PER_SECOND,
+            r->maxSeconds * NANOSECONDS_PER_SECOND,
+            r->totalSeconds / SAMPLE_COUNT * NANOSECONDS_PER_SECOND,
+            SAMPLE_COUNT / r->totalSeconds);
+  }
+}
@@ -0,0 +1,64 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+#include "filter.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Times each stage of the detector hot path over a fixed synthetic workload
+// (one second of shots at 100 kHz, always the same samples) so that runs can
+// be compared across builds and machines. On the board the ARM global timer
+// (XTime, half the CPU clock) is used, elsewhere the monotonic clock. The cost
+// of reading the timer is measured first and subtracted.
+// Run it with interrupts disabled; the ISR would otherwise show up in p99.
+
+// The stages that are timed. Every stage but BENCHMARK_STAGE_DETECTOR is timed
+// on its own in one pass over the workload; BENCHMARK_STAGE_DETECTOR is a
+// second pass that times detector() end to end.
+typedef enum {
+  BENCHMARK_STAGE_DRAIN, // isr_drainAdcBuffer(), per batch.
+  BENCHMARK_STAGE_FIR,   // filter_decimatingFirFilter(), per FIR output.
+  BENCHMARK_STAGE_IIR_0, // filter_iirSosFilter(), one stage per filter.
+  BENCHMARK_STAGE_POWER =
+      BENCHMARK_STAGE_IIR_0 + FILTER_FREQUENCY_COUNT, // All 10 powers.
+  BENCHMARK_STAGE_HIT,      // detector_checkForHit(): median and threshold.
+  BENCHMARK_STAGE_DETECTOR, // detector(), per batch.
+  BENCHMARK_STAGE_COUNT
+} benchmark_stage_t;
+
+typedef struct {
+  uint32_t callCount;  // Number of timed calls.
+  double totalSeconds; // Summed over all calls.
+  double p50Seconds;   // Median call.
+  double p99Seconds;   // 99th-percentile call.
+  double maxSeconds;   // Slowest call.
+} benchmark_result_t;
+
+// Runs the workload and collects the results. If printFlag is true, prints a
+// table of the results.
+void benchmark_run(bool printFlag);
+
+// Returns the results of the last benchmark_run() for a stage.
+const benchmark_result_t *benchmark_getResult(benchmark_stage_t stage);
+
+// Returns a short name for a stage, e.g. "fir" or "iir3".
+const char *benchmark_getStageName(benchmark_stage_t stage);
+
+// Returns the number of ADC samples in the workload.
+uint32_t benchmark_getSampleCount();
+
+// Writes the results of the last benchmark_run() to stream as CSV, one line
+// per stage with a header line first. Times are in nanoseconds.
+void benchmark_printCsv(FILE *stream);
+
+#endif /* BENCHMARK_H_ */
@@ -18,101 +18,311 @@ double[], double[], bool);*/
 
 #include "detector.h"
 #include "filter.h"
+#include "filterFixed.h"
+#include "filterFloat.h"
+#include "filterSdft.h"
 #include "hitLedTimer.h"
 #include "interrupts.h"
 #include "isr.h"
 #include "lockoutTimer.h"
+#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 // Constants
 #define INIT_VAL 0
 #define ADC_SCALAR 2047.5
 #define ADC_RANGE_ADJUST -1
-#define DECREMENT -1
-#define FUDGE_FACTOR 1000
 #define ADC_MAX 4096.0
 #define SCALING_MULTIPLE 2.0
 #define SCALING_OFFSET 1.0
 #define MEDIAN_INDEX 5
 #define BIGGEST_INDEX 9
 #define TEST_FACTOR 8
-#define F_FACTOR_INDEX 5
+#define F_FACTOR_INDEX 5 // default fudge-factor index
+#define FUDGE_FACTOR_COUNT 10
+// Adaptive threshold (see detector.h). The noise floors are updated once per
+// block of power updates (10 ms at 10 kHz) from the smallest power in the
+// block, so the rising edge of a shot only contributes its starting value.
+#define ADAPTIVE_BLOCK_SIZE 100
+// The floor is an exponentially weighted mean of ~1/ADAPTIVE_ALPHA blocks.
+#define ADAPTIVE_ALPHA (1.0 / 64)
+// A channel above its threshold barely moves its noise floor, so a shot can't
+// raise the floor; a lasting change (e.g. a light switched on) still gets
+// absorbed, just 64 times more slowly.
+#define ADAPTIVE_ALPHA_ABOVE_THRESHOLD (ADAPTIVE_ALPHA / 64)
+// Power updates skipped after init: the power windows start out empty.
+#define ADAPTIVE_SETTLE_COUNT FILTER_INPUT_PULSE_WIDTH
+// Blocks averaged evenly before the adaptive thresholds are used. Until then
+// the median method is used instead.
+#define ADAPTIVE_WARMUP_COUNT 32
+// The deviation used for the threshold is at least this multiple of the noise
+// floor, so a very steady channel still needs a clear jump in power to hit.
+#define ADAPTIVE_MIN_DEVIATION_RATIO 5
+// Once warmed up, a block moves the floor by at most this many deviations.
+#define ADAPTIVE_CLIP_DEVIATIONS 3
+// The hit frequency's power above its floor must also be this many times the
+// median over all frequencies, which rejects broadband bursts such as the
+// transient every bin sees as a shot starts. In a quiet arena the median
+// excess is about zero or below, so it counts as at least the median noise
+// floor.
+#define ADAPTIVE_CONTRAST 100
 #define TEN_CNT_MAX 10
 #define INCREMENT 1
+#define SORT_TEST_TRIAL_COUNT 1000 // random arrays checked by detector_runTest
+// detector_runThresholdTest: powers of 1 +/- 10% on every channel, then a shot
+// 200 times the floor on one channel, well under the default 1000 x median.
+#define THRESHOLD_TEST_NOISE_FLOOR 1.0
+#define THRESHOLD_TEST_NOISE_RATIO 0.1
+#define THRESHOLD_TEST_SHOT_POWER 200.0
+#define THRESHOLD_TEST_SHOT_CHANNEL 3
+// ...and a quiet arena at half the floor, with one channel 1% over its
+// threshold, which is still far less than the contrast asks for.
+#define THRESHOLD_TEST_QUIET_RATIO 0.5
+#define THRESHOLD_TEST_ABOVE_RATIO 1.01
+#define THRESHOLD_TEST_UPDATE_COUNT                                            \
+  (2 * (ADAPTIVE_SETTLE_COUNT + ADAPTIVE_WARMUP_COUNT * ADAPTIVE_BLOCK_SIZE))
+
+// The compare-exchange networks below are written for exactly 10 frequencies.
+#if FILTER_FREQUENCY_COUNT != 10
+#error "detector.c median and sort networks assume 10 frequencies"
+#endif
+
+// The double-precision biquad filters have block versions, so they run a frame
+// at a time.
+#if !defined(FILTER_FIXED_POINT) && !defined(FILTER_IIR_DIRECT_FORM) &&        \
+    !defined(FILTER_SINGLE_PRECISION) && !defined(DETECTOR_PER_SAMPLE)
+#define DETECTOR_FRAMES
+#endif
+#if defined(FILTER_FIXED_POINT) && defined(FILTER_SINGLE_PRECISION)
+#error "Select at most one of FILTER_FIXED_POINT and FILTER_SINGLE_PRECISION"
+#endif
+// FIR outputs a frame can produce, counting one left over from the last frame.
+#define FRAME_OUTPUT_COUNT                                                     \
+  (DETECTOR_FRAME_SIZE / FILTER_FIR_DECIMATION_FACTOR + 1)
 
 static bool hitDetected;
 static bool ignoreAllHits;
 static uint32_t maxFreq;
 static uint16_t detector_hitArray[FILTER_FREQUENCY_COUNT];
-static uint32_t fudgeFactorIndex;
-static uint8_t sortedIndexArray[FILTER_FREQUENCY_COUNT];
+static uint32_t fudgeFactorIndex = F_FACTOR_INDEX;
+// Median method: a hit needs fudgeFactors[index] times the median power.
+static const double fudgeFactors[FUDGE_FACTOR_COUNT] = {
+    10, 20, 50, 100, 500, 1000, 2000, 5000, 10000, 50000};
+// Adaptive method: a hit needs this many deviations above the noise floor.
+static const double deviationFactors[FUDGE_FACTOR_COUNT] = {3,  4,  5,  6,  8,
+                                                            10, 15, 20, 30, 50};
+static detector_threshold_t thresholdMode = DETECTOR_THRESHOLD_MEDIAN;
+static detector_thresholdStats_t thresholdStats;
+static uint32_t settleCount;     // power updates since the filters (re)started
+static uint32_t blockCount;      // power updates in the current block
+static double blockMin[FILTER_FREQUENCY_COUNT]; // smallest power in the block
 static double sortedPowerValues[FILTER_FREQUENCY_COUNT];
 static double thresholdPowerValue;
 static double unsortedPowerArray[FILTER_FREQUENCY_COUNT];
 static uint16_t ignoredFreq[FILTER_FREQUENCY_COUNT];
 static bool runningTests = false;
+static detector_backend_t backend;
 
 // state the detector_getHit function
 double detector_getHit();
 
+// Restarts the adaptive noise floors. They only track the filters' power, so
+// they restart whenever the filters do.
+static void resetThresholdStats() {
+  settleCount = INIT_VAL;
+  blockCount = INIT_VAL;
+  thresholdStats.updateCount = INIT_VAL;
+  thresholdStats.warmedUp = false;
+  for (uint8_t j = INIT_VAL; j < FILTER_FREQUENCY_COUNT; j++) {
+    thresholdStats.noiseFloor[j] = INIT_VAL;
+    thresholdStats.deviation[j] = INIT_VAL;
+    thresholdStats.threshold[j] = INIT_VAL;
+  }
+}
+
 void detector_init(bool ignoredFrequencies[]) {
+  detector_initWithBackend(ignoredFrequencies, DETECTOR_BACKEND_IIR);
+}
+
+// Same as detector_init() but selects the power backend.
+void detector_initWithBackend(bool ignoredFrequencies[],
+                              detector_backend_t detectorBackend) {
+  backend = detectorBackend;
   hitDetected = false; // sets flags and arrays to zero
   ignoreAllHits = false;
-  // initialize arrays to zero and put indices in sortedIndexArray
+  // initialize arrays to zero
   for (uint8_t j = 0; j < FILTER_FREQUENCY_COUNT; j++) {
     detector_hitArray[j] = INIT_VAL;
     ignoredFreq[j] = ignoredFrequencies[j];
-    sortedIndexArray[j] = j;
+    unsortedPowerArray[j] = INIT_VAL;
+  }
+  resetThresholdStats();
+  // the SDFT bins replace the IIR filters, so only the FIR is set up for them
+  if (backend == DETECTOR_BACKEND_SDFT) {
+    filter_initFir();
+    filterSdft_init();
+    return;
   }
   filter_init();
+#ifdef FILTER_FIXED_POINT
+  filterFixed_init();
+#endif
+#ifdef FILTER_SINGLE_PRECISION
+  filterFloat_init();
+#endif
+}
+
+// Restarts whichever filters the detector is using, e.g. after ADC samples
+// were lost.
+static void resetFilters() {
+  resetThresholdStats();
+  if (backend == DETECTOR_BACKEND_SDFT) {
+    filter_resetFir();
+    filterSdft_init();
+    return;
+  }
+  filter_reset();
+#ifdef FILTER_FIXED_POINT
+  filterFixed_init();
+#endif
+#ifdef FILTER_SINGLE_PRECISION
+  filterFloat_init();
+#endif
+}
+
+#ifndef DETECTOR_FRAMES
+// Runs the decimating FIR filter on one ADC value. Returns true if a new FIR
+// output was computed.
+static bool runFirFilter(uint32_t rawAdcValue) {
+#ifdef FILTER_FIXED_POINT
+  // integer ADC value goes straight into the fixed-point FIR
+  if (backend == DETECTOR_BACKEND_IIR)
+    return filterFixed_decimatingFirFilter(
+        filterFixed_scaleAdcValue(rawAdcValue));
+#endif
+#ifdef FILTER_SINGLE_PRECISION
+  if (backend == DETECTOR_BACKEND_IIR)
+    return filterFloat_decimatingFirFilter(
+        (float)detector_getScaledAdcValue(rawAdcValue));
+#endif
+  // scale the adc value from -1 to 1 from 0-4095, FIR only runs once per
+  // decimation factor
+  return filter_decimatingFirFilter(detector_getScaledAdcValue(rawAdcValue));
 }
 
+// Runs all IIR Filters on the newest FIR output and updates
+// unsortedPowerArray.
+static void runIirFiltersAndPower() {
+#ifdef FILTER_FIXED_POINT
+  for (uint8_t filterNum = INIT_VAL; filterNum < FILTER_FREQUENCY_COUNT;
+       filterNum++) {
+    filterFixed_iirFilter(filterNum); // IIR
+    unsortedPowerArray[filterNum] =
+        filterFixed_powerToDouble(filterFixed_computePower(filterNum, false));
+  }
+#elif defined(FILTER_SINGLE_PRECISION)
+  float iirOutputs[FILTER_FREQUENCY_COUNT];
+  filterFloat_iirFilterBank(iirOutputs); // all IIR filters in lock-step
+  for (uint8_t filterNum = INIT_VAL; filterNum < FILTER_FREQUENCY_COUNT;
+       filterNum++) {
+    unsortedPowerArray[filterNum] = filterFloat_computePower(filterNum, false);
+  }
+#else
+#ifdef FILTER_IIR_DIRECT_FORM
+  for (uint8_t filterNum = INIT_VAL; filterNum < FILTER_FREQUENCY_COUNT;
+       filterNum++) {
+    filter_iirFilter(filterNum); // IIR
+  }
+#else
+  double iirOutputs[FILTER_FREQUENCY_COUNT];
+  filter_iirFilterBank(iirOutputs); // all IIR filters in lock-step
+#endif
+  for (uint8_t filterNum = INIT_VAL; filterNum < FILTER_FREQUENCY_COUNT;
+       filterNum++) {
+    unsortedPowerArray[filterNum] = filter_computePower(
+        filterNum, false, false); // power without force compute or debug
+  }
+#endif
+}
+#endif
+
+#ifdef DETECTOR_FRAMES
+// Frame buffers, static to keep them off the stack.
+static double frameInput[DETECTOR_FRAME_SIZE];
+static double frameFirOutput[FRAME_OUTPUT_COUNT];
+static double frameIirOutput[FRAME_OUTPUT_COUNT][FILTER_FREQUENCY_COUNT];
+static double framePower[FRAME_OUTPUT_COUNT][FILTER_FREQUENCY_COUNT];
+
+// Filters a frame of ADC values and checks for a hit after each FIR output,
+// with the same results as running them through one at a time.
+static void runFrame(const uint32_t rawAdcValues[], uint32_t count) {
+  for (uint32_t i = INIT_VAL; i < count; i++) {
+    frameInput[i] = detector_getScaledAdcValue(rawAdcValues[i]);
+  }
+  uint32_t outputCount =
+      filter_decimatingFirFilterBlock(frameInput, count, frameFirOutput);
+  if (backend == DETECTOR_BACKEND_IIR) {
+    filter_iirFilterBankBlock(frameFirOutput, outputCount, frameIirOutput);
+    filter_computePowerBlock(frameIirOutput, outputCount, framePower);
+  }
+  // hit detection still looks at every decimated step
+  for (uint32_t step = INIT_VAL; step < outputCount; step++) {
+    if (backend == DETECTOR_BACKEND_SDFT) {
+      filterSdft_addNewInput(frameFirOutput[step]);
+      filterSdft_getCurrentPowerValues(unsortedPowerArray);
+    } else {
+      for (uint8_t filterNum = INIT_VAL; filterNum < FILTER_FREQUENCY_COUNT;
+           filterNum++) {
+        unsortedPowerArray[filterNum] = framePower[step][filterNum];
+      }
+    }
+    if (!lockoutTimer_running()) { // no lockoutTimer, not hit yet
+      detector_getHit();
+    }
+  }
+}
+#endif
+
 // Runs the entire detector: decimating fir-filter, iir-filters,
-// power-computation, hit-detection. if interruptsNotEnabled = true, interrupts
-// are not running. If interruptsNotEnabled = true you can pop values from the
-// ADC queue without disabling interrupts. If interruptsNotEnabled = false, do
-// the following:
-// 1. disable interrupts.
-// 2. pop the value from the ADC queue.
-// 3. re-enable interrupts if interruptsNotEnabled was true.
+// power-computation, hit-detection. adcBuffer is a single-producer/
+// single-consumer ring, so values are drained in batches without disabling
+// interrupts and interruptsCurrentlyEnabled no longer changes anything.
+// Unless DETECTOR_PER_SAMPLE is defined, each batch is filtered as a frame.
 // if ignoreSelf == true, ignore hits that are detected on your frequency.
 // Your frequency is simply the frequency indicated by the slide switches
 void detector(bool interruptsCurrentlyEnabled) {
+  // under ISR_OVERRUN_RESYNC, restart the filters rather than filter the gap
+  if (isr_resyncAfterOverrun())
+    resetFilters();
+  // only process what was there on entry so a busy ISR can't keep us here
   uint32_t elementCount = isr_adcBufferElementCount();
-  uint32_t rawAdcValue = INIT_VAL;
-  double scaledAdcValue = INIT_VAL;
-  static uint8_t runCount = INIT_VAL;
-  // iterate through all element counts of circular buffer
-  for (uint32_t i = INIT_VAL; i < elementCount; i++) {
-    // repeats for all elements
-    if (interruptsCurrentlyEnabled) // disables interrupts to safely manipulate
-                                    // adcBuffer
-      interrupts_disableArmInts();
-    rawAdcValue = isr_removeDataFromAdcBuffer(); // pop value
-    // check if interrupts are enabled
-    if (interruptsCurrentlyEnabled) // reinstates interrupts if going before
-      interrupts_enableArmInts();
-    // scale the adc value from -1 to 1 from 0-4095
-    scaledAdcValue = detector_getScaledAdcValue(rawAdcValue);
-    // printf("%d %f\n", rawAdcValue, scaledAdcValue);
-    filter_addNewInput(scaledAdcValue); // adds to filter process
-    runCount++;                         // increment for another value added
-    // reached decimation value, runs all filters and power
-    if (runCount >= FILTER_FIR_DECIMATION_FACTOR) {
-      runCount = INIT_VAL; // resets for next set of 10
-      filter_firFilter();  // FIR filter
-      // runs all IIR Filters and Power computations
-      for (uint8_t filterNum = INIT_VAL; filterNum < FILTER_FREQUENCY_COUNT;
-           filterNum++) {
-        filter_iirFilter(filterNum); // IIR
-        unsortedPowerArray[filterNum] = filter_computePower(
-            filterNum, false, false); // power without force compute or debug
-      }
-      // Run hit detection
-      if (!lockoutTimer_running()) { // no lockoutTimer, not hit yet
-        detector_getHit();
+  uint32_t rawAdcValues[DETECTOR_FRAME_SIZE];
+  while (elementCount > INIT_VAL) {
+    uint32_t batchCount = isr_drainAdcBuffer(
+        rawAdcValues, elementCount < DETECTOR_FRAME_SIZE
+                          ? elementCount
+                          : DETECTOR_FRAME_SIZE); // pop a batch of values
+    elementCount -= batchCount;
+#ifdef DETECTOR_FRAMES
+    runFrame(rawAdcValues, batchCount);
+#else
+    // iterate through the values drained from the circular buffer
+    for (uint32_t i = INIT_VAL; i < batchCount; i++) {
+      if (runFirFilter(rawAdcValues[i])) {
+        if (backend == DETECTOR_BACKEND_SDFT) {
+          filterSdft_addNewInput(filter_getFirOutput());
+          filterSdft_getCurrentPowerValues(unsortedPowerArray);
+        } else {
+          runIirFiltersAndPower();
+        }
+        // Run hit detection
+        if (!lockoutTimer_running()) { // no lockoutTimer, not hit yet
+          detector_getHit();
+        }
       }
     }
+#endif
   }
 }
 
@@ -143,9 +353,111 @@ void detector_getHitCounts(detector_hitCount_t hitArray[]) {
   }
 }
 
+// Copies the power values the detector last used for hit detection.
+void detector_getCurrentPowerValues(double powerValues[]) {
+  for (uint8_t filterNum = INIT_VAL; filterNum < FILTER_FREQUENCY_COUNT;
+       filterNum++) {
+    powerValues[filterNum] = unsortedPowerArray[filterNum];
+  }
+}
+
 // Allows the fudge-factor index to be set externally from the detector.
-// The actual values for fudge-factors is stored in an array found in detector.c
-void detector_setFudgeFactorIndex(uint32_t index) { fudgeFactorIndex = index; }
+// Indexes fudgeFactors[] or deviationFactors[], clamped to the last entry.
+void detector_setFudgeFactorIndex(uint32_t index) {
+  fudgeFactorIndex =
+      index < FUDGE_FACTOR_COUNT ? index : FUDGE_FACTOR_COUNT - INCREMENT;
+}
+
+// Selects how detector_checkForHit() computes its thresholds.
+void detector_setThresholdMode(detector_threshold_t mode) {
+  thresholdMode = mode;
+}
+
+// Copies the adaptive threshold state into stats.
+void detector_getThresholdStats(detector_thresholdStats_t *stats) {
+  *stats = thresholdStats;
+  stats->mode = thresholdMode;
+}
+
+// Prints the adaptive threshold state, one line per frequency.
+void detector_printThresholdStats() {
+  printf("threshold mode %s, %u noise floor updates%s\n",
+         thresholdMode == DETECTOR_THRESHOLD_ADAPTIVE ? "adaptive" : "median",
+         thresholdStats.updateCount,
+         thresholdStats.warmedUp ? "" : " (warming up)");
+  for (uint8_t j = INIT_VAL; j < FILTER_FREQUENCY_COUNT; j++) {
+    printf("  frequency %u: noise floor %.6e deviation %.6e threshold %.6e\n",
+           j, thresholdStats.noiseFloor[j], thresholdStats.deviation[j],
+           thresholdStats.threshold[j]);
+  }
+}
+
+// Compare-exchange: leaves the smaller value in v[a] and the larger in v[b].
+// Written as selects so the compiler can use conditional moves, not branches.
+static inline void compareExchange(double v[], uint8_t a, uint8_t b) {
+  double lo = v[a] < v[b] ? v[a] : v[b];
+  double hi = v[a] < v[b] ? v[b] : v[a];
+  v[a] = lo;
+  v[b] = hi;
+}
+
+// Half of a compare-exchange, for when only the smaller value is used later.
+static inline void keepMin(double v[], uint8_t a, uint8_t b) {
+  v[a] = v[a] < v[b] ? v[a] : v[b];
+}
+
+// Half of a compare-exchange, for when only the larger value is used later.
+static inline void keepMax(double v[], uint8_t a, uint8_t b) {
+  v[b] = v[a] < v[b] ? v[b] : v[a];
+}
+
+// Returns the value at MEDIAN_INDEX of powerValues[] if it were sorted. This
+// is the sorting network used by detector_sort() with every compare that
+// can't reach position MEDIAN_INDEX removed, and with compares whose other
+// output is never read cut in half: 26 compares, no data-dependent branches.
+static double medianPowerValue(double powerValues[]) {
+  double v[FILTER_FREQUENCY_COUNT];
+  for (uint8_t i = INIT_VAL; i < FILTER_FREQUENCY_COUNT; i++) {
+    v[i] = powerValues[i];
+  }
+  compareExchange(v, 0, 8);
+  compareExchange(v, 1, 9);
+  compareExchange(v, 2, 7);
+  compareExchange(v, 3, 5);
+  compareExchange(v, 4, 6);
+  compareExchange(v, 0, 2);
+  compareExchange(v, 1, 4);
+  compareExchange(v, 5, 8);
+  compareExchange(v, 7, 9);
+  compareExchange(v, 0, 3);
+  compareExchange(v, 2, 4);
+  compareExchange(v, 5, 7);
+  compareExchange(v, 6, 9);
+  keepMax(v, 0, 1);
+  compareExchange(v, 3, 6);
+  keepMin(v, 8, 9);
+  keepMax(v, 1, 5);
+  keepMax(v, 2, 3);
+  compareExchange(v, 4, 8);
+  compareExchange(v, 6, 7);
+  keepMax(v, 3, 5);
+  compareExchange(v, 4, 6);
+  keepMin(v, 7, 8);
+  keepMax(v, 4, 5);
+  keepMin(v, 6, 7);
+  keepMin(v, 5, 6);
+  return v[MEDIAN_INDEX];
+}
+
+// Returns the frequency number with the most power. On a tie the highest
+// frequency number wins, as it did with the old insertion sort.
+static uint8_t maxPowerIndex(double powerValues[]) {
+  uint8_t maxIndex = INIT_VAL;
+  for (uint8_t i = INIT_VAL + 1; i < FILTER_FREQUENCY_COUNT; i++) {
+    maxIndex = powerValues[i] >= powerValues[maxIndex] ? i : maxIndex;
+  }
+  return maxIndex;
+}
 
 // This function sorts the inputs in the unsortedArray and
 // copies the sorted results into the sortedArray. It also
@@ -159,35 +471,125 @@ void detector_setFudgeFactorIndex(uint32_t index) { fudgeFactorIndex = index; }
 // array arguments is 10.
 detector_status_t detector_sort(uint32_t *maxPowerFreqNo,
                                 double unsortedValues[],
-                                double sortedValues[]) {}
-// helper function that swaps any array values put into it
-void swap(uint8_t swapValues[], uint8_t i, uint8_t j) {
-  uint8_t temp = swapValues[i];
-  swapValues[i] = swapValues[j];
-  swapValues[j] = temp;
+                                double sortedValues[]) {
+  for (uint8_t i = INIT_VAL; i < FILTER_FREQUENCY_COUNT; i++) {
+    sortedValues[i] = unsortedValues[i];
+  }
+  // optimal 10-input sorting network: 29 compare-exchanges, 8 layers
+  compareExchange(sortedValues, 0, 8);
+  compareExchange(sortedValues, 1, 9);
+  compareExchange(sortedValues, 2, 7);
+  compareExchange(sortedValues, 3, 5);
+  compareExchange(sortedValues, 4, 6);
+  compareExchange(sortedValues, 0, 2);
+  compareExchange(sortedValues, 1, 4);
+  compareExchange(sortedValues, 5, 8);
+  compareExchange(sortedValues, 7, 9);
+  compareExchange(sortedValues, 0, 3);
+  compareExchange(sortedValues, 2, 4);
+  compareExchange(sortedValues, 5, 7);
+  compareExchange(sortedValues, 6, 9);
+  compareExchange(sortedValues, 0, 1);
+  compareExchange(sortedValues, 3, 6);
+  compareExchange(sortedValues, 8, 9);
+  compareExchange(sortedValues, 1, 5);
+  compareExchange(sortedValues, 2, 3);
+  compareExchange(sortedValues, 4, 8);
+  compareExchange(sortedValues, 6, 7);
+  compareExchange(sortedValues, 1, 2);
+  compareExchange(sortedValues, 3, 5);
+  compareExchange(sortedValues, 4, 6);
+  compareExchange(sortedValues, 7, 8);
+  compareExchange(sortedValues, 2, 3);
+  compareExchange(sortedValues, 4, 5);
+  compareExchange(sortedValues, 6, 7);
+  compareExchange(sortedValues, 3, 4);
+  compareExchange(sortedValues, 5, 6);
+  *maxPowerFreqNo = maxPowerIndex(unsortedValues);
+  return DETECTOR_STATUS_OK;
 }
 
-// insertion sort algorithim helper function
-void sort() {
-  uint8_t i = 0;
-  uint8_t j = 0;
-  double temp = 0;
-  // populate index array
-  for (uint8_t m = 0; m < FILTER_FREQUENCY_COUNT; m++) {
-    sortedIndexArray[m] = m;
+// Adaptive hit test on the power of each frequency above its noise floor, so
+// a bright but steady channel doesn't hide a shot on another one. The
+// frequency with the most excess power hits if it is above its own threshold
+// and stands out from the median excess. Sets *frequencyNumber to it.
+static bool checkForAdaptiveHit(const double powerValues[],
+                                uint16_t *frequencyNumber) {
+  double excess[FILTER_FREQUENCY_COUNT];
+  for (uint8_t j = INIT_VAL; j < FILTER_FREQUENCY_COUNT; j++) {
+    excess[j] = powerValues[j] - thresholdStats.noiseFloor[j];
   }
-  // iterate through length of array
-  while (i < FILTER_FREQUENCY_COUNT) {
-    j = i;
-    // compare values in sort
-    while ((j > 0) && (unsortedPowerArray[sortedIndexArray[j + DECREMENT]] >
-                       unsortedPowerArray[sortedIndexArray[j]])) {
-      temp = sortedIndexArray[j + DECREMENT];
-      sortedIndexArray[j + DECREMENT] = sortedIndexArray[j];
-      sortedIndexArray[j] = temp;
-      --j;
+  uint8_t f = maxPowerIndex(excess);
+  *frequencyNumber = f;
+  double medianExcess = medianPowerValue(excess);
+  double medianFloor = medianPowerValue(thresholdStats.noiseFloor);
+  double contrastBase = medianExcess > medianFloor ? medianExcess : medianFloor;
+  return powerValues[f] > thresholdStats.threshold[f] &&
+         excess[f] > ADAPTIVE_CONTRAST * contrastBase && !ignoredFreq[f];
+}
+
+// Applies the detector's hit test to powerValues[] without recording a hit.
+// Returns true if there is a hit and sets *frequencyNumber to the frequency
+// with the most power (adaptive mode: the one furthest above its threshold).
+bool detector_checkForHit(double powerValues[], uint16_t *frequencyNumber) {
+  *frequencyNumber = maxPowerIndex(powerValues);
+  if (thresholdMode == DETECTOR_THRESHOLD_ADAPTIVE && thresholdStats.warmedUp)
+    return checkForAdaptiveHit(powerValues, frequencyNumber);
+  thresholdPowerValue =
+      fudgeFactors[fudgeFactorIndex] * medianPowerValue(powerValues);
+  // check if biggest index is greater than threshold
+  return powerValues[*frequencyNumber] > thresholdPowerValue &&
+         !ignoredFreq[*frequencyNumber];
+}
+
+// Returns the deviation the threshold of frequency j is based on: the measured
+// one, but at least ADAPTIVE_MIN_DEVIATION_RATIO of the noise floor.
+static double thresholdDeviation(uint8_t j) {
+  double minDeviation =
+      ADAPTIVE_MIN_DEVIATION_RATIO * thresholdStats.noiseFloor[j];
+  double deviation = thresholdStats.deviation[j];
+  return deviation > minDeviation ? deviation : minDeviation;
+}
+
+// Tracks the smallest of powerValues[] over each block, then folds the block
+// minimums into the per-frequency noise floors (exponentially weighted mean
+// and variance) and recomputes the adaptive thresholds.
+static void updateNoiseFloors(const double powerValues[]) {
+  if (settleCount < ADAPTIVE_SETTLE_COUNT) {
+    settleCount++;
+    return;
+  }
+  for (uint8_t j = INIT_VAL; j < FILTER_FREQUENCY_COUNT; j++) {
+    if (blockCount == INIT_VAL || powerValues[j] < blockMin[j])
+      blockMin[j] = powerValues[j];
+  }
+  if (++blockCount < ADAPTIVE_BLOCK_SIZE)
+    return;
+  blockCount = INIT_VAL;
+  thresholdStats.updateCount++;
+  // average the first blocks evenly so the floors converge quickly
+  double alpha = ADAPTIVE_ALPHA;
+  if (thresholdStats.updateCount < ADAPTIVE_WARMUP_COUNT)
+    alpha = 1.0 / thresholdStats.updateCount;
+  else
+    thresholdStats.warmedUp = true;
+  double k = deviationFactors[fudgeFactorIndex];
+  for (uint8_t j = INIT_VAL; j < FILTER_FREQUENCY_COUNT; j++) {
+    double a =
+        thresholdStats.warmedUp && blockMin[j] > thresholdStats.threshold[j]
+            ? ADAPTIVE_ALPHA_ABOVE_THRESHOLD
+            : alpha;
+    double diff = blockMin[j] - thresholdStats.noiseFloor[j];
+    if (thresholdStats.warmedUp) {
+      double limit = ADAPTIVE_CLIP_DEVIATIONS * thresholdDeviation(j);
+      diff = diff > limit ? limit : diff < -limit ? -limit : diff;
     }
-    ++i;
+    double variance = thresholdStats.deviation[j] * thresholdStats.deviation[j];
+    thresholdStats.noiseFloor[j] += a * diff;
+    variance = (1 - a) * (variance + a * diff * diff);
+    thresholdStats.deviation[j] = sqrt(variance);
+    thresholdStats.threshold[j] =
+        thresholdStats.noiseFloor[j] + k * thresholdDeviation(j);
   }
 }
 
@@ -195,17 +597,17 @@ void sort() {
 // return index of highest power
 double detector_getHit() {
   // exit if all hits are ignored --> ****invincibility****
-  if (ignoreAllHits)
+  if (ignoreAllHits) {
+    updateNoiseFloors(unsortedPowerArray);
     return 0;
-  sort();
-  thresholdPowerValue =
-      FUDGE_FACTOR * unsortedPowerArray[sortedIndexArray[MEDIAN_INDEX]];
-  // check if biggest index is greater than threshold
-  if (unsortedPowerArray[sortedIndexArray[BIGGEST_INDEX]] >
-          thresholdPowerValue &&
-      !ignoredFreq[sortedIndexArray[BIGGEST_INDEX]]) {
+  }
+  uint16_t frequencyNumber;
+  bool hit = detector_checkForHit(unsortedPowerArray, &frequencyNumber);
+  // test against the old floors, then let this update in
+  updateNoiseFloors(unsortedPowerArray);
+  if (hit) {
     hitDetected = true;
-    maxFreq = sortedIndexArray[BIGGEST_INDEX];
+    maxFreq = frequencyNumber;
     detector_hitArray[maxFreq] += 1; // increases hitCount for the max Freq
   }
   // if there is a hit detected then start hitLedTimer and lockoutTimer
@@ -240,14 +642,15 @@ void detector_runTest() {
   unsortedPowerArray[3] = 78.5;
   unsortedPowerArray[4] = 9.2;
   unsortedPowerArray[5] = 0;
-  unsortedPowerArray[6] = 111 * FUDGE_FACTOR + 1; // hit on channel 6
+  unsortedPowerArray[6] =
+      111 * fudgeFactors[F_FACTOR_INDEX] + 1; // hit on channel 6
   unsortedPowerArray[7] = 8000;
   unsortedPowerArray[8] = 900;
   unsortedPowerArray[9] = 592;
 
   detector_getHit();
   printf("%f\n", thresholdPowerValue);
-  printf("%f\n", unsortedPowerArray[sortedIndexArray[BIGGEST_INDEX]]);
+  printf("%f\n", unsortedPowerArray[maxFreq]);
 
   // loop starts at highest power, if above threshold and not ignored, then
   // becomes hit if hit detected print maxFreq
@@ -277,6 +680,101 @@ void detector_runTest() {
     printf("Hit on channel %d\n", maxFreq);
   else
     printf("No Hit\n");
+  detector_clearHit();
+
+  // check the median network and max search against the detector_sort() hook
+  bool sortTestPassed = true;
+  for (uint32_t trial = INIT_VAL; trial < SORT_TEST_TRIAL_COUNT; trial++) {
+    for (uint8_t i = INIT_VAL; i < FILTER_FREQUENCY_COUNT; i++) {
+      // small range so that ties come up
+      unsortedPowerArray[i] = rand() % (2 * FILTER_FREQUENCY_COUNT);
+    }
+    uint32_t sortedMaxIndex;
+    detector_sort(&sortedMaxIndex, unsortedPowerArray, sortedPowerValues);
+    for (uint8_t i = INIT_VAL + 1; i < FILTER_FREQUENCY_COUNT; i++) {
+      if (sortedPowerValues[i - 1] > sortedPowerValues[i])
+        sortTestPassed = false;
+    }
+    if (medianPowerValue(unsortedPowerArray) !=
+            sortedPowerValues[MEDIAN_INDEX] ||
+        unsortedPowerArray[maxPowerIndex(unsortedPowerArray)] !=
+            sortedPowerValues[BIGGEST_INDEX] ||
+        maxPowerIndex(unsortedPowerArray) != sortedMaxIndex)
+      sortTestPassed = false;
+  }
+  printf("Median and sort network test %s\n",
+         sortTestPassed ? "passed" : "failed");
+}
+
+// Sets every power to the noise floor plus uniform noise.
+static void setNoisyPowerValues() {
+  for (uint8_t j = INIT_VAL; j < FILTER_FREQUENCY_COUNT; j++) {
+    double noise = (2.0 * rand() / RAND_MAX - 1) * THRESHOLD_TEST_NOISE_RATIO;
+    unsortedPowerArray[j] = THRESHOLD_TEST_NOISE_FLOOR * (1 + noise);
+  }
+}
+
+// Checks the adaptive threshold against a steady noise floor and a shot that
+// the median method misses.
+bool detector_runThresholdTest(bool printMessageFlag) {
+  bool channels[FILTER_FREQUENCY_COUNT] = {false};
+  detector_init(channels);
+  detector_setThresholdMode(DETECTOR_THRESHOLD_ADAPTIVE);
+  bool success = true;
+  // warm up on noise alone, which must never hit
+  uint32_t noiseHitCount = INIT_VAL;
+  for (uint32_t i = INIT_VAL; i < THRESHOLD_TEST_UPDATE_COUNT; i++) {
+    setNoisyPowerValues();
+    detector_getHit();
+    if (detector_hitDetected())
+      noiseHitCount++;
+    detector_clearHit();
+  }
+  detector_thresholdStats_t stats;
+  detector_getThresholdStats(&stats);
+  if (noiseHitCount != INIT_VAL || !stats.warmedUp)
+    success = false;
+  for (uint8_t j = INIT_VAL; j < FILTER_FREQUENCY_COUNT; j++) {
+    // block minimums sit near the bottom of the noise
+    if (fabs(stats.noiseFloor[j] - THRESHOLD_TEST_NOISE_FLOOR) >
+        THRESHOLD_TEST_NOISE_RATIO * THRESHOLD_TEST_NOISE_FLOOR)
+      success = false;
+  }
+  // the shot: missed by the median method, caught by the adaptive one
+  setNoisyPowerValues();
+  unsortedPowerArray[THRESHOLD_TEST_SHOT_CHANNEL] = THRESHOLD_TEST_SHOT_POWER;
+  uint16_t frequencyNumber;
+  detector_setThresholdMode(DETECTOR_THRESHOLD_MEDIAN);
+  if (detector_checkForHit(unsortedPowerArray, &frequencyNumber))
+    success = false;
+  detector_setThresholdMode(DETECTOR_THRESHOLD_ADAPTIVE);
+  ignoredFreq[THRESHOLD_TEST_SHOT_CHANNEL] = true;
+  if (detector_checkForHit(unsortedPowerArray, &frequencyNumber))
+    success = false;
+  ignoredFreq[THRESHOLD_TEST_SHOT_CHANNEL] = false;
+  detector_getHit();
+  if (!detector_hitDetected() ||
+      detector_getFrequencyNumberOfLastHit() != THRESHOLD_TEST_SHOT_CHANNEL)
+    success = false;
+  detector_clearHit();
+  // a quiet arena: every channel below its floor, so the median excess is
+  // negative, and one channel just over its threshold, far from the contrast
+  for (uint8_t j = INIT_VAL; j < FILTER_FREQUENCY_COUNT; j++) {
+    unsortedPowerArray[j] =
+        THRESHOLD_TEST_QUIET_RATIO * thresholdStats.noiseFloor[j];
+  }
+  unsortedPowerArray[THRESHOLD_TEST_SHOT_CHANNEL] =
+      THRESHOLD_TEST_ABOVE_RATIO *
+      thresholdStats.threshold[THRESHOLD_TEST_SHOT_CHANNEL];
+  if (detector_checkForHit(unsortedPowerArray, &frequencyNumber))
+    success = false;
+  if (printMessageFlag) {
+    printf("%u noise-only hits\n", noiseHitCount);
+    detector_printThresholdStats();
+  }
+  detector_setThresholdMode(DETECTOR_THRESHOLD_MEDIAN);
+  printf("Adaptive threshold test %s\n", success ? "passed" : "failed");
+  return success;
 }
 
 // Returns 0 if passes, non-zero otherwise.
@@ -11,11 +11,20 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #ifndef DETECTOR_H_
 #define DETECTOR_H_
 
+#include "filter.h"
 #include "isr.h"
 #include "queue.h"
 #include <stdbool.h>
 #include <stdint.h>
 
+// Uncomment to have detector() run the filters one ADC value at a time instead
+// of a frame (DETECTOR_FRAME_SIZE values) at a time. The fixed-point and direct
+// form filters (see filter.h) always run one value at a time.
+//#define DETECTOR_PER_SAMPLE
+
+// ADC values that detector() filters at once.
+#define DETECTOR_FRAME_SIZE 400
+
 // Student testing functions will return these status values.
 typedef uint32_t detector_status_t;   // Used to return status from tests.
 #define DETECTOR_STATUS_OK 0          // Everything is A-OK.
@@ -33,21 +42,35 @@ typedef uint16_t detector_hitCount_t;
 typedef detector_status_t (*sortTestFunctionPtr)(bool, uint32_t, uint32_t,
                                                  double[], double[], bool);
 
+// How the detector computes the power for each frequency.
+typedef enum {
+  DETECTOR_BACKEND_IIR, // IIR filter bank + running power (filter.c).
+  DETECTOR_BACKEND_SDFT // One sliding-DFT bin per frequency (filterSdft.c).
+} detector_backend_t;
+
 // Always have to init things.
 // bool array is indexed by frequency number, array location set for true to
 // ignore, false otherwise. This way you can ignore multiple frequencies.
+// Uses the IIR backend.
 void detector_init(bool ignoredFrequencies[]);
 
+// Same as detector_init() but selects the power backend. With
+// DETECTOR_BACKEND_SDFT only the FIR filter is set up (filter_initFir()): the
+// IIR queues are not allocated and the IIR power windows are not filled or
+// updated. Those power windows are static arrays, though, so they still take
+// their space in the image (about 80 KB in filter.c) whichever backend runs.
+void detector_initWithBackend(bool ignoredFrequencies[],
+                              detector_backend_t backend);
+
 // Runs the entire detector: decimating fir-filter, iir-filters,
-// power-computation, hit-detection. if interruptsNotEnabled = true, interrupts
-// are not running. If interruptsNotEnabled = true you can pop values from the
-// ADC queue without disabling interrupts. If interruptsNotEnabled = false, do
-// the following:
-// 1. disable interrupts.
-// 2. pop the value from the ADC queue.
-// 3. re-enable interrupts if interruptsNotEnabled was true.
+// power-computation, hit-detection. The ADC buffer is a lock-free
+// single-producer/single-consumer ring that is drained in batches, so
+// interruptsCurrentlyEnabled is accepted for compatibility but interrupts are
+// never disabled.
 // if ignoreSelf == true, ignore hits that are detected on your frequency.
 // Your frequency is simply the frequency indicated by the slide switches
+// If ADC samples were lost and the overrun policy is ISR_OVERRUN_RESYNC (see
+// isr.h), the filters are restarted before anything else.
 void detector(bool interruptsCurrentlyEnabled);
 
 // Returns true if a hit was detected.
@@ -69,10 +92,48 @@ void detector_ignoreAllHits(bool flagValue);
 // using a for-loop.
 void detector_getHitCounts(detector_hitCount_t hitArray[]);
 
+// Copies the power values the detector last used for hit detection, one per
+// frequency, into powerValues[]. Works for every backend.
+void detector_getCurrentPowerValues(double powerValues[]);
+
+// How detector_checkForHit() decides that a power value is a hit.
+typedef enum {
+  // The biggest power must be a fudge factor times the median of all 10.
+  DETECTOR_THRESHOLD_MEDIAN,
+  // Each frequency keeps an exponentially-weighted noise floor (mean) and
+  // deviation of its power. The frequency with the most power above its
+  // floor hits when it is more than a factor times that deviation above the
+  // floor and well clear of the other frequencies. Falls back to the median
+  // method while the floors warm up (about half a second after init).
+  DETECTOR_THRESHOLD_ADAPTIVE
+} detector_threshold_t;
+
+// State of the adaptive threshold engine, for tuning.
+typedef struct {
+  detector_threshold_t mode; // Method detector_checkForHit() is using.
+  bool warmedUp;             // Adaptive thresholds are in use.
+  uint32_t updateCount;      // Noise floor updates (10 ms blocks) since init.
+  double noiseFloor[FILTER_FREQUENCY_COUNT];
+  double deviation[FILTER_FREQUENCY_COUNT];
+  double threshold[FILTER_FREQUENCY_COUNT]; // Adaptive hit thresholds.
+} detector_thresholdStats_t;
+
 // Allows the fudge-factor index to be set externally from the detector.
 // The actual values for fudge-factors is stored in an array found in detector.c
+// The index (0-9, 5 by default) selects the median multiple in median mode
+// and the number of deviations above the noise floor in adaptive mode.
 void detector_setFudgeFactorIndex(uint32_t index);
 
+// Selects the threshold method, DETECTOR_THRESHOLD_MEDIAN by default. The
+// noise floors are tracked in either mode.
+void detector_setThresholdMode(detector_threshold_t mode);
+
+// Copies the adaptive threshold state into stats.
+void detector_getThresholdStats(detector_thresholdStats_t *stats);
+
+// Prints the adaptive threshold state, one line per frequency.
+void detector_printThresholdStats();
+
 // This function sorts the inputs in the unsortedArray and
 // copies the sorted results into the sortedArray. It also
 // finds the maximum power value and assigns the frequency
@@ -86,6 +147,13 @@ void detector_setFudgeFactorIndex(uint32_t index);
 detector_status_t detector_sort(uint32_t *maxPowerFreqNo,
                                 double unsortedValues[], double sortedValues[]);
 
+// Applies the detector's hit test to powerValues[] (one per frequency) without
+// recording a hit or updating the noise floors. Returns true if there is a hit
+// and sets *frequencyNumber to the frequency with the most power (in adaptive
+// mode, the frequency furthest above its threshold). Frequencies ignored at
+// detector_init() never hit.
+bool detector_checkForHit(double powerValues[], uint16_t *frequencyNumber);
+
 // Encapsulate ADC scaling for easier testing.
 double detector_getScaledAdcValue(isr_AdcValue_t adcValue);
 
@@ -96,6 +164,12 @@ double detector_getScaledAdcValue(isr_AdcValue_t adcValue);
 // Students implement this as part of Milestone 3, Task 3.
 void detector_runTest();
 
+// Feeds a steady noise floor through detector_getHit() and checks that the
+// adaptive threshold catches a shot the median method misses, and doesn't
+// hit on the noise. Returns true if the test passes. Prints informational
+// messages if printMessageFlag is true.
+bool detector_runThresholdTest(bool printMessageFlag);
+
 // Returns 0 if passes, non-zero otherwise.
 // if printTestMessages is true, print out detailed status messages.
 // detector_status_t detector_testSort(sortTestFunctionPtr testSortFunction,
@@ -1,5 +1,22 @@
 #include "filter.h"
+#include "filterFixed.h"
+#include "filterFloat.h"
+#include "windowQueue.h"
+#include <math.h>
 #include <stdio.h>
+
+// SIMD support for filter_iirFilterBank(). The NEON path needs
+// double-precision lanes, which only 64-bit ARM has: the Cortex-A9 (ARMv7)
+// NEON unit only does float, so this bank is never vectorized on the board.
+// The board's NEON bank is the single-precision one in filterFloat.c, which
+// the detector uses under FILTER_SINGLE_PRECISION.
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define FILTER_IIR_BANK_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define FILTER_IIR_BANK_NEON
+#endif
 /*
 #define FILTER_SAMPLE_FREQUENCY_IN_KHZ 100
 #define FILTER_FREQUENCY_COUNT 10
@@ -33,25 +50,40 @@ static const uint16_t filter_frequencyTickTable[FILTER_FREQUENCY_COUNT] = {
 
 #define NUM_IIR_FILTERS 10 // Queue constants
 #define QUEUE_INIT_VAL 0.0
-#define X_QUEUE_SIZE 81               // not sure yet
 #define Y_QUEUE_SIZE IIR_B_COEF_COUNT // not sure yet
 #define Z_QUEUE_SIZE IIR_A_COEF_COUNT // confirmed
-#define OUTPUT_QUEUE_SIZE 2000        // confirmed
+#define POWER_WINDOW_SIZE FILTER_INPUT_PULSE_WIDTH // outputs summed for power
 
 #define IIR_A_COEF_COUNT 10 // ignores first coefficient
 #define IIR_B_COEF_COUNT 11
+#define IIR_SOS_SECTION_COUNT 5 // 10th-order filter as 5 biquads
+#define IIR_SOS_COEF_COUNT 5    // b0, b1, b2, a1, a2 (a0 is always 1)
 #define FIR_COEF_COUNT 81
 
 #define FIR_DECIMATION_FACTOR 10
 
 // Queues
-static queue_t xQueue;
 static queue_t yQueue;
 static queue_t zQueue[NUM_IIR_FILTERS];
-static queue_t outputQueue[NUM_IIR_FILTERS];
+
+// Sliding window of squared IIR outputs for the power computation. Only the
+// squares are ever needed, so they are kept as float: 8 KB per filter instead
+// of a 16 KB queue of double outputs.
+typedef struct {
+  float squares[POWER_WINDOW_SIZE];
+  uint32_t index; // next slot to write, which holds the oldest square
+  float newest;   // square added by the last push
+  float oldest;   // square that left the window on the last push
+  // Running sum of the squares with Neumaier compensation: the power is
+  // sum + compensation, accurate to a few ulps of the current power even
+  // after a much larger signal has left the window.
+  double sum;
+  double compensation;
+} powerWindow_t;
+static powerWindow_t powerWindow[NUM_IIR_FILTERS];
 
 // Filter Coefficients
-const static double fir_coef[FIR_COEF_COUNT] = {0.0,
+static const double fir_coef[FIR_COEF_COUNT] = {0.0,
                                                 3.8342823682706231e-06,
                                                 1.8434064577496714e-05,
                                                 4.3060491068262203e-05,
@@ -133,7 +165,7 @@ const static double fir_coef[FIR_COEF_COUNT] = {0.0,
                                                 3.8342823682706231e-06,
                                                 0.0000000000000000e+00};
 
-const static double iir_a_coef[NUM_IIR_FILTERS][IIR_A_COEF_COUNT] = {
+static const double iir_a_coef[NUM_IIR_FILTERS][IIR_A_COEF_COUNT] = {
     {-5.9637727070164015e+00, 1.9125339333078248e+01, -4.0341474540744173e+01,
      6.1537466875368821e+01, -7.0019717951472188e+01, 6.0298814235238872e+01,
      -3.8733792862566290e+01, 1.7993533279581058e+01, -5.4979061224867651e+00,
@@ -175,7 +207,7 @@ const static double iir_a_coef[NUM_IIR_FILTERS][IIR_A_COEF_COUNT] = {
      8.0686288623299745e+01, 3.2276361903872115e+01, 7.9045143816244696e+00,
      9.0332828533799636e-01}}; // channel 10
 
-const static double iir_b_coef[NUM_IIR_FILTERS][IIR_B_COEF_COUNT] = {
+static const double iir_b_coef[NUM_IIR_FILTERS][IIR_B_COEF_COUNT] = {
     {9.0928661148194738e-10, 0.0000000000000000e+00, -4.5464330574097372e-09,
      0.0000000000000000e+00, 9.0928661148194745e-09, 0.0000000000000000e+00,
      -9.0928661148194745e-09, 0.0000000000000000e+00, 4.5464330574097372e-09,
@@ -217,16 +249,193 @@ const static double iir_b_coef[NUM_IIR_FILTERS][IIR_B_COEF_COUNT] = {
      -9.0928661148206094e-09, 0.0000000000000000e+00, 4.5464330574103047e-09,
      0.0000000000000000e+00, -9.0928661148206091e-10}}; // channel 10
 
+// FIR input history. The newest FIR_COEF_COUNT inputs are always contiguous
+// (see windowQueue.h), so filter_firFilter() runs a straight dot product with
+// no modulo.
+static windowQueue_t firHistory;
+// Inputs received since the last decimated FIR output.
+static uint16_t firDecimationCount;
+
+// Most recent FIR output, the input to filter_iirSosFilter().
+static double firOutput;
+
+// Transposed direct form II state of the IIR filters: the two delay values
+// of each second-order section. Stored [section][filter] (struct of arrays) so
+// that filter_iirFilterBank() can load neighbouring filters into one register.
+typedef struct {
+  double s1[IIR_SOS_SECTION_COUNT][NUM_IIR_FILTERS];
+  double s2[IIR_SOS_SECTION_COUNT][NUM_IIR_FILTERS];
+} iirSosState_t;
+static iirSosState_t iirSosState;
+// iir_sos_coef transposed to [section][coefficient][filter] at init, for the
+// same reason.
+static double iirSosBankCoef[IIR_SOS_SECTION_COUNT][IIR_SOS_COEF_COUNT]
+                            [NUM_IIR_FILTERS];
+
+// Second-order-section (biquad) form of the iir_a_coef/iir_b_coef filters,
+// one row of {b0, b1, b2, a1, a2} per section. The numerator (1 - z^-2)^5 is
+// split evenly and each pole pair gets its own section. Sections are ordered
+// by increasing pole radius and scaled so the cascade up to every section
+// peaks at unity gain, which keeps intermediate values within +/-1 for
+// fixed-point implementations.
+static const double
+    iir_sos_coef[NUM_IIR_FILTERS][IIR_SOS_SECTION_COUNT][IIR_SOS_COEF_COUNT] = {
+        {{1.5466378306318933e-02, 0.0000000000000000e+00,
+          -1.5466378306318933e-02, -1.1863680750396060e+00,
+          9.6906746911937569e-01},
+         {1.3951696406587694e-02, 0.0000000000000000e+00,
+          -1.3951696406587694e-02, -1.1751240035566852e+00,
+          9.7473023529340130e-01},
+         {1.7245671356213039e-02, 0.0000000000000000e+00,
+          -1.7245671356213039e-02, -1.2044435275385872e+00,
+          9.7507575462507112e-01},
+         {9.3548398769525715e-03, 0.0000000000000000e+00,
+          -9.3548398769525715e-03, -1.1751207996121462e+00,
+          9.9023179298901332e-01},
+         {2.6119730190720059e-02, 0.0000000000000000e+00,
+          -2.6119730190720059e-02, -1.2227163478322427e+00,
+          9.9044859187724155e-01}}, // channel 1
+        {{1.5467156566910245e-02, 0.0000000000000000e+00,
+          -1.5467156566910245e-02, -9.2259237180825315e-01,
+          9.6906739909823525e-01},
+         {1.3922533659209289e-02, 0.0000000000000000e+00,
+          -1.3922533659209289e-02, -9.0908057257664110e-01,
+          9.7478163949214602e-01},
+         {1.7282329646813480e-02, 0.0000000000000000e+00,
+          -1.7282329646813480e-02, -9.4141681673237698e-01,
+          9.7502437946337062e-01},
+         {9.3203390542209684e-03, 0.0000000000000000e+00,
+          -9.3203390542209684e-03, -9.0604811561566323e-01,
+          9.9026403841449862e-01},
+         {2.6214286537087090e-02, 0.0000000000000000e+00,
+          -2.6214286537087090e-02, -9.5865683903480459e-01,
+          9.9041636413389744e-01}}, // channel 2
+        {{1.5466718410386529e-02, 0.0000000000000000e+00,
+          -1.5466718410386529e-02, -6.0855036556959596e-01,
+          9.6906741792110540e-01},
+         {1.3897969148456431e-02, 0.0000000000000000e+00,
+          -1.3897969148456431e-02, -5.9293576689250560e-01,
+          9.7482863210752602e-01},
+         {1.7312580529392732e-02, 0.0000000000000000e+00,
+          -1.7312580529392732e-02, -6.2766922635955413e-01,
+          9.7497735594413260e-01},
+         {9.2930418282442650e-03, 0.0000000000000000e+00,
+          -9.2930418282442650e-03, -5.8669556680662160e-01,
+          9.9029352692683592e-01},
+         {2.6292481438820230e-02, 0.0000000000000000e+00,
+          -2.6292481438820230e-02, -6.4328086618793046e-01,
+          9.9038686474824611e-01}}, // channel 3
+        {{1.5466301726240446e-02, 0.0000000000000000e+00,
+          -1.5466301726240446e-02, -2.7992805432851631e-01,
+          9.6906740916566692e-01},
+         {1.3873885314569241e-02, 0.0000000000000000e+00,
+          -1.3873885314569241e-02, -2.6267822370225008e-01,
+          9.7487012643200788e-01},
+         {1.7342341247225581e-02, 0.0000000000000000e+00,
+          -1.7342341247225581e-02, -2.9878981665170895e-01,
+          9.7493586050171377e-01},
+         {9.2718056943996725e-03, 0.0000000000000000e+00,
+          -9.2718056943996725e-03, -2.5345491118398794e-01,
+          9.9031957011661031e-01},
+         {2.6353855998758571e-02, 0.0000000000000000e+00,
+          -2.6353855998758571e-02, -3.1232391326403652e-01,
+          9.9036082114758395e-01}}, // channel 4
+        {{1.5466694564761562e-02, 0.0000000000000000e+00,
+          -1.5466694564761562e-02, 1.6314356629228230e-01,
+          9.6906741593359502e-01},
+         {1.3867432392569119e-02, 0.0000000000000000e+00,
+          -1.3867432392569119e-02, 1.4543810000690024e-01,
+          9.7488396567095348e-01},
+         {1.7350685102424324e-02, 0.0000000000000000e+00,
+          -1.7350685102424324e-02, 1.8178847310656290e-01,
+          9.7492201705659642e-01},
+         {9.2595884693639236e-03, 0.0000000000000000e+00,
+          -9.2595884693639236e-03, 1.3523718769753304e-01,
+          9.9032825589751472e-01},
+         {2.6387540735340435e-02, 0.0000000000000000e+00,
+          -2.6387540735340435e-02, 1.9450173346696487e-01,
+          9.9035213525553112e-01}}, // channel 5
+        {{1.5466932074512980e-02, 0.0000000000000000e+00,
+          -1.5466932074512980e-02, 5.3871734428167783e-01,
+          9.6906742577232363e-01},
+         {1.3891359384772805e-02, 0.0000000000000000e+00,
+          -1.3891359384772805e-02, 5.2270990378198834e-01,
+          9.7483789219989248e-01},
+         {1.7320971603155891e-02, 0.0000000000000000e+00,
+          -1.7320971603155891e-02, 5.5782688807256420e-01,
+          9.7496807765488269e-01},
+         {9.2870395911748161e-03, 0.0000000000000000e+00,
+          -9.2870395911748161e-03, 5.1580591091803141e-01,
+          9.9029934857791713e-01},
+         {2.6308877842206681e-02, 0.0000000000000000e+00,
+          -2.6308877842206681e-02, 5.7302693171535490e-01,
+          9.9038104384176684e-01}}, // channel 6
+        {{1.5466285611122415e-02, 0.0000000000000000e+00,
+          -1.5466285611122415e-02, 9.8429798044728511e-01,
+          9.6906743556143249e-01},
+         {1.3928713888158181e-02, 0.0000000000000000e+00,
+          -1.3928713888158181e-02, 9.7127092365497336e-01,
+          9.7477091563254237e-01},
+         {1.7274073131555791e-02, 0.0000000000000000e+00,
+          -1.7274073131555791e-02, 1.0029929295030342e+00,
+          9.7503505696164106e-01},
+         {9.3307535472977321e-03, 0.0000000000000000e+00,
+          -9.3307535472977321e-03, 9.6891634649287883e-01,
+          9.9025731427227559e-01},
+         {2.6187393888584369e-02, 0.0000000000000000e+00,
+          -2.6187393888584369e-02, 1.0205053410673686e+00,
+          9.9042308429645287e-01}}, // channel 7
+        {{1.5466317107917989e-02, 0.0000000000000000e+00,
+          -1.5466317107917989e-02, 1.2274302877030756e+00,
+          9.6906736847991737e-01},
+         {1.3956575415883594e-02, 0.0000000000000000e+00,
+          -1.3956575415883594e-02, 1.2165897949463531e+00,
+          9.7472058920159077e-01},
+         {1.7239568313473886e-02, 0.0000000000000000e+00,
+          -1.7239568313473886e-02, 1.2453388197792228e+00,
+          9.7508549855657167e-01},
+         {9.3605469410061870e-03, 0.0000000000000000e+00,
+          -9.3605469410061870e-03, 1.2170923519271981e+00,
+          9.9022573233703703e-01},
+         {2.6104020827385360e-02, 0.0000000000000000e+00,
+          -2.6104020827385360e-02, 1.2637381590845747e+00,
+          9.9045467708690016e-01}}, // channel 8
+        {{1.5466805677729560e-02, 0.0000000000000000e+00,
+          -1.5466805677729560e-02, 1.4739239362428129e+00,
+          9.6906751939825342e-01},
+         {1.3998491762608522e-02, 0.0000000000000000e+00,
+          -1.3998491762608522e-02, 1.4658797264102124e+00,
+          9.7464462531512808e-01},
+         {1.7188376242682820e-02, 0.0000000000000000e+00,
+          -1.7188376242682820e-02, 1.4904550711846343e+00,
+          9.7516145021233847e-01},
+         {9.4030400193310121e-03, 0.0000000000000000e+00,
+          -9.4030400193310121e-03, 1.4696759867581493e+00,
+          9.9017814073769428e-01},
+         {2.5984585008866426e-02, 0.0000000000000000e+00,
+          -2.5984585008866426e-02, 1.5093567270239465e+00,
+          9.9050226366910699e-01}}, // channel 9
+        {{1.5466348275765214e-02, 0.0000000000000000e+00,
+          -1.5466348275765214e-02, 1.7056798883451620e+00,
+          9.6906778282419759e-01},
+         {1.4075907241256451e-02, 0.0000000000000000e+00,
+          -1.4075907241256451e-02, 1.7011305287667740e+00,
+          9.7450547160664336e-01},
+         {1.7093642300287634e-02, 0.0000000000000000e+00,
+          -1.7093642300287634e-02, 1.7200487067643062e+00,
+          9.7530043145640632e-01},
+         {9.4870803848352350e-03, 0.0000000000000000e+00,
+          -9.4870803848352350e-03, 1.7086463844187210e+00,
+          9.9009151509033499e-01},
+         {2.5755466625142758e-02, 0.0000000000000000e+00,
+          -2.5755466625142758e-02, 1.7387997474705130e+00,
+          9.9058846984913740e-01}}}; // channel 10
+
 // array for current power values - initialized to zero
 static double currentPowerValue[NUM_IIR_FILTERS] = {
     INIT_VAL_DOUBLE, INIT_VAL_DOUBLE, INIT_VAL_DOUBLE, INIT_VAL_DOUBLE,
     INIT_VAL_DOUBLE, INIT_VAL_DOUBLE, INIT_VAL_DOUBLE, INIT_VAL_DOUBLE,
     INIT_VAL_DOUBLE, INIT_VAL_DOUBLE};
-// saves oldest value to subtract from power - efficient power calculation
-static double oldestValue[NUM_IIR_FILTERS] = {
-    INIT_VAL_DOUBLE, INIT_VAL_DOUBLE, INIT_VAL_DOUBLE, INIT_VAL_DOUBLE,
-    INIT_VAL_DOUBLE, INIT_VAL_DOUBLE, INIT_VAL_DOUBLE, INIT_VAL_DOUBLE,
-    INIT_VAL_DOUBLE, INIT_VAL_DOUBLE};
 
 // generic init for all queues and fills with zeros, takes in size of queue
 void initQueue(queue_t *q, uint32_t queueSize, char *name) {
@@ -236,52 +445,129 @@ void initQueue(queue_t *q, uint32_t queueSize, char *name) {
   }
 }
 
-// inits the xQueue using initQueue
-void initXQueue() {
-  initQueue(&xQueue, X_QUEUE_SIZE,
-            "x"); // uses custom function to init and fill with values
+// inits the FIR input history and fills it with zeros
+void initFirHistory() {
+  if (firHistory.data == NULL) // allocated once, filled on later inits
+    windowQueue_init(&firHistory, FIR_COEF_COUNT, "firHistory");
+  windowQueue_fill(&firHistory, QUEUE_INIT_VAL);
+  firDecimationCount = INIT_VAL;
 }
 
 // inits the yQueue using initQueue
 void initYQueue() {
   initQueue(&yQueue, Y_QUEUE_SIZE,
             "y"); // uses custom function to init and fill with values
+  firOutput = QUEUE_INIT_VAL;
+}
+
+// zeroes the biquad state of a single IIR filter
+void clearIirSosState(uint16_t filterNumber) {
+  for (uint32_t i = INIT_VAL; i < IIR_SOS_SECTION_COUNT; i++) {
+    iirSosState.s1[i][filterNumber] = INIT_VAL_DOUBLE;
+    iirSosState.s2[i][filterNumber] = INIT_VAL_DOUBLE;
+  }
+}
+
+// copies iir_sos_coef into the filter-minor layout used by the bank
+void initIirSosBankCoef() {
+  for (uint32_t f = INIT_VAL; f < NUM_IIR_FILTERS; f++) {
+    for (uint32_t s = INIT_VAL; s < IIR_SOS_SECTION_COUNT; s++) {
+      for (uint32_t c = INIT_VAL; c < IIR_SOS_COEF_COUNT; c++) {
+        iirSosBankCoef[s][c][f] = iir_sos_coef[f][s][c];
+      }
+    }
+  }
 }
 
 // inits all 10 IIR Filter zQueues
 void initZQueue() {
-  char *name;
+  char name[QUEUE_MAX_NAME_SIZE];
   for (uint32_t i = INIT_VAL; i < NUM_IIR_FILTERS;
        i++) {                // makes each queue instance
     sprintf(name, "z%d", i); // creates name for init function
     // zQueue[i] = queue_t q;
     initQueue(&(zQueue[i]), Z_QUEUE_SIZE,
               name); // uses custom function to init and fill with values
+    clearIirSosState(i);
   }
 }
 
-// inits all 10 Output Filter zQueues
-void initOutputQueue() {
-  char *name; // creates name for init function
-  for (uint32_t i = INIT_VAL; i < NUM_IIR_FILTERS;
-       i++) { // makes each queue instance
-    sprintf(name, "output%d", i);
-    // outputQueue[i] = queue_t q;
-    initQueue(&(outputQueue[i]), OUTPUT_QUEUE_SIZE,
-              name); // uses custom function to init and fill with values
+// adds an IIR output to the power window of filter [filterNumber]
+static void addToPowerWindow(uint16_t filterNumber, double output) {
+  powerWindow_t *w = &powerWindow[filterNumber];
+  w->oldest = w->squares[w->index];
+  w->newest = (float)(output * output);
+  w->squares[w->index] = w->newest;
+  if (++w->index >= POWER_WINDOW_SIZE) // wrap without a modulo
+    w->index = INIT_VAL;
+}
+
+// adds value to a compensated (Neumaier) sum, collecting the low-order bits
+// lost by sum in compensation
+static inline void compensatedAdd(double *sum, double *compensation,
+                                  double value) {
+  double t = *sum + value;
+  if (fabs(*sum) >= fabs(value))
+    *compensation += (*sum - t) + value;
+  else
+    *compensation += (value - t) + *sum;
+  *sum = t;
+}
+
+// inits all 10 power windows, filled with zeros
+void initPowerWindow() {
+  for (uint16_t i = INIT_VAL; i < NUM_IIR_FILTERS; i++) {
+    filter_fillPowerWindow(i, INIT_VAL_DOUBLE);
+    currentPowerValue[i] = INIT_VAL_DOUBLE;
   }
 }
 
+// Inits the FIR filter alone, for callers that don't use the IIR filters.
+void filter_initFir() {
+  initFirHistory(); // inits each queue and fills with 0.0
+  initYQueue();
+}
+
 // Must call this prior to using any filter functions.
 void filter_init() {
-  initXQueue(); // inits each queue and fills with 0.0
-  initYQueue();
+  filter_initFir();
   initZQueue();
-  initOutputQueue();
+  initPowerWindow();
+  initIirSosBankCoef();
+}
+
+// Clears the FIR input history and outputs, as filter_initFir() does.
+void filter_resetFir() {
+  filter_fillFirHistory(QUEUE_INIT_VAL);
+  firDecimationCount = INIT_VAL;
+  filter_fillQueue(&yQueue, QUEUE_INIT_VAL);
+  firOutput = QUEUE_INIT_VAL;
 }
 
-// Use this to copy an input into the input queue of the FIR-filter (xQueue).
-void filter_addNewInput(double x) { queue_overwritePush(&xQueue, x); }
+// Clears every input, output and power value, as filter_init() does, but
+// keeps the queues that filter_init() allocated.
+void filter_reset() {
+  filter_resetFir();
+  for (uint16_t i = INIT_VAL; i < NUM_IIR_FILTERS; i++) {
+    filter_clearIirState(i);
+  }
+  initPowerWindow();
+}
+
+// Use this to copy an input into the input history of the FIR-filter.
+void filter_addNewInput(double x) { windowQueue_push(&firHistory, x); }
+
+// Adds x to the FIR input history and runs filter_firFilter() only when
+// FILTER_FIR_DECIMATION_FACTOR new inputs have arrived, so discarded outputs
+// are never computed. Returns true if a new output was pushed onto yQueue.
+bool filter_decimatingFirFilter(double x) {
+  filter_addNewInput(x);
+  if (++firDecimationCount < FIR_DECIMATION_FACTOR)
+    return false;
+  firDecimationCount = INIT_VAL; // resets for next set of 10
+  filter_firFilter();
+  return true;
+}
 
 // Fills a queue with the given fillValue. For example,
 // if the queue is of size 10, and the fillValue = 1.0,
@@ -295,17 +581,58 @@ void filter_fillQueue(queue_t *q, double fillValue) {
   }
 }
 
-// Invokes the FIR-filter. Input is contents of xQueue.
-// Output is returned and is also pushed on to yQueue.
-double filter_firFilter() {
+// Zeroes zQueue[filterNumber] and the biquad state of IIR filter
+// [filterNumber].
+void filter_clearIirState(uint16_t filterNumber) {
+  filter_fillQueue(&zQueue[filterNumber], QUEUE_INIT_VAL);
+  clearIirSosState(filterNumber);
+}
+
+// Fills the FIR input history with the given fillValue.
+void filter_fillFirHistory(double fillValue) {
+  windowQueue_fill(&firHistory, fillValue);
+}
+
+// FIR output for the current input history
+static inline double firDotProduct() {
+  // contiguous window of the last FIR_COEF_COUNT inputs, oldest first
+  const double *x = windowQueue_window(&firHistory, FIR_COEF_COUNT);
   double y = INIT_VAL_DOUBLE;                     // starts sum at 0
   for (uint32_t i = 0; i < FIR_COEF_COUNT; i++) { // for y queue
-    y += queue_readElementAt(&xQueue, FIR_COEF_COUNT - 1 - i) * fir_coef[i];
+    y += x[FIR_COEF_COUNT - 1 - i] * fir_coef[i];
   }
+  return y;
+}
+
+// Invokes the FIR-filter. Input is the FIR input history.
+// Output is returned and is also pushed on to yQueue.
+double filter_firFilter() {
+  double y = firDotProduct();
   queue_overwritePush(&yQueue, y);
+  firOutput = y;
   return y;
 }
 
+// Returns the most recent filter_firFilter() output.
+double filter_getFirOutput() { return firOutput; }
+
+// Runs filter_decimatingFirFilter() on x[0..count-1], writing the outputs to
+// y[] instead of yQueue. Returns the number of outputs.
+uint32_t filter_decimatingFirFilterBlock(const double x[], uint32_t count,
+                                         double y[]) {
+  uint32_t outputCount = INIT_VAL;
+  for (uint32_t i = INIT_VAL; i < count; i++) {
+    filter_addNewInput(x[i]);
+    if (++firDecimationCount < FIR_DECIMATION_FACTOR)
+      continue;
+    firDecimationCount = INIT_VAL;
+    y[outputCount++] = firDotProduct();
+  }
+  if (outputCount > INIT_VAL)
+    firOutput = y[outputCount - 1];
+  return outputCount;
+}
+
 // Use this to invoke a single iir filter. Input comes from yQueue.
 // Output is returned and is also pushed onto zQueue[filterNumber].
 double filter_iirFilter(uint16_t filterNumber) {
@@ -330,63 +657,162 @@ double filter_iirFilter(uint16_t filterNumber) {
   // printf("TOTAL SUM:  %f\n", total_sum);
 
   queue_overwritePush(&(zQueue[filterNumber]), total_sum);
-  queue_overwritePush(&(outputQueue[filterNumber]), total_sum);
+  addToPowerWindow(filterNumber, total_sum);
   return total_sum;
 }
 
-// Use this to compute the power for values contained in an outputQueue.
-// If force == true, then recompute power by using all values in the
-// outputQueue. This option is necessary so that you can correctly compute power
-// values the first time. After that, you can incrementally compute power values
-// by:
-// 1. Keeping track of the power computed in a previous run, call this
-// prev-power.
-// 2. Keeping track of the oldest outputQueue value used in a previous run, call
-// this oldest-value.
-// 3. Get the newest value from the power queue, call this newest-value.
-// 4. Compute new power as: prev-power - (oldest-value * oldest-value) +
-// (newest-value * newest-value). Note that this function will probably need an
-// array to keep track of these values for each of the 10 output queues.
-double filter_computePower(uint16_t filterNumber, bool forceComputeFromScratch,
-                           bool debugPrint) {
-  double power_sum = INIT_VAL_DOUBLE;
-  double currVal;
-  double newVal;
-  double oldVal;
-  uint32_t qLength =
-      queue_elementCount(&(outputQueue[filterNumber])); // access length once
-
-  // force case
-  if (forceComputeFromScratch) {
-    // iterates through length of queue to add the square of each element
-    for (uint32_t i = INIT_VAL; i < qLength; i++) {
-      currVal = queue_readElementAt(&(outputQueue[filterNumber]),
-                                    i); // access queue once
-      power_sum += (currVal * currVal); // summing currVal^2
+// Runs IIR filter [filterNumber] as a cascade of second-order sections in
+// transposed direct form II. Input is the latest FIR output. Output is
+// returned and added to the power window (zQueue is not used).
+double filter_iirSosFilter(uint16_t filterNumber) {
+  double x = firOutput;
+  for (uint32_t i = INIT_VAL; i < IIR_SOS_SECTION_COUNT; i++) {
+    const double *c = iir_sos_coef[filterNumber][i]; // b0, b1, b2, a1, a2
+    double *s1 = &iirSosState.s1[i][filterNumber];
+    double *s2 = &iirSosState.s2[i][filterNumber];
+    double y = c[0] * x + *s1;
+    *s1 = c[1] * x - c[3] * y + *s2;
+    *s2 = c[2] * x - c[4] * y;
+    x = y; // output of this section feeds the next one
+  }
+  addToPowerWindow(filterNumber, x);
+  return x;
+}
+
+// Runs all of the IIR filters on input x at once. Each section is advanced
+// for every filter before moving to the next section, two filters per SIMD
+// register where available. Outputs are written to out[].
+static inline void iirFilterBankStep(double x, double out[]) {
+  for (uint32_t f = INIT_VAL; f < NUM_IIR_FILTERS; f++) {
+    out[f] = x; // every filter starts from the same input
+  }
+  for (uint32_t i = INIT_VAL; i < IIR_SOS_SECTION_COUNT; i++) {
+    const double *b0 = iirSosBankCoef[i][0];
+    const double *b1 = iirSosBankCoef[i][1];
+    const double *b2 = iirSosBankCoef[i][2];
+    const double *a1 = iirSosBankCoef[i][3];
+    const double *a2 = iirSosBankCoef[i][4];
+    double *s1 = iirSosState.s1[i];
+    double *s2 = iirSosState.s2[i];
+    uint32_t f = INIT_VAL;
+#if defined(FILTER_IIR_BANK_SSE2)
+    for (; f + 2 <= NUM_IIR_FILTERS; f += 2) {
+      __m128d x = _mm_loadu_pd(&out[f]);
+      __m128d y = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(&b0[f]), x),
+                             _mm_loadu_pd(&s1[f]));
+      __m128d n1 = _mm_sub_pd(_mm_mul_pd(_mm_loadu_pd(&b1[f]), x),
+                              _mm_mul_pd(_mm_loadu_pd(&a1[f]), y));
+      _mm_storeu_pd(&s1[f], _mm_add_pd(n1, _mm_loadu_pd(&s2[f])));
+      _mm_storeu_pd(&s2[f], _mm_sub_pd(_mm_mul_pd(_mm_loadu_pd(&b2[f]), x),
+                                       _mm_mul_pd(_mm_loadu_pd(&a2[f]), y)));
+      _mm_storeu_pd(&out[f], y);
     }
+#elif defined(FILTER_IIR_BANK_NEON)
+    for (; f + 2 <= NUM_IIR_FILTERS; f += 2) {
+      float64x2_t x = vld1q_f64(&out[f]);
+      float64x2_t y = vaddq_f64(vmulq_f64(vld1q_f64(&b0[f]), x),
+                                vld1q_f64(&s1[f]));
+      float64x2_t n1 = vsubq_f64(vmulq_f64(vld1q_f64(&b1[f]), x),
+                                 vmulq_f64(vld1q_f64(&a1[f]), y));
+      vst1q_f64(&s1[f], vaddq_f64(n1, vld1q_f64(&s2[f])));
+      vst1q_f64(&s2[f], vsubq_f64(vmulq_f64(vld1q_f64(&b2[f]), x),
+                                  vmulq_f64(vld1q_f64(&a2[f]), y)));
+      vst1q_f64(&out[f], y);
+    }
+#endif
+    for (; f < NUM_IIR_FILTERS; f++) { // scalar fallback and odd filter
+      double x = out[f];
+      double y = b0[f] * x + s1[f];
+      s1[f] = b1[f] * x - a1[f] * y + s2[f];
+      s2[f] = b2[f] * x - a2[f] * y;
+      out[f] = y;
+    }
+  }
+}
+
+// Runs all of the IIR filters on the latest FIR output at once and adds the
+// outputs to the power windows.
+void filter_iirFilterBank(double out[]) {
+  iirFilterBankStep(firOutput, out);
+  for (uint32_t f = INIT_VAL; f < NUM_IIR_FILTERS; f++) {
+    addToPowerWindow(f, out[f]);
+  }
+}
 
-  } else { // regular calculation
-    newVal = queue_readElementAt(&(outputQueue[filterNumber]),
-                                 qLength - 1); // pulls newest value
-    oldVal =
-        oldestValue[filterNumber]; // pulls oldest value (not pushed off queue)
-    power_sum = currentPowerValue[filterNumber];
-    power_sum +=
-        ((newVal * newVal) -
-         (oldVal * oldVal)); // adds newest square and subtracts oldest sum
+// Runs filter_iirFilterBank() on each of x[0..count-1], writing the outputs to
+// y[] but not to the power windows.
+void filter_iirFilterBankBlock(const double x[], uint32_t count,
+                               double y[][FILTER_FREQUENCY_COUNT]) {
+  for (uint32_t n = INIT_VAL; n < count; n++) {
+    iirFilterBankStep(x[n], y[n]);
   }
+}
 
-  oldestValue[filterNumber] = queue_readElementAt(
-      &(outputQueue[filterNumber]),
-      INIT_VAL); // saves oldest index for next power calculation
+// Use this to compute the power over the power window (the last
+// FILTER_INPUT_PULSE_WIDTH outputs) of IIR filter [filterNumber].
+// If force == true, then recompute power by summing the whole window. This
+// option is necessary so that you can correctly compute power values the first
+// time. After that, power is computed incrementally as prev-power - oldest
+// square + newest square. The window is also summed again each time it wraps
+// so that rounding in the incremental update cannot build up.
+static inline double windowPower(powerWindow_t *w,
+                                 bool forceComputeFromScratch) {
+  // force case, also taken once per pass through the window (rebase)
+  if (forceComputeFromScratch || w->index == INIT_VAL) {
+    w->sum = INIT_VAL_DOUBLE;
+    w->compensation = INIT_VAL_DOUBLE;
+    for (uint32_t i = INIT_VAL; i < POWER_WINDOW_SIZE; i++) {
+      compensatedAdd(&w->sum, &w->compensation, w->squares[i]);
+    }
+  } else { // regular calculation: add newest square, subtract oldest
+    compensatedAdd(&w->sum, &w->compensation, w->newest);
+    compensatedAdd(&w->sum, &w->compensation, -w->oldest);
+  }
+
+  double power_sum = w->sum + w->compensation;
+  if (power_sum < INIT_VAL_DOUBLE) // squares can't sum to less than zero
+    power_sum = INIT_VAL_DOUBLE;
+  return power_sum;
+}
+
+// Power of IIR filter [filterNumber], see windowPower().
+double filter_computePower(uint16_t filterNumber, bool forceComputeFromScratch,
+                           bool debugPrint) {
+  (void)debugPrint; // Kept for the API; there is nothing extra to print.
+  double power_sum =
+      windowPower(&powerWindow[filterNumber], forceComputeFromScratch);
   currentPowerValue[filterNumber] = power_sum; // save power sum to array
   return power_sum;
 }
 
+// Adds each row of IIR outputs y[0..count-1] to the power windows, writing the
+// powers after each row to power[]. The filters are independent, so the inner
+// loop over them overlaps their running sums.
+void filter_computePowerBlock(const double y[][FILTER_FREQUENCY_COUNT],
+                              uint32_t count,
+                              double power[][FILTER_FREQUENCY_COUNT]) {
+  for (uint32_t n = INIT_VAL; n < count; n++) {
+    for (uint16_t f = INIT_VAL; f < NUM_IIR_FILTERS; f++) {
+      addToPowerWindow(f, y[n][f]);
+      power[n][f] = windowPower(&powerWindow[f], false);
+    }
+  }
+  for (uint16_t f = INIT_VAL; count > INIT_VAL && f < NUM_IIR_FILTERS; f++) {
+    currentPowerValue[f] = power[count - 1][f];
+  }
+}
+
 // Returns the last-computed output power value for the IIR filter
 // [filterNumber].
 double filter_getCurrentPowerValue(uint16_t filterNumber) {
+#if defined(FILTER_FIXED_POINT)
+  return filterFixed_powerToDouble(
+      filterFixed_getCurrentPowerValue(filterNumber));
+#elif defined(FILTER_SINGLE_PRECISION)
+  return filterFloat_getCurrentPowerValue(filterNumber);
+#else
   return currentPowerValue[filterNumber];
+#endif
 }
 
 // Get a copy of the current power values.
@@ -395,6 +821,13 @@ double filter_getCurrentPowerValue(uint16_t filterNumber) {
 // detector. Remember that when you pass an array into a C function, changes to
 // the array within that function are reflected in the returned array.
 void filter_getCurrentPowerValues(double powerValues[]) {
+#if defined(FILTER_FIXED_POINT)
+  filterFixed_getCurrentPowerValues(powerValues);
+  return;
+#elif defined(FILTER_SINGLE_PRECISION)
+  filterFloat_getCurrentPowerValues(powerValues);
+  return;
+#endif
   for (uint32_t i = INIT_VAL; i < NUM_IIR_FILTERS; i++) {
     powerValues[i] = currentPowerValue[i];
   }
@@ -445,15 +878,21 @@ const double *filter_getIirBCoefficientArray(uint16_t filterNumber) {
 // Returns the number of B coefficients.
 uint32_t filter_getIirBCoefficientCount() { return IIR_B_COEF_COUNT; }
 
+// Returns the second-order sections for a particular filter number, laid out
+// as filter_getIirSosSectionCount() rows of {b0, b1, b2, a1, a2}.
+const double *filter_getIirSosCoefficientArray(uint16_t filterNumber) {
+  return &iir_sos_coef[filterNumber][INIT_VAL][INIT_VAL];
+}
+
+// Returns the number of second-order sections per IIR filter.
+uint32_t filter_getIirSosSectionCount() { return IIR_SOS_SECTION_COUNT; }
+
 // Returns the size of the yQueue.
 uint32_t filter_getYQueueSize() { return queue_elementCount(&yQueue); }
 
 // Returns the decimation value.
 uint16_t filter_getDecimationValue() { return FIR_DECIMATION_FACTOR; }
 
-// Returns the address of xQueue.
-queue_t *filter_getXQueue() { return &xQueue; }
-
 // Returns the address of yQueue.
 queue_t *filter_getYQueue() { return &yQueue; }
 
@@ -462,9 +901,27 @@ queue_t *filter_getZQueue(uint16_t filterNumber) {
   return &(zQueue[filterNumber]);
 }
 
-// Returns the address of the IIR output-queue for a specific filter-number.
-queue_t *filter_getIirOutputQueue(uint16_t filterNumber) {
-  return &(outputQueue[filterNumber]);
+// Adds value to the power window of IIR filter [filterNumber], as if the
+// filter had just produced it.
+void filter_addPowerWindowValue(uint16_t filterNumber, double value) {
+  addToPowerWindow(filterNumber, value);
 }
 
+// Fills the power window of IIR filter [filterNumber] with fillValue.
+void filter_fillPowerWindow(uint16_t filterNumber, double fillValue) {
+  powerWindow_t *w = &powerWindow[filterNumber];
+  float square = (float)(fillValue * fillValue);
+  for (uint32_t i = INIT_VAL; i < POWER_WINDOW_SIZE; i++) {
+    w->squares[i] = square;
+  }
+  w->index = INIT_VAL;
+  w->newest = square;
+  w->oldest = square;
+  w->sum = INIT_VAL_DOUBLE; // filter_computePower() rebases on index 0
+  w->compensation = INIT_VAL_DOUBLE;
+}
+
+// Returns the number of IIR outputs in each power window.
+uint32_t filter_getPowerWindowSize() { return POWER_WINDOW_SIZE; }
+
 // void filter_runTest();
@@ -13,6 +13,23 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #include "queue.h"
 #include <stdint.h>
 
+// Uncomment to run the detector on the fixed-point filters in filterFixed.c
+// (Q15 FIR, Q31 biquad IIR, exact integer power) instead of the
+// double-precision filters below. filter_getCurrentPowerValue(s)() then report
+// the fixed-point power values.
+//#define FILTER_FIXED_POINT
+
+// Uncomment to run the detector on the single-precision filters in
+// filterFloat.c instead of the double-precision filters below.
+// filter_getCurrentPowerValue(s)() then report the single-precision power
+// values. Don't combine with FILTER_FIXED_POINT.
+//#define FILTER_SINGLE_PRECISION
+
+// Uncomment to have the detector run the original 10th-order direct form IIR
+// filters (filter_iirFilter()) instead of the second-order sections
+// (filter_iirFilterBank()).
+//#define FILTER_IIR_DIRECT_FORM
+
 #define FILTER_SAMPLE_FREQUENCY_IN_KHZ 100
 #define FILTER_FREQUENCY_COUNT 10
 #define FILTER_FIR_DECIMATION_FACTOR                                           \
@@ -43,39 +60,107 @@ static const uint16_t filter_frequencyTickTable[FILTER_FREQUENCY_COUNT] = {
 // Must call this prior to using any filter functions.
 void filter_init();
 
-// Use this to copy an input into the input queue of the FIR-filter (xQueue).
+// Inits only the decimating FIR filter (its input history and yQueue), for
+// callers that don't run the IIR filters, such as the detector's SDFT
+// backend. The IIR functions must not be used until filter_init() is called.
+void filter_initFir();
+
+// Clears all filter state (input histories, IIR state and power windows) as if
+// filter_init() had just been called. Use it to restart the filters after a
+// gap in the input.
+void filter_reset();
+
+// Same as filter_reset() for the FIR filter alone, see filter_initFir().
+void filter_resetFir();
+
+// Use this to copy an input into the input history of the FIR-filter.
 void filter_addNewInput(double x);
 
+// Adds x to the FIR input history and runs filter_firFilter() only once every
+// FILTER_FIR_DECIMATION_FACTOR inputs. Returns true if a new FIR output was
+// computed (and pushed onto yQueue).
+bool filter_decimatingFirFilter(double x);
+
 // Fills a queue with the given fillValue. For example,
 // if the queue is of size 10, and the fillValue = 1.0,
 // after executing this function, the queue will contain 10 values
 // all of them 1.0.
 void filter_fillQueue(queue_t *q, double fillValue);
 
-// Invokes the FIR-filter. Input is contents of xQueue.
-// Output is returned and is also pushed on to yQueue.
+// Fills the FIR input history (see filter_addNewInput()) with the given
+// fillValue, for example to zero it before a test.
+void filter_fillFirHistory(double fillValue);
+
+// Zeroes all of the state of IIR filter [filterNumber]: its zQueue (used by
+// filter_iirFilter()) and its biquad state (used by filter_iirSosFilter() and
+// filter_iirFilterBank()).
+void filter_clearIirState(uint16_t filterNumber);
+
+// Invokes the FIR-filter. Input is the FIR input history (see
+// filter_addNewInput()). Output is returned and is also pushed on to yQueue.
 double filter_firFilter();
 
+// Returns the most recent filter_firFilter() output.
+double filter_getFirOutput();
+
+// Block version of filter_decimatingFirFilter(): adds x[0..count-1] to the
+// input history and writes an output to y[] every FILTER_FIR_DECIMATION_FACTOR
+// inputs. Returns the number of outputs (at most count /
+// FILTER_FIR_DECIMATION_FACTOR + 1). Outputs are not pushed onto yQueue, so
+// filter_iirFilter() can't be used with it; filter_getFirOutput() returns the
+// last one.
+uint32_t filter_decimatingFirFilterBlock(const double x[], uint32_t count,
+                                         double y[]);
+
 // Use this to invoke a single iir filter. Input comes from yQueue.
-// Output is returned and is also pushed onto zQueue[filterNumber].
+// Output is returned, pushed onto zQueue[filterNumber] and added to the power
+// window of the filter.
 double filter_iirFilter(uint16_t filterNumber);
 
-// Use this to compute the power for values contained in an outputQueue.
-// If force == true, then recompute power by using all values in the
-// outputQueue. This option is necessary so that you can correctly compute power
-// values the first time. After that, you can incrementally compute power values
-// by:
-// 1. Keeping track of the power computed in a previous run, call this
-// prev-power.
-// 2. Keeping track of the oldest outputQueue value used in a previous run, call
-// this oldest-value.
-// 3. Get the newest value from the power queue, call this newest-value.
-// 4. Compute new power as: prev-power - (oldest-value * oldest-value) +
-// (newest-value * newest-value). Note that this function will probably need an
-// array to keep track of these values for each of the 10 output queues.
+// Same filter as filter_iirFilter(), run as a cascade of biquads (see
+// filter_getIirSosCoefficientArray()). Input is the latest filter_firFilter()
+// output. Output is returned and is also added to the power window, but not
+// pushed onto zQueue. filter_clearIirState() clears the biquad state.
+double filter_iirSosFilter(uint16_t filterNumber);
+
+// Runs filter_iirSosFilter() for all FILTER_FREQUENCY_COUNT filters at once,
+// vectorized across filters (SSE2 on x86, NEON on 64-bit ARM, scalar
+// otherwise, including on the board: ARMv7 NEON has no double lanes, see
+// filterFloat_iirFilterBank() for the board's NEON bank). Outputs are written
+// to out[] and added to the power windows.
+// Shares its state with filter_iirSosFilter().
+void filter_iirFilterBank(double out[]);
+
+// Block version of filter_iirFilterBank(): runs all of the IIR filters on each
+// FIR output x[0..count-1], writing the outputs of every filter for x[n] to
+// y[n]. Outputs are not added to the power windows; pass them to
+// filter_computePowerBlock(). Bit-for-bit the same outputs as count calls to
+// filter_iirFilterBank().
+void filter_iirFilterBankBlock(const double x[], uint32_t count,
+                               double y[][FILTER_FREQUENCY_COUNT]);
+
+// Use this to compute the power (sum of squares) of the last
+// FILTER_INPUT_PULSE_WIDTH outputs of IIR filter [filterNumber]. The squares
+// are kept in a power window, stored as float.
+// If force == true, then recompute power by summing the whole window. This
+// option is necessary so that you can correctly compute power values the first
+// time. After that, power is computed incrementally as:
+// prev-power - oldest-square + newest-square.
+// The running sum is compensated (Neumaier), so it tracks small powers
+// accurately even after a loud signal has left the window, and is never
+// negative. The window is also summed from scratch every time it wraps around,
+// which bounds the remaining rounding error.
 double filter_computePower(uint16_t filterNumber, bool forceComputeFromScratch,
                            bool debugPrint);
 
+// Block version of filter_computePower() for all filters: adds each row of
+// IIR outputs y[0..count-1] (see filter_iirFilterBankBlock()) to the power
+// windows and writes the power of every filter after row n to power[n]. The
+// results match filter_computePower() called after each filter_iirFilterBank().
+void filter_computePowerBlock(const double y[][FILTER_FREQUENCY_COUNT],
+                              uint32_t count,
+                              double power[][FILTER_FREQUENCY_COUNT]);
+
 // Returns the last-computed output power value for the IIR filter
 // [filterNumber].
 double filter_getCurrentPowerValue(uint16_t filterNumber);
@@ -121,23 +206,34 @@ const double *filter_getIirBCoefficientArray(uint16_t filterNumber);
 // Returns the number of B coefficients.
 uint32_t filter_getIirBCoefficientCount();
 
+// Returns the second-order sections for a particular filter number, laid out
+// as filter_getIirSosSectionCount() rows of {b0, b1, b2, a1, a2}.
+const double *filter_getIirSosCoefficientArray(uint16_t filterNumber);
+
+// Returns the number of second-order sections per IIR filter.
+uint32_t filter_getIirSosSectionCount();
+
 // Returns the size of the yQueue.
 uint32_t filter_getYQueueSize();
 
 // Returns the decimation value.
 uint16_t filter_getDecimationValue();
 
-// Returns the address of xQueue.
-queue_t *filter_getXQueue();
-
 // Returns the address of yQueue.
 queue_t *filter_getYQueue();
 
 // Returns the address of zQueue for a specific filter number.
 queue_t *filter_getZQueue(uint16_t filterNumber);
 
-// Returns the address of the IIR output-queue for a specific filter-number.
-queue_t *filter_getIirOutputQueue(uint16_t filterNumber);
+// Adds value to the power window of IIR filter [filterNumber], as if the
+// filter had just produced it.
+void filter_addPowerWindowValue(uint16_t filterNumber, double value);
+
+// Fills the power window of IIR filter [filterNumber] with fillValue.
+void filter_fillPowerWindow(uint16_t filterNumber, double fillValue);
+
+// Returns the number of IIR outputs in each power window.
+uint32_t filter_getPowerWindowSize();
 
 // void filter_runTest();
 
@@ -0,0 +1,236 @@
+#include "filterFixed.h"
+#include "filter.h"
+#include "windowQueue.h"
+
+// Constants
+#define INIT_VAL 0
+#define NUM_IIR_FILTERS FILTER_FREQUENCY_COUNT
+#define FIR_COEF_COUNT 81
+#define IIR_SOS_SECTION_COUNT 5
+#define IIR_SOS_COEF_COUNT 5 // b0, b1, b2, a1, a2
+#define POWER_WINDOW_SIZE FILTER_INPUT_PULSE_WIDTH
+
+// Inputs use Q15 with one bit of headroom: 1.0 maps to 2^14. The FIR and IIR
+// stages keep that headroom in Q31 (1.0 maps to 2^30).
+#define INPUT_SCALE 16384.0       // 2^14
+#define OUTPUT_SCALE 1073741824.0 // 2^30
+#define ADC_MIDSCALE 2048         // 12-bit unipolar ADC
+#define ADC_TO_INPUT_SHIFT 3      // 12-bit ADC value to Q15 with headroom
+#define FIR_COEF_FRACTION_BITS 15 // Q15
+#define FIR_OUTPUT_SHIFT 1        // Q15 * Q15 (Q29 with headroom) to Q31
+#define IIR_COEF_FRACTION_BITS 29 // Q29, coefficients range over +/-4
+#define IIR_ROUNDING (1LL << (IIR_COEF_FRACTION_BITS - 1))
+// Power is summed from the full Q31 outputs: each square fits in 64 bits
+// (under 2^62) and is split into its upper and lower 32 bits, which are summed
+// separately, so a full window (2000 * 2^32 < 2^43) can't overflow either sum.
+#define POWER_SQUARE_SPLIT_BITS 32
+#define POWER_SQUARE_LOW_MASK 0xFFFFFFFFULL
+#define POWER_HIGH_SCALE 4294967296.0 // 2^32, weight of the high sum
+#define POWER_SCALE 1152921504606846976.0 // 2^60, (2^30)^2
+// Rounding each IIR output to Q31 adds noise of 1/12 LSB^2 per sample, so a
+// window can't resolve less power than this. It is added to every converted
+// power: otherwise quiet filters read exactly 0, the detector's median is 0
+// and a filter whose output is off by a single LSB counts as a hit.
+#define POWER_ROUNDING_NOISE (POWER_WINDOW_SIZE / 12.0)
+
+// Direct form I state for a single biquad.
+typedef struct {
+  filterFixed_q31_t x1, x2; // Previous two inputs.
+  filterFixed_q31_t y1, y2; // Previous two outputs.
+} filterFixed_biquad_t;
+
+// Coefficients, quantized from filter.c at init.
+static filterFixed_q15_t firCoef[FIR_COEF_COUNT];
+static int32_t iirCoef[NUM_IIR_FILTERS][IIR_SOS_SECTION_COUNT]
+                      [IIR_SOS_COEF_COUNT];
+
+// Mirrored FIR history, same as filter.c (see windowQueue.h).
+WINDOW_QUEUE_DEFINE(firInput, filterFixed_q15_t, FIR_COEF_COUNT);
+static firInput_t firHistory;
+static uint16_t firDecimationCount;
+static filterFixed_q31_t firOutput; // Input to all of the IIR filters.
+
+static filterFixed_biquad_t iirState[NUM_IIR_FILTERS][IIR_SOS_SECTION_COUNT];
+
+// IIR outputs for the power computation, one ring per filter.
+static filterFixed_q31_t powerWindow[NUM_IIR_FILTERS][POWER_WINDOW_SIZE];
+static uint32_t powerWindowIndex[NUM_IIR_FILTERS];
+static filterFixed_q31_t newestPowerSample[NUM_IIR_FILTERS];
+static filterFixed_q31_t oldestPowerSample[NUM_IIR_FILTERS];
+static filterFixed_power_t currentPowerValue[NUM_IIR_FILTERS];
+
+// Clamps a 64-bit intermediate to the Q31 range.
+static inline filterFixed_q31_t saturateQ31(int64_t value) {
+  if (value > INT32_MAX)
+    return INT32_MAX;
+  if (value < INT32_MIN)
+    return INT32_MIN;
+  return (filterFixed_q31_t)value;
+}
+
+// Rounds a double to the nearest integer, for coefficient quantization.
+static int64_t roundToInt(double value) {
+  return (int64_t)(value < 0.0 ? value - 0.5 : value + 0.5);
+}
+
+// Must call this prior to using any filterFixed functions.
+void filterFixed_init() {
+  const double *fir = filter_getFirCoefficientArray();
+  for (uint32_t i = INIT_VAL; i < FIR_COEF_COUNT; i++) {
+    firCoef[i] = roundToInt(fir[i] * (1 << FIR_COEF_FRACTION_BITS));
+  }
+  for (uint16_t filterNum = INIT_VAL; filterNum < NUM_IIR_FILTERS;
+       filterNum++) {
+    const double *sos = filter_getIirSosCoefficientArray(filterNum);
+    for (uint32_t s = INIT_VAL; s < IIR_SOS_SECTION_COUNT; s++) {
+      for (uint32_t c = INIT_VAL; c < IIR_SOS_COEF_COUNT; c++) {
+        iirCoef[filterNum][s][c] =
+            roundToInt(sos[s * IIR_SOS_COEF_COUNT + c] *
+                       (1 << IIR_COEF_FRACTION_BITS));
+      }
+      iirState[filterNum][s] = (filterFixed_biquad_t){INIT_VAL};
+    }
+    for (uint32_t i = INIT_VAL; i < POWER_WINDOW_SIZE; i++) {
+      powerWindow[filterNum][i] = INIT_VAL;
+    }
+    powerWindowIndex[filterNum] = INIT_VAL;
+    newestPowerSample[filterNum] = INIT_VAL;
+    oldestPowerSample[filterNum] = INIT_VAL;
+    currentPowerValue[filterNum].high = INIT_VAL;
+    currentPowerValue[filterNum].low = INIT_VAL;
+  }
+  firInput_fill(&firHistory, INIT_VAL);
+  firDecimationCount = INIT_VAL;
+  firOutput = INIT_VAL;
+}
+
+// Converts a raw (unipolar, 12-bit) ADC value to the fixed-point input format.
+filterFixed_q15_t filterFixed_scaleAdcValue(uint32_t adcValue) {
+  return ((int32_t)adcValue - ADC_MIDSCALE) << ADC_TO_INPUT_SHIFT;
+}
+
+// Converts a -1.0 to 1.0 input to the fixed-point input format.
+filterFixed_q15_t filterFixed_scaleInput(double x) {
+  int64_t value = roundToInt(x * INPUT_SCALE);
+  if (value > INT16_MAX)
+    return INT16_MAX;
+  if (value < INT16_MIN)
+    return INT16_MIN;
+  return value;
+}
+
+// Use this to copy an input into the input history of the FIR-filter.
+void filterFixed_addNewInput(filterFixed_q15_t x) {
+  firInput_push(&firHistory, x);
+}
+
+// Adds x to the FIR input history and runs the FIR filter once every
+// FILTER_FIR_DECIMATION_FACTOR inputs. Returns true if it ran.
+bool filterFixed_decimatingFirFilter(filterFixed_q15_t x) {
+  filterFixed_addNewInput(x);
+  if (++firDecimationCount < FILTER_FIR_DECIMATION_FACTOR)
+    return false;
+  firDecimationCount = INIT_VAL;
+  filterFixed_firFilter();
+  return true;
+}
+
+// Invokes the FIR-filter. Q15 x Q15 products are accumulated in 64 bits and
+// the result is saturated to Q31.
+filterFixed_q31_t filterFixed_firFilter() {
+  // oldest first
+  const filterFixed_q15_t *x = firInput_window(&firHistory, FIR_COEF_COUNT);
+  int64_t acc = INIT_VAL;
+  for (uint32_t i = INIT_VAL; i < FIR_COEF_COUNT; i++) {
+    acc += (int32_t)x[FIR_COEF_COUNT - 1 - i] * firCoef[i];
+  }
+  firOutput = saturateQ31(acc << FIR_OUTPUT_SHIFT);
+  return firOutput;
+}
+
+// Runs a single IIR filter (a cascade of direct form I biquads) on the latest
+// FIR output and adds the result to the power window.
+filterFixed_q31_t filterFixed_iirFilter(uint16_t filterNumber) {
+  filterFixed_q31_t x = firOutput;
+  for (uint32_t s = INIT_VAL; s < IIR_SOS_SECTION_COUNT; s++) {
+    const int32_t *c = iirCoef[filterNumber][s];
+    filterFixed_biquad_t *state = &iirState[filterNumber][s];
+    // Q31 * Q29, at most ~2^62 in magnitude since |a1| < 2 and |a2| < 1.
+    int64_t acc = (int64_t)c[0] * x + (int64_t)c[1] * state->x1 +
+                  (int64_t)c[2] * state->x2 - (int64_t)c[3] * state->y1 -
+                  (int64_t)c[4] * state->y2;
+    filterFixed_q31_t y =
+        saturateQ31((acc + IIR_ROUNDING) >> IIR_COEF_FRACTION_BITS);
+    state->x2 = state->x1;
+    state->x1 = x;
+    state->y2 = state->y1;
+    state->y1 = y;
+    x = y; // output of this section feeds the next one
+  }
+  // push the output into the power window, remembering what fell out
+  uint32_t index = powerWindowIndex[filterNumber];
+  oldestPowerSample[filterNumber] = powerWindow[filterNumber][index];
+  newestPowerSample[filterNumber] = x;
+  powerWindow[filterNumber][index] = x;
+  if (++index >= POWER_WINDOW_SIZE)
+    index = INIT_VAL;
+  powerWindowIndex[filterNumber] = index;
+  return x;
+}
+
+// Returns the exact square of a Q31 value.
+static inline uint64_t square(filterFixed_q31_t x) {
+  return (uint64_t)((int64_t)x * x);
+}
+
+// Computes the power over the last POWER_WINDOW_SIZE outputs of IIR filter
+// [filterNumber]. The incremental update is exact integer arithmetic: both
+// sums only ever hold whole squares, so subtracting the oldest one wraps back
+// to exactly the from-scratch value.
+filterFixed_power_t filterFixed_computePower(uint16_t filterNumber,
+                                             bool forceComputeFromScratch) {
+  filterFixed_power_t power = {INIT_VAL, INIT_VAL};
+  if (forceComputeFromScratch) {
+    for (uint32_t i = INIT_VAL; i < POWER_WINDOW_SIZE; i++) {
+      uint64_t sq = square(powerWindow[filterNumber][i]);
+      power.high += sq >> POWER_SQUARE_SPLIT_BITS;
+      power.low += sq & POWER_SQUARE_LOW_MASK;
+    }
+  } else {
+    uint64_t newSq = square(newestPowerSample[filterNumber]);
+    uint64_t oldSq = square(oldestPowerSample[filterNumber]);
+    power = currentPowerValue[filterNumber];
+    power.high += (newSq >> POWER_SQUARE_SPLIT_BITS) -
+                  (oldSq >> POWER_SQUARE_SPLIT_BITS);
+    power.low += (newSq & POWER_SQUARE_LOW_MASK) -
+                 (oldSq & POWER_SQUARE_LOW_MASK);
+  }
+  currentPowerValue[filterNumber] = power;
+  return power;
+}
+
+// Returns the last-computed power value for IIR filter [filterNumber].
+filterFixed_power_t filterFixed_getCurrentPowerValue(uint16_t filterNumber) {
+  return currentPowerValue[filterNumber];
+}
+
+// Converts a fixed-point power value to the units used by filter.c, adding the
+// power of the Q31 rounding noise.
+double filterFixed_powerToDouble(filterFixed_power_t power) {
+  return ((double)power.high * POWER_HIGH_SCALE + (double)power.low +
+          POWER_ROUNDING_NOISE) /
+         POWER_SCALE;
+}
+
+// Converts a fixed-point filter output to the units used by filter.c.
+double filterFixed_outputToDouble(filterFixed_q31_t output) {
+  return (double)output / OUTPUT_SCALE;
+}
+
+// Copies the current power values, converted to the units used by filter.c,
+// into powerValues[].
+void filterFixed_getCurrentPowerValues(double powerValues[]) {
+  for (uint16_t i = INIT_VAL; i < NUM_IIR_FILTERS; i++) {
+    powerValues[i] = filterFixed_powerToDouble(currentPowerValue[i]);
+  }
+}
@@ -0,0 +1,87 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef FILTERFIXED_H_
+#define FILTERFIXED_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Fixed-point version of the filter.c pipeline. Same structure: a decimating
+// FIR filter followed by a bank of 10 IIR bandpass filters and a running
+// power computation, but with integer arithmetic throughout:
+// 1. ADC samples are converted straight to Q15 (with one bit of headroom, so
+// full scale is +/-0.5) and the FIR filter uses Q15 coefficients with a 64-bit
+// accumulator. Its output is Q31.
+// 2. Each IIR filter is the biquad cascade from
+// filter_getIirSosCoefficientArray() with Q29 coefficients, Q31 state and
+// saturation at every section output.
+// 3. Power is the integer sum of the squares of the full-precision IIR outputs,
+// kept in two 64-bit halves so that it can't overflow, and is updated exactly,
+// so it never drifts. filterFixed_powerToDouble() converts it to the same
+// units that filter_computePower() returns, plus the power of the rounding
+// noise, below which the fixed-point filters can't resolve anything.
+// Select it for the detector with FILTER_FIXED_POINT in filter.h.
+
+typedef int16_t filterFixed_q15_t;   // 1 sign bit, 15 fraction bits.
+typedef int32_t filterFixed_q31_t;   // 1 sign bit, 31 fraction bits.
+// Exact sum of squares of Q31 values: high * 2^32 + low. See
+// filterFixed_powerToDouble().
+typedef struct {
+  uint64_t high; // Sum of the upper 32 bits of each square.
+  uint64_t low;  // Sum of the lower 32 bits of each square.
+} filterFixed_power_t;
+
+// Must call this prior to using any filterFixed functions.
+void filterFixed_init();
+
+// Converts a raw (unipolar, 12-bit) ADC value to the fixed-point input format.
+filterFixed_q15_t filterFixed_scaleAdcValue(uint32_t adcValue);
+
+// Converts a -1.0 to 1.0 input, as produced by detector_getScaledAdcValue(),
+// to the fixed-point input format. Used to compare against filter.c.
+filterFixed_q15_t filterFixed_scaleInput(double x);
+
+// Use this to copy an input into the input history of the FIR-filter.
+void filterFixed_addNewInput(filterFixed_q15_t x);
+
+// Adds x to the FIR input history and runs filterFixed_firFilter() only once
+// every FILTER_FIR_DECIMATION_FACTOR inputs. Returns true if a new FIR output
+// was computed.
+bool filterFixed_decimatingFirFilter(filterFixed_q15_t x);
+
+// Invokes the FIR-filter. Output is returned and becomes the input for the
+// next call to filterFixed_iirFilter().
+filterFixed_q31_t filterFixed_firFilter();
+
+// Runs a single IIR filter on the latest FIR output. Output is returned and is
+// also added to the power window for filterNumber.
+filterFixed_q31_t filterFixed_iirFilter(uint16_t filterNumber);
+
+// Computes the power over the last FILTER_INPUT_PULSE_WIDTH outputs of IIR
+// filter [filterNumber]. Incremental by default; if forceComputeFromScratch is
+// true, the whole window is summed again.
+filterFixed_power_t filterFixed_computePower(uint16_t filterNumber,
+                                             bool forceComputeFromScratch);
+
+// Returns the last-computed power value for IIR filter [filterNumber].
+filterFixed_power_t filterFixed_getCurrentPowerValue(uint16_t filterNumber);
+
+// Converts a fixed-point power value to the units used by filter.c, adding the
+// power of the Q31 rounding noise so that no filter reads exactly 0.
+double filterFixed_powerToDouble(filterFixed_power_t power);
+
+// Converts a fixed-point filter output to the units used by filter.c.
+double filterFixed_outputToDouble(filterFixed_q31_t output);
+
+// Copies the current power values, converted to the units used by filter.c,
+// into powerValues[].
+void filterFixed_getCurrentPowerValues(double powerValues[]);
+
+#endif /* FILTERFIXED_H_ */
@@ -0,0 +1,223 @@
+#include "filterFloat.h"
+#include "filter.h"
+#include "windowQueue.h"
+#include <math.h>
+
+// SIMD support for filterFloat_iirFilterBank(). Unlike the double bank in
+// filter.c, this also covers the 32-bit NEON unit on the Cortex-A9. The board
+// build compiles this file alone with -mfpu=neon (see lasertag/CMakeLists.txt).
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#define FILTER_FLOAT_BANK_SSE
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define FILTER_FLOAT_BANK_NEON
+#endif
+
+// Constants
+#define INIT_VAL 0
+#define INIT_VAL_FLOAT 0.0f
+#define NUM_IIR_FILTERS FILTER_FREQUENCY_COUNT
+#define FIR_COEF_COUNT 81
+#define IIR_SOS_SECTION_COUNT 5
+#define IIR_SOS_COEF_COUNT 5 // b0, b1, b2, a1, a2
+#define POWER_WINDOW_SIZE FILTER_INPUT_PULSE_WIDTH
+#define BANK_LANE_COUNT 4 // floats per SIMD register
+// Filters in the bank, padded to whole registers. The padding filters have
+// zero coefficients and are never read.
+#define BANK_FILTER_COUNT                                                      \
+  ((NUM_IIR_FILTERS + BANK_LANE_COUNT - 1) / BANK_LANE_COUNT * BANK_LANE_COUNT)
+
+// Sliding window of squared IIR outputs, same scheme as filter.c.
+typedef struct {
+  float squares[POWER_WINDOW_SIZE];
+  uint32_t index;     // Next slot to write, also the oldest square.
+  float newest;       // Square added by the latest IIR output.
+  float oldest;       // Square it replaced.
+  float sum;          // Running sum of squares.
+  float compensation; // Low-order bits lost by sum (Neumaier).
+} filterFloat_powerWindow_t;
+
+static float firCoef[FIR_COEF_COUNT];
+// Mirrored FIR history, same as filter.c (see windowQueue.h).
+WINDOW_QUEUE_DEFINE(firInput, float, FIR_COEF_COUNT);
+static firInput_t firHistory;
+static uint16_t firDecimationCount;
+static float firOutput; // Input to all of the IIR filters.
+
+// Biquad coefficients and state laid out [section][filter] so that each
+// section can be run on a register of filters at once.
+static float bankCoef[IIR_SOS_SECTION_COUNT][IIR_SOS_COEF_COUNT]
+                     [BANK_FILTER_COUNT];
+static float bankS1[IIR_SOS_SECTION_COUNT][BANK_FILTER_COUNT];
+static float bankS2[IIR_SOS_SECTION_COUNT][BANK_FILTER_COUNT];
+
+static filterFloat_powerWindow_t powerWindow[NUM_IIR_FILTERS];
+static float currentPowerValue[NUM_IIR_FILTERS];
+
+// Must call this prior to using any filterFloat functions.
+void filterFloat_init() {
+  const double *fir = filter_getFirCoefficientArray();
+  for (uint32_t i = INIT_VAL; i < FIR_COEF_COUNT; i++) {
+    firCoef[i] = (float)fir[i];
+  }
+  firInput_fill(&firHistory, INIT_VAL_FLOAT);
+  firDecimationCount = INIT_VAL;
+  firOutput = INIT_VAL_FLOAT;
+  for (uint32_t s = INIT_VAL; s < IIR_SOS_SECTION_COUNT; s++) {
+    for (uint16_t f = INIT_VAL; f < BANK_FILTER_COUNT; f++) {
+      const double *sos =
+          f < NUM_IIR_FILTERS ? filter_getIirSosCoefficientArray(f) : NULL;
+      for (uint32_t c = INIT_VAL; c < IIR_SOS_COEF_COUNT; c++) {
+        bankCoef[s][c][f] =
+            sos ? (float)sos[s * IIR_SOS_COEF_COUNT + c] : INIT_VAL_FLOAT;
+      }
+      bankS1[s][f] = INIT_VAL_FLOAT;
+      bankS2[s][f] = INIT_VAL_FLOAT;
+    }
+  }
+  for (uint16_t f = INIT_VAL; f < NUM_IIR_FILTERS; f++) {
+    filterFloat_powerWindow_t *w = &powerWindow[f];
+    for (uint32_t i = INIT_VAL; i < POWER_WINDOW_SIZE; i++) {
+      w->squares[i] = INIT_VAL_FLOAT;
+    }
+    w->index = INIT_VAL;
+    w->newest = w->oldest = INIT_VAL_FLOAT;
+    w->sum = w->compensation = INIT_VAL_FLOAT;
+    currentPowerValue[f] = INIT_VAL_FLOAT;
+  }
+}
+
+// Use this to copy an input into the input history of the FIR-filter.
+void filterFloat_addNewInput(float x) { firInput_push(&firHistory, x); }
+
+// Adds x to the FIR input history and runs the FIR filter once every
+// FILTER_FIR_DECIMATION_FACTOR inputs. Returns true if it ran.
+bool filterFloat_decimatingFirFilter(float x) {
+  filterFloat_addNewInput(x);
+  if (++firDecimationCount < FILTER_FIR_DECIMATION_FACTOR)
+    return false;
+  firDecimationCount = INIT_VAL;
+  filterFloat_firFilter();
+  return true;
+}
+
+// Invokes the FIR-filter.
+float filterFloat_firFilter() {
+  // oldest first
+  const float *x = firInput_window(&firHistory, FIR_COEF_COUNT);
+  float y = INIT_VAL_FLOAT;
+  for (uint32_t i = INIT_VAL; i < FIR_COEF_COUNT; i++) {
+    y += x[FIR_COEF_COUNT - 1 - i] * firCoef[i];
+  }
+  firOutput = y;
+  return y;
+}
+
+// Adds the square of output to the power window of filter [filterNumber].
+static void addToPowerWindow(uint16_t filterNumber, float output) {
+  filterFloat_powerWindow_t *w = &powerWindow[filterNumber];
+  w->oldest = w->squares[w->index];
+  w->newest = output * output;
+  w->squares[w->index] = w->newest;
+  if (++w->index >= POWER_WINDOW_SIZE)
+    w->index = INIT_VAL;
+}
+
+// Runs all of the IIR filters on the latest FIR output, one section at a time
+// for every filter, a register of filters at a time where SIMD is available.
+void filterFloat_iirFilterBank(float out[]) {
+  float lanes[BANK_FILTER_COUNT];
+  for (uint16_t f = INIT_VAL; f < BANK_FILTER_COUNT; f++) {
+    lanes[f] = firOutput; // every filter starts from the same input
+  }
+  for (uint32_t s = INIT_VAL; s < IIR_SOS_SECTION_COUNT; s++) {
+    const float *b0 = bankCoef[s][0];
+    const float *b1 = bankCoef[s][1];
+    const float *b2 = bankCoef[s][2];
+    const float *a1 = bankCoef[s][3];
+    const float *a2 = bankCoef[s][4];
+    float *s1 = bankS1[s];
+    float *s2 = bankS2[s];
+    for (uint16_t f = INIT_VAL; f < BANK_FILTER_COUNT; f += BANK_LANE_COUNT) {
+#if defined(FILTER_FLOAT_BANK_SSE)
+      __m128 x = _mm_loadu_ps(&lanes[f]);
+      __m128 y = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&b0[f]), x),
+                            _mm_loadu_ps(&s1[f]));
+      __m128 n1 = _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(&b1[f]), x),
+                             _mm_mul_ps(_mm_loadu_ps(&a1[f]), y));
+      _mm_storeu_ps(&s1[f], _mm_add_ps(n1, _mm_loadu_ps(&s2[f])));
+      _mm_storeu_ps(&s2[f], _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(&b2[f]), x),
+                                       _mm_mul_ps(_mm_loadu_ps(&a2[f]), y)));
+      _mm_storeu_ps(&lanes[f], y);
+#elif defined(FILTER_FLOAT_BANK_NEON)
+      float32x4_t x = vld1q_f32(&lanes[f]);
+      float32x4_t y =
+          vaddq_f32(vmulq_f32(vld1q_f32(&b0[f]), x), vld1q_f32(&s1[f]));
+      float32x4_t n1 = vsubq_f32(vmulq_f32(vld1q_f32(&b1[f]), x),
+                                 vmulq_f32(vld1q_f32(&a1[f]), y));
+      vst1q_f32(&s1[f], vaddq_f32(n1, vld1q_f32(&s2[f])));
+      vst1q_f32(&s2[f], vsubq_f32(vmulq_f32(vld1q_f32(&b2[f]), x),
+                                  vmulq_f32(vld1q_f32(&a2[f]), y)));
+      vst1q_f32(&lanes[f], y);
+#else
+      for (uint16_t i = f; i < f + BANK_LANE_COUNT; i++) {
+        float x = lanes[i];
+        float y = b0[i] * x + s1[i];
+        s1[i] = b1[i] * x - a1[i] * y + s2[i];
+        s2[i] = b2[i] * x - a2[i] * y;
+        lanes[i] = y;
+      }
+#endif
+    }
+  }
+  for (uint16_t f = INIT_VAL; f < NUM_IIR_FILTERS; f++) {
+    out[f] = lanes[f];
+    addToPowerWindow(f, lanes[f]);
+  }
+}
+
+// adds value to a compensated (Neumaier) sum, see filter.c
+static inline void compensatedAdd(float *sum, float *compensation,
+                                  float value) {
+  float t = *sum + value;
+  if (fabsf(*sum) >= fabsf(value))
+    *compensation += (*sum - t) + value;
+  else
+    *compensation += (value - t) + *sum;
+  *sum = t;
+}
+
+// Computes the power over the last POWER_WINDOW_SIZE outputs of IIR filter
+// [filterNumber]. The window is summed from scratch when forced and each time
+// it wraps.
+float filterFloat_computePower(uint16_t filterNumber,
+                               bool forceComputeFromScratch) {
+  filterFloat_powerWindow_t *w = &powerWindow[filterNumber];
+  if (forceComputeFromScratch || w->index == INIT_VAL) {
+    w->sum = w->compensation = INIT_VAL_FLOAT;
+    for (uint32_t i = INIT_VAL; i < POWER_WINDOW_SIZE; i++) {
+      compensatedAdd(&w->sum, &w->compensation, w->squares[i]);
+    }
+  } else {
+    compensatedAdd(&w->sum, &w->compensation, w->newest);
+    compensatedAdd(&w->sum, &w->compensation, -w->oldest);
+  }
+  float power = w->sum + w->compensation;
+  if (power < INIT_VAL_FLOAT) // squares can't sum to less than zero
+    power = INIT_VAL_FLOAT;
+  currentPowerValue[filterNumber] = power;
+  return power;
+}
+
+// Returns the last-computed power value for IIR filter [filterNumber].
+float filterFloat_getCurrentPowerValue(uint16_t filterNumber) {
+  return currentPowerValue[filterNumber];
+}
+
+// Copies the current power values into powerValues[].
+void filterFloat_getCurrentPowerValues(double powerValues[]) {
+  for (uint16_t i = INIT_VAL; i < NUM_IIR_FILTERS; i++) {
+    powerValues[i] = currentPowerValue[i];
+  }
+}
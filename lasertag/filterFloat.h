@@ -0,0 +1,62 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef FILTERFLOAT_H_
+#define FILTERFLOAT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Single-precision version of the filter.c pipeline: the decimating FIR filter,
+// the bank of 10 IIR filters and the running power computation, with all
+// coefficients and state in float. The VFP on the Cortex-A9 is faster in
+// single precision and its NEON unit only has float lanes, so the IIR bank
+// runs four filters per NEON (or SSE) register. The board build compiles
+// filterFloat.c with -mfpu=neon for this; without it __ARM_NEON isn't defined
+// and the bank falls back to a scalar loop.
+// 1. The FIR filter keeps a mirrored float input history, like filter.c.
+// 2. Each IIR filter is the biquad cascade from
+// filter_getIirSosCoefficientArray() in transposed direct form II. The 10th
+// order direct form coefficients are far too large for float.
+// 3. Power is a compensated float sum of the squares in the window, summed
+// from scratch each time the window wraps, like filter_computePower().
+// Select it for the detector with FILTER_SINGLE_PRECISION in filter.h.
+
+// Must call this prior to using any filterFloat functions.
+void filterFloat_init();
+
+// Use this to copy an input into the input history of the FIR-filter.
+void filterFloat_addNewInput(float x);
+
+// Adds x to the FIR input history and runs filterFloat_firFilter() only once
+// every FILTER_FIR_DECIMATION_FACTOR inputs. Returns true if a new FIR output
+// was computed.
+bool filterFloat_decimatingFirFilter(float x);
+
+// Invokes the FIR-filter. Output is returned and becomes the input for the
+// next call to filterFloat_iirFilterBank().
+float filterFloat_firFilter();
+
+// Runs all of the IIR filters on the latest FIR output. Outputs are written to
+// out[] and added to the power windows.
+void filterFloat_iirFilterBank(float out[]);
+
+// Computes the power over the last FILTER_INPUT_PULSE_WIDTH outputs of IIR
+// filter [filterNumber]. Incremental by default; if forceComputeFromScratch is
+// true, the whole window is summed again.
+float filterFloat_computePower(uint16_t filterNumber,
+                               bool forceComputeFromScratch);
+
+// Returns the last-computed power value for IIR filter [filterNumber].
+float filterFloat_getCurrentPowerValue(uint16_t filterNumber);
+
+// Copies the current power values into powerValues[].
+void filterFloat_getCurrentPowerValues(double powerValues[]);
+
+#endif /* FILTERFLOAT_H_ */
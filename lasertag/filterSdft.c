@@ -0,0 +1,103 @@
+#include "filterSdft.h"
+#include "filter.h"
+#include <math.h>
+
+// Constants
+#define INIT_VAL 0
+#define INIT_VAL_DOUBLE 0.0
+#define NUM_BINS FILTER_FREQUENCY_COUNT
+#define HISTORY_SIZE FILTER_INPUT_PULSE_WIDTH
+#define TWO_PI 6.283185307179586
+// Scales |X|^2 so an in-band sine of amplitude A reads A^2 * HISTORY_SIZE / 2,
+// the sum of squares filter_computePower() sees over a full window.
+#define POWER_SCALE (2.0 * HISTORY_SIZE)
+
+// Last HISTORY_SIZE inputs. historyIndex is the next slot to write, which is
+// also the oldest input.
+static double history[HISTORY_SIZE];
+static uint32_t historyIndex;
+
+// Per-bin twiddle W = e^(j*omega), W^HISTORY_SIZE (the phase of the input
+// leaving the window) and the running DFT value.
+static double twiddleRe[NUM_BINS];
+static double twiddleIm[NUM_BINS];
+static double leavingRe[NUM_BINS];
+static double leavingIm[NUM_BINS];
+static double binRe[NUM_BINS];
+static double binIm[NUM_BINS];
+// Bin that gets recomputed from the history on the next history wrap.
+static uint16_t rebaseBin;
+
+// Recomputes bin [bin] from the history, X = sum of x[n-m] * W^(m+1). Rounding
+// in the recursive update never cancels exactly, so each bin is refreshed
+// once every NUM_BINS history wraps.
+static void rebase(uint16_t bin) {
+  double re = INIT_VAL_DOUBLE;
+  double im = INIT_VAL_DOUBLE;
+  double pRe = twiddleRe[bin]; // W^(m+1), starting at m = 0
+  double pIm = twiddleIm[bin];
+  uint32_t index = historyIndex;
+  for (uint32_t m = INIT_VAL; m < HISTORY_SIZE; m++) {
+    index = (index == INIT_VAL) ? HISTORY_SIZE - 1 : index - 1; // newest first
+    re += history[index] * pRe;
+    im += history[index] * pIm;
+    double t = pRe * twiddleRe[bin] - pIm * twiddleIm[bin];
+    pIm = pRe * twiddleIm[bin] + pIm * twiddleRe[bin];
+    pRe = t;
+  }
+  binRe[bin] = re;
+  binIm[bin] = im;
+}
+
+// Must call this prior to using any filterSdft functions.
+void filterSdft_init() {
+  for (uint32_t i = INIT_VAL; i < HISTORY_SIZE; i++) {
+    history[i] = INIT_VAL_DOUBLE;
+  }
+  historyIndex = INIT_VAL;
+  for (uint16_t bin = INIT_VAL; bin < NUM_BINS; bin++) {
+    // tone frequency in radians per decimated sample
+    double omega =
+        TWO_PI * FILTER_FIR_DECIMATION_FACTOR / filter_frequencyTickTable[bin];
+    twiddleRe[bin] = cos(omega);
+    twiddleIm[bin] = sin(omega);
+    leavingRe[bin] = cos(omega * HISTORY_SIZE);
+    leavingIm[bin] = sin(omega * HISTORY_SIZE);
+    binRe[bin] = INIT_VAL_DOUBLE;
+    binIm[bin] = INIT_VAL_DOUBLE;
+  }
+  rebaseBin = INIT_VAL;
+}
+
+// Adds one decimated input (FIR output) and updates every bin.
+void filterSdft_addNewInput(double x) {
+  double oldest = history[historyIndex]; // leaves every window now
+  for (uint16_t bin = INIT_VAL; bin < NUM_BINS; bin++) {
+    double re = binRe[bin] + x - leavingRe[bin] * oldest;
+    double im = binIm[bin] - leavingIm[bin] * oldest;
+    binRe[bin] = re * twiddleRe[bin] - im * twiddleIm[bin];
+    binIm[bin] = re * twiddleIm[bin] + im * twiddleRe[bin];
+  }
+  history[historyIndex] = x;
+  if (++historyIndex >= HISTORY_SIZE) {
+    historyIndex = INIT_VAL;
+    rebase(rebaseBin); // one bin per wrap keeps the cost negligible
+    if (++rebaseBin >= NUM_BINS)
+      rebaseBin = INIT_VAL;
+  }
+}
+
+// Returns the power in the bin for frequency [filterNumber].
+double filterSdft_computePower(uint16_t filterNumber) {
+  return POWER_SCALE *
+         (binRe[filterNumber] * binRe[filterNumber] +
+          binIm[filterNumber] * binIm[filterNumber]) /
+         ((double)HISTORY_SIZE * HISTORY_SIZE);
+}
+
+// Computes the power of every bin into powerValues[].
+void filterSdft_getCurrentPowerValues(double powerValues[]) {
+  for (uint16_t bin = INIT_VAL; bin < NUM_BINS; bin++) {
+    powerValues[bin] = filterSdft_computePower(bin);
+  }
+}
@@ -0,0 +1,40 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef FILTERSDFT_H_
+#define FILTERSDFT_H_
+
+#include <stdint.h>
+
+// Sliding-DFT alternative to the IIR filter bank. The user frequencies are
+// fixed tones, so instead of bandpass filtering and summing squares, each
+// frequency gets a single DFT bin that slides over the decimated (FIR output)
+// stream:
+// 1. Every bin is centred exactly on its tone and covers the last
+// FILTER_INPUT_PULSE_WIDTH inputs, the same window the IIR power uses. The
+// update is X = W * (X + newest - W^N * oldest) with W = e^(j*omega).
+// 2. All bins share one FILTER_INPUT_PULSE_WIDTH-deep input history instead of
+// a 2000-deep output queue per filter.
+// 3. Power is reported on the same scale as filter_computePower() for an
+// in-band tone, so the detector's threshold works unchanged.
+// Selected at run time with detector_initWithBackend().
+
+// Must call this prior to using any filterSdft functions.
+void filterSdft_init();
+
+// Adds one decimated input (FIR output) and updates every bin.
+void filterSdft_addNewInput(double x);
+
+// Returns the power in the bin for frequency [filterNumber].
+double filterSdft_computePower(uint16_t filterNumber);
+
+// Computes the power of every bin into powerValues[].
+void filterSdft_getCurrentPowerValues(double powerValues[]);
+
+#endif /* FILTERSDFT_H_ */
@@ -31,9 +31,12 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
  ****************************************************************************************************/
 //#define FILTER_TEST_STORE_OLD_VALUE_IN_QUEUE
 
+#include "detector.h"
 #include "filter.h"
+#include "filterFixed.h"
+#include "filterFloat.h"
+#include "filterSdft.h"
 #ifdef ADC_THROUGH_DETECTOR_FILTER_TEST
-#include "detector.h"
 #include "isr.h"
 #endif
 #include "histogram.h"
@@ -368,8 +371,8 @@ void filterTest_runSquareWaveFirPowerTest(bool printMessageFlag,
                                                  // go here.
   uint16_t freqCount = 0;                        // Used to print info message.
   // Simulate running everything at 100 kHz. Simply add either 1.0 or -1.0 to
-  // xQueue based upon the the frequency you are simulating. Iterate over all of
-  // the test-periods.
+  // the FIR input based upon the the frequency you are simulating. Iterate
+  // over all of the test-periods.
   double xValues[PLOT_VALUE_MAX_COUNT]; // Store the x-values here.
   double yValues[PLOT_VALUE_MAX_COUNT]; // Store the y-values here.
   for (uint16_t testPeriodIndex = 0;
@@ -429,7 +432,7 @@ void filterTest_runSquareWaveFirPowerTest(bool printMessageFlag,
                                  currentPeriodTickCount * PERIODS_TO_PLOT);
       utils_msDelay(INPUT_PLOT_VIEW_DELAY);
     }
-#ifdef DETECTOR_H_
+#ifdef ADC_THROUGH_DETECTOR_FILTER_TEST
     bool interruptsEnabled = false; // Need to tell the detector that interrupts
                                     // are not currently enabled.
     detector(interruptsEnabled, false); // Run the detector so that it runs the
@@ -506,9 +509,7 @@ void filterTest_plotIirFrequencyResponse(double iirPowerValues[],
 
 // Fills the queue with the fillValue, overwriting all previous contents.
 void filterTest_fillQueue(queue_t *q, double fillValue) {
-  for (queue_size_t i = 0; i < q->size; i++) {
-    queue_overwritePush(q, fillValue);
-  }
+  filter_fillQueue(q, fillValue);
 }
 
 // Plots frequency response for the selected filterNumber against the 10
@@ -539,7 +540,7 @@ void filterTest_runSquareWaveIirPowerTest(uint16_t filterNumber,
   for (uint16_t testPeriodIndex = 0; testPeriodIndex < FILTER_FREQUENCY_COUNT;
        testPeriodIndex++) { // Only use the first 10 standard frequencies.
     double power = 0.0;
-    filterTest_fillQueue(filter_getXQueue(), 0.0); // zero out the x-queue.
+    filter_fillFirHistory(0.0);                    // zero out the FIR input.
     filterTest_fillQueue(filter_getYQueue(), 0.0); // zero out the x-queue.
     filterTest_fillQueue(
         filter_getZQueue(filterNumber),
@@ -601,9 +602,9 @@ void filterTest_runSquareWaveIirPowerTest(uint16_t filterNumber,
       testPeriodPowerValue, filterNumber); // Finally, plot the results.
 }
 
-// Pushes a single 1.0 through the xQueue. Golden output data are just the FIR
-// coefficients in reverse order. If this test passes, you are multiplying the
-// coefficient with the correct element of xQueue. This is equivalent to passing
+// Pushes a single 1.0 through the FIR input. Golden output data are just the
+// FIR coefficients in reverse order. If this test passes, you are multiplying
+// the coefficient with the correct input. This is equivalent to passing
 // the filter over an input containing only a delta function and thus returns
 // the impulse response.
 bool filterTest_runFirAlignmentTest(bool printMessageFlag) {
@@ -611,9 +612,9 @@ bool filterTest_runFirAlignmentTest(bool printMessageFlag) {
     printf("Must call filterTest_init() before running any filter tests.\n");
     return false;
   }
-  bool success = true;                           // Be optimistic.
-  filterTest_fillQueue(filter_getXQueue(), 0.0); // zero-out the xQueue.
-  filter_addNewInput(1.0); // Place a single 1.0 in the xQueue.
+  bool success = true;        // Be optimistic.
+  filter_fillFirHistory(0.0); // zero-out the FIR input.
+  filter_addNewInput(1.0);    // Place a single 1.0 in the FIR input.
   for (uint32_t i = 0; i < filter_getFirCoefficientCount();
        i++) { // Push the single 1.0 through the queue.
     double firValue = filter_firFilter(); // Run the FIR filter.
@@ -643,23 +644,23 @@ bool filterTest_runFirAlignmentTest(bool printMessageFlag) {
   return success; // Return the success of failure of this test.
 }
 
-// Pushes a series of 1.0 values though xQueue. Golden output data is the sum of
-// the coefficients in reverse order. The FIR-filter is probably computing
+// Pushes a series of 1.0 values though the FIR. Golden output data is the sum
+// of the coefficients in reverse order. The FIR-filter is probably computing
 // outputs correctly if you pass this test.
 bool filterTest_runFirArithmeticTest(bool printMessageFlag) {
   if (!filterTest_initFlag) {
     printf("Must call filterTest_init() before running any filter tests.\n");
     return false;
   }
-  bool success = true;                       // Be optimistic.
-  filter_fillQueue(filter_getXQueue(), 0.0); // zero-out the xQueue.
+  bool success = true;        // Be optimistic.
+  filter_fillFirHistory(0.0); // zero-out the FIR input.
   double firGoldenOutput =
       0.0; // You will compute the golden output by accumulating the FIR
            // coefficients in reverse order.
   for (uint32_t i = 0; i < filter_getFirCoefficientCount();
        i++) { // Loop enough times to go through the coefficients.
-    double newTestInput = 1.0;            // Only value in the xQueue is 1.0.
-    filter_addNewInput(newTestInput);     // Add a 1.0 in the xQueue.
+    double newTestInput = 1.0;            // Only input value is 1.0.
+    filter_addNewInput(newTestInput);     // Add a 1.0 to the FIR input.
     double firValue = filter_firFilter(); // Run the FIR filter.
     firGoldenOutput +=
         newTestInput *
@@ -852,46 +853,52 @@ double filterTest_computeGoldenPowerValue(queue_t *q) {
 
 // Performs a test of the filter_computePower() function.
 // This test:
-// 1. fills all 10 IIR output queues with random values,
+// 1. fills all 10 IIR power windows with random values, keeping a copy of the
+//    values in a golden queue,
 // 2. compares the results of filter_computePower with a golden computed output
-//    for all 10 output queues.
-// Tests both forced and incremental modes.
+//    for all 10 power windows.
+// Tests both forced and incremental modes. The power windows store squares as
+// float, so the random values are on a 12-bit grid (like the ADC) whose
+// squares are exact in float and the golden values can be matched exactly.
 #define TEST_PASS_EPSILON 10E-11 // Should be in this range.
 #define TEST_INCREMENTAL_LOOP_COUNT                                            \
   3000 // Loop over the incremental test this many times.
 #define OUTPUT_QUEUE_SIZE 2000
+#define TEST_RANDOM_VALUE_STEPS 4096.0 // Random values are multiples of 1/4096.
+// Random value between 0 and 1 on the grid described above.
+double filterTest_randomPowerTestValue() {
+  return round(filterTest_randomValue0To1() * TEST_RANDOM_VALUE_STEPS) /
+         TEST_RANDOM_VALUE_STEPS;
+}
+
 bool filterTest_runPowerTest() {
   bool firstComputeStatus = true; // Be optimistic.
   filter_init();
   printf("===== Starting filter_runPowerTest() =====\n");
+  // Check to make sure that the power windows are the correct size.
+  if (filter_getPowerWindowSize() != OUTPUT_QUEUE_SIZE) {
+    printf("Power windows are the incorrect size (%d). They should be %d\n",
+           filter_getPowerWindowSize(), OUTPUT_QUEUE_SIZE);
+    printf("Fix this problem before proceeding.\n");
+    return false;
+  }
+  printf("Power windows are the correct size.\n");
+  // Holds a copy of the values in the power window under test.
+  queue_t goldenQueue;
+  queue_init(&goldenQueue, OUTPUT_QUEUE_SIZE, "golden");
   printf("Testing to see that the power is computed correctly when forced.\n");
   // This tests starting from the beginning.
   for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
-    queue_t *q = filter_getIirOutputQueue(i); // Get the output queue.
-    // Check to make sure that the output queue is the correct size.
-    queue_size_t size;
-    // queueSizeOffset = 0 if output-queues are sized 2000, = 1 if you are
-    // storing an extra
-    /// value in the queue to hold the oldest value each time for a power
-    /// computation.
-    queue_size_t queueSizeOffset = 0;
-#ifdef FILTER_TEST_STORE_OLD_VALUE_IN_QUEUE
-    queueSizeOffset = 1;
-#endif
-    if ((size = queue_size(q)) != (OUTPUT_QUEUE_SIZE + queueSizeOffset)) {
-      printf("Output queue for queue number %d is incorrect (%d). It should "
-             "be %d\n",
-             i, size, (OUTPUT_QUEUE_SIZE + queueSizeOffset));
-      printf("Fix this problem before proceeding.\n");
-      return false;
+    for (uint16_t j = 0; j < OUTPUT_QUEUE_SIZE; j++) {
+      double value = filterTest_randomPowerTestValue();
+      queue_overwritePush(&goldenQueue, value);
+      filter_addPowerWindowValue(i, value);
     }
-    filterTest_fillQueueWithRandomValues(
-        q); // Fill the queue with random values.
-    double goldenValue =
-        filterTest_computeGoldenPowerValue(q); // Compute the golden value.
+    double goldenValue = filterTest_computeGoldenPowerValue(
+        &goldenQueue); // Compute the golden value.
     // Compute power with the filter function.
     double testValue = filter_computePower(
-        i, true, false);            // true, false = no force, no debug print.
+        i, true, false);            // true, false = force, no debug print.
     if (testValue != goldenValue) { // Check for errors.
       printf("filter_runPowerTest failed for index: %d: , golden value: %lf, "
              "filter_computePower(): %lf\n",
@@ -901,25 +908,26 @@ bool filterTest_runPowerTest() {
     }
   }
   if (firstComputeStatus)
-    printf("Output queues are the correct size.\n");
-  printf("Power values were properly computed when forced.\n");
-  // Add a single value to each output queue and try again.
+    printf("Power values were properly computed when forced.\n");
+  // Add a single value to each power window and try again.
   // This tests the incremental computation.
   printf("Testing to see that the power is computed correctly incrementally "
          "over %d trials.\n",
          TEST_INCREMENTAL_LOOP_COUNT);
   bool incrementalComputeStatus =
       true; // Be optimistic for the incremental computation.
-  // Perform many incrementat power computations.
-  for (uint32_t loopCount = 0; loopCount < TEST_INCREMENTAL_LOOP_COUNT;
-       loopCount++) {
-    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
-      queue_t *q = filter_getIirOutputQueue(i); // Get an output queue.
-      queue_overwritePush(
-          q,
-          filterTest_randomValue0To1()); // Add a random value to every queue.
-      double goldenValue =
-          filterTest_computeGoldenPowerValue(q); // Compute the golden value.
+  // Perform many incremental power computations, one power window at a time.
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+    filter_fillPowerWindow(i, 0.0);
+    filter_computePower(i, true, false);
+    filterTest_fillQueue(&goldenQueue, 0.0);
+    for (uint32_t loopCount = 0; loopCount < TEST_INCREMENTAL_LOOP_COUNT;
+         loopCount++) {
+      double value = filterTest_randomPowerTestValue();
+      queue_overwritePush(&goldenQueue, value); // Add a random value to both.
+      filter_addPowerWindowValue(i, value);
+      double goldenValue = filterTest_computeGoldenPowerValue(
+          &goldenQueue); // Compute the golden value.
       double testValue = filter_computePower(
           i, false, false); // false, false = no force, no debug print.
       if (fabs(testValue - goldenValue) >
@@ -938,6 +946,11 @@ bool filterTest_runPowerTest() {
       }
     }
   }
+  queue_garbageCollect(&goldenQueue);
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+    filter_fillPowerWindow(i, 0.0); // Leave clean power windows behind.
+    filter_computePower(i, true, false);
+  }
   if (incrementalComputeStatus) // Print OK message if there were no errors.
     printf("Power values were properly computed incrementally.\n");
   printf("+++++ Exiting filter_runPowerTest +++++\n");
@@ -946,6 +959,631 @@ bool filterTest_runPowerTest() {
   return firstComputeStatus & incrementalComputeStatus;
 }
 
+// Long-running test of the incremental power computation. Pushes millions of
+// values through one power window, in bursts whose amplitude jumps between
+// loud, normal and nearly silent, and regularly compares filter_computePower()
+// against filterTest_computeGoldenPowerValue(). An uncompensated running sum
+// loses the quiet power under the rounding error left behind by the loud
+// bursts. The window stores squares as float, so the allowed error is relative
+// to float precision.
+#define FILTER_TEST_SOAK_SAMPLE_COUNT 4000000
+#define FILTER_TEST_SOAK_CHECK_INTERVAL 997 // Prime, so checks drift in phase.
+#define FILTER_TEST_SOAK_MAX_BURST_LENGTH 5000
+#define FILTER_TEST_SOAK_AMPLITUDE_COUNT 3
+#define FILTER_TEST_SOAK_MAX_RELATIVE_ERROR 1.0E-6
+#define FILTER_TEST_SOAK_FILTER_NUMBER 0
+static const double
+    filterTest_soakAmplitudes[FILTER_TEST_SOAK_AMPLITUDE_COUNT] = {1.0E3, 1.0,
+                                                                   1.0E-3};
+bool filterTest_runPowerSoakTest(bool printMessageFlag) {
+  bool success = true; // Be optimistic.
+  uint16_t filterNumber = FILTER_TEST_SOAK_FILTER_NUMBER;
+  if (printMessageFlag)
+    printf("===== Starting filterTest_runPowerSoakTest() =====\n");
+  queue_t goldenQueue; // Holds a copy of the values in the power window.
+  queue_init(&goldenQueue, filter_getPowerWindowSize(), "soak");
+  filterTest_fillQueue(&goldenQueue, 0.0);
+  filter_fillPowerWindow(filterNumber, 0.0);
+  filter_computePower(filterNumber, true, false);
+  double worstError = 0.0;
+  uint32_t burstRemaining = 0;
+  double amplitude = 0.0;
+  for (uint32_t n = 0; n < FILTER_TEST_SOAK_SAMPLE_COUNT; n++) {
+    if (burstRemaining == 0) { // Start a new burst.
+      burstRemaining = 1 + rand() % FILTER_TEST_SOAK_MAX_BURST_LENGTH;
+      amplitude =
+          filterTest_soakAmplitudes[rand() % FILTER_TEST_SOAK_AMPLITUDE_COUNT];
+    }
+    burstRemaining--;
+    double value = amplitude * (2.0 * filterTest_randomValue0To1() - 1.0);
+    queue_overwritePush(&goldenQueue, value);
+    filter_addPowerWindowValue(filterNumber, value);
+    double testValue = filter_computePower(filterNumber, false, false);
+    if (n % FILTER_TEST_SOAK_CHECK_INTERVAL == 0) {
+      double goldenValue = filterTest_computeGoldenPowerValue(&goldenQueue);
+      double error = fabs(testValue - goldenValue) / goldenValue;
+      worstError = fmax(worstError, error);
+      if (error > FILTER_TEST_SOAK_MAX_RELATIVE_ERROR) {
+        printf("filterTest_runPowerSoakTest: after %d values power is %le, "
+               "golden value is %le (relative error %.2le).\n",
+               n, testValue, goldenValue, error);
+        success = false;
+        break;
+      }
+    }
+  }
+  queue_garbageCollect(&goldenQueue);
+  filter_fillPowerWindow(filterNumber, 0.0); // Leave a clean power window.
+  filter_computePower(filterNumber, true, false);
+  // Print informational messages.
+  if (printMessageFlag) {
+    printf("worst relative power error over %d values: %.2le\n",
+           FILTER_TEST_SOAK_SAMPLE_COUNT, worstError);
+    printf("filterTest_runPowerSoakTest ");
+    if (success)
+      printf("passed.\n");
+    else
+      printf("failed.\n");
+  }
+  return success;
+}
+
+// Zeroes all of the filter.c queues and power values and re-inits the
+// fixed-point filters, without calling filter_init() again (it allocates).
+void filterTest_resetFilters() {
+  filter_fillFirHistory(0.0);
+  filter_fillQueue(filter_getYQueue(), 0.0);
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+    filter_clearIirState(i);
+    filter_fillPowerWindow(i, 0.0);
+    filter_computePower(i, true, false); // Resets the running power to 0.
+  }
+  filterFixed_init();
+  filterFloat_init();
+  filterSdft_init();
+}
+
+// Returns the index of the largest value in values[].
+uint16_t filterTest_findMaxIndex(double values[], uint16_t size) {
+  uint16_t maxIndex = 0;
+  for (uint16_t i = 1; i < size; i++)
+    if (values[i] > values[maxIndex])
+      maxIndex = i;
+  return maxIndex;
+}
+
+// Runs the double-precision filters (filter.c) and the fixed-point filters
+// (filterFixed.c) side by side on a square wave at each user frequency. For
+// every IIR filter it reports the SNR of the fixed-point output against the
+// double output and the relative error of the final power value. Fails if the
+// SNR of the in-band filter is too low or the two pipelines pick a different
+// filter as having the most power (which would change the hit decision).
+#define FILTER_TEST_FIXED_POINT_MIN_SNR_DB 60.0
+#define FILTER_TEST_DB_FACTOR 10.0 // 10 * log10() for power ratios.
+bool filterTest_runFixedPointTest(bool printMessageFlag) {
+  if (!filterTest_initFlag) {
+    printf("Must call filterTest_init() before running any filter tests.\n");
+    return false;
+  }
+  bool success = true; // Be optimistic.
+  double worstSnr = INFINITY;
+  double worstPowerError = 0.0;
+  if (printMessageFlag)
+    printf("===== Starting filterTest_runFixedPointTest() =====\n");
+  for (uint16_t freq = 0; freq < FILTER_FREQUENCY_COUNT; freq++) {
+    filterTest_resetFilters();
+    double signal[FILTER_FREQUENCY_COUNT] = {0.0}; // Sum of double output^2.
+    double noise[FILTER_FREQUENCY_COUNT] = {0.0};  // Sum of difference^2.
+    // Latest filter_computePower() values. filter_getCurrentPowerValues()
+    // would report the fixed-point values under FILTER_FIXED_POINT.
+    double referencePower[FILTER_FREQUENCY_COUNT] = {0.0};
+    uint16_t periodTickCount = filterTest_firTestTickCounts[freq];
+    uint32_t totalTickCount = 0;
+    while (totalTickCount < FILTER_TEST_PULSE_WIDTH_LENGTH) {
+      for (uint16_t freqTick = 0; freqTick < periodTickCount; freqTick++) {
+        double input = computeFilterInput(freqTick, periodTickCount);
+        filter_addNewInput(input);
+        filterFixed_addNewInput(filterFixed_scaleInput(input));
+        if (filterTest_decimatingFirFilter()) { // Keep both in lock-step.
+          filterFixed_firFilter();
+          for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+            double reference = filter_iirFilter(i);
+            double fixed = filterFixed_outputToDouble(filterFixed_iirFilter(i));
+            signal[i] += reference * reference;
+            noise[i] += (reference - fixed) * (reference - fixed);
+            referencePower[i] = filter_computePower(i, false, false);
+            filterFixed_computePower(i, false);
+          }
+        }
+        totalTickCount++;
+      }
+    }
+    double fixedPower[FILTER_FREQUENCY_COUNT];
+    filterFixed_getCurrentPowerValues(fixedPower);
+    double minSnr = INFINITY;
+    double maxPowerError = 0.0;
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+      double snr = FILTER_TEST_DB_FACTOR * log10(signal[i] / noise[i]);
+      double powerError =
+          fabs(fixedPower[i] - referencePower[i]) / referencePower[i];
+      minSnr = fmin(minSnr, snr);
+      maxPowerError = fmax(maxPowerError, powerError);
+    }
+    double inBandSnr =
+        FILTER_TEST_DB_FACTOR * log10(signal[freq] / noise[freq]);
+    uint16_t referenceMax =
+        filterTest_findMaxIndex(referencePower, FILTER_FREQUENCY_COUNT);
+    uint16_t fixedMax =
+        filterTest_findMaxIndex(fixedPower, FILTER_FREQUENCY_COUNT);
+    if (printMessageFlag)
+      printf("freq %d: in-band SNR %5.1lf dB, worst SNR %5.1lf dB, max power "
+             "error %.2le, max power filter %d (double %d)\n",
+             freq, inBandSnr, minSnr, maxPowerError, fixedMax, referenceMax);
+    if (inBandSnr < FILTER_TEST_FIXED_POINT_MIN_SNR_DB) {
+      printf("filterTest_runFixedPointTest: in-band SNR for frequency %d is "
+             "%.1lf dB, should be at least %.1lf dB.\n",
+             freq, inBandSnr, FILTER_TEST_FIXED_POINT_MIN_SNR_DB);
+      success = false;
+    }
+    if (fixedMax != referenceMax) {
+      printf("filterTest_runFixedPointTest: fixed-point max power is on "
+             "filter %d, double is on filter %d.\n",
+             fixedMax, referenceMax);
+      success = false;
+    }
+    worstSnr = fmin(worstSnr, minSnr);
+    worstPowerError = fmax(worstPowerError, maxPowerError);
+  }
+  // Print informational messages.
+  if (printMessageFlag) {
+    printf("worst SNR over all filters: %.1lf dB, worst relative power error: "
+           "%.2le\n",
+           worstSnr, worstPowerError);
+    printf("filterTest_runFixedPointTest ");
+    if (success)
+      printf("passed.\n");
+    else
+      printf("failed.\n");
+  }
+  return success;
+}
+
+// Runs the second-order-section IIR filters next to filter_iirFilter() on a
+// square wave at each user frequency and checks that the two forms of every
+// IIR filter agree. The second-order sections are run one filter at a time
+// (filter_iirSosFilter()) and then as a bank (filter_iirFilterBank()). The
+// direct form loses some precision to its large coefficients, so the outputs
+// are compared as an SNR rather than for equality.
+#define FILTER_TEST_IIR_SOS_MIN_SNR_DB 80.0
+#define FILTER_TEST_IIR_SOS_PASS_COUNT 2 // Single filters, then the bank.
+bool filterTest_runIirSosTest(bool printMessageFlag) {
+  if (!filterTest_initFlag) {
+    printf("Must call filterTest_init() before running any filter tests.\n");
+    return false;
+  }
+  bool success = true; // Be optimistic.
+  double worstSnr[FILTER_TEST_IIR_SOS_PASS_COUNT] = {INFINITY, INFINITY};
+  if (printMessageFlag)
+    printf("===== Starting filterTest_runIirSosTest() =====\n");
+  for (uint16_t pass = 0; pass < FILTER_TEST_IIR_SOS_PASS_COUNT; pass++) {
+    bool useBank = (pass == 1);
+    for (uint16_t freq = 0; freq < FILTER_FREQUENCY_COUNT; freq++) {
+      filterTest_resetFilters();
+      double signal[FILTER_FREQUENCY_COUNT] = {0.0}; // Sum of direct form^2.
+      double noise[FILTER_FREQUENCY_COUNT] = {0.0};  // Sum of difference^2.
+      double sos[FILTER_FREQUENCY_COUNT];
+      uint16_t periodTickCount = filterTest_firTestTickCounts[freq];
+      uint32_t totalTickCount = 0;
+      while (totalTickCount < FILTER_TEST_PULSE_WIDTH_LENGTH) {
+        for (uint16_t freqTick = 0; freqTick < periodTickCount; freqTick++) {
+          filter_addNewInput(computeFilterInput(freqTick, periodTickCount));
+          if (filterTest_decimatingFirFilter()) {
+            if (useBank)
+              filter_iirFilterBank(sos);
+            for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+              double reference = filter_iirFilter(i);
+              if (!useBank)
+                sos[i] = filter_iirSosFilter(i);
+              signal[i] += reference * reference;
+              noise[i] += (reference - sos[i]) * (reference - sos[i]);
+            }
+          }
+          totalTickCount++;
+        }
+      }
+      for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        double snr = FILTER_TEST_DB_FACTOR * log10(signal[i] / noise[i]);
+        if (snr < FILTER_TEST_IIR_SOS_MIN_SNR_DB) {
+          printf("filterTest_runIirSosTest: %s SNR for filter %d at "
+                 "frequency %d is %.1lf dB, should be at least %.1lf dB.\n",
+                 useBank ? "bank" : "single filter", i, freq, snr,
+                 FILTER_TEST_IIR_SOS_MIN_SNR_DB);
+          success = false;
+        }
+        worstSnr[pass] = fmin(worstSnr[pass], snr);
+      }
+    }
+  }
+  filterTest_resetFilters(); // Output queues hold both forms, clear them.
+  // Print informational messages.
+  if (printMessageFlag) {
+    printf("worst SNR against direct form: single filter %.1lf dB, bank "
+           "%.1lf dB\n",
+           worstSnr[0], worstSnr[1]);
+    printf("filterTest_runIirSosTest ");
+    if (success)
+      printf("passed.\n");
+    else
+      printf("failed.\n");
+  }
+  return success;
+}
+
+// Runs the IIR filter bank and the sliding-DFT bins (filterSdft.c) side by
+// side on a pulse at each test frequency followed by the same length of
+// silence, and applies the detector's hit test to both sets of power values
+// after every FIR output. Passes if, for every frequency, the two backends
+// either both miss or both hit on the same frequency. Also reports how far
+// apart the first hits are and how many decisions differ.
+#define FILTER_TEST_SDFT_SAMPLE_COUNT (2 * FILTER_TEST_PULSE_WIDTH_LENGTH)
+#define FILTER_TEST_NO_HIT -1
+bool filterTest_runSdftHitTest(bool printMessageFlag) {
+  if (!filterTest_initFlag) {
+    printf("Must call filterTest_init() before running any filter tests.\n");
+    return false;
+  }
+  bool success = true; // Be optimistic.
+  if (printMessageFlag)
+    printf("===== Starting filterTest_runSdftHitTest() =====\n");
+  for (uint16_t freq = 0; freq < FILTER_TEST_FIR_POWER_TEST_PERIOD_COUNT;
+       freq++) {
+    filterTest_resetFilters();
+    uint16_t periodTickCount = filterTest_firTestTickCounts[freq];
+    int32_t iirHitFrequency = FILTER_TEST_NO_HIT;
+    int32_t sdftHitFrequency = FILTER_TEST_NO_HIT;
+    uint32_t iirHitTime = 0;  // In FIR outputs.
+    uint32_t sdftHitTime = 0; // In FIR outputs.
+    uint32_t firOutputCount = 0;
+    uint32_t mismatchCount = 0; // FIR outputs where the decisions differ.
+    for (uint32_t tick = 0; tick < FILTER_TEST_SDFT_SAMPLE_COUNT; tick++) {
+      double input = tick < FILTER_TEST_PULSE_WIDTH_LENGTH
+                         ? computeFilterInput(tick % periodTickCount,
+                                              periodTickCount)
+                         : 0.0;
+      filter_addNewInput(input);
+      if (!filterTest_decimatingFirFilter())
+        continue;
+      double iirPower[FILTER_FREQUENCY_COUNT];
+      double sdftPower[FILTER_FREQUENCY_COUNT];
+      filter_iirFilterBank(iirPower); // Outputs are overwritten below.
+      for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
+        iirPower[i] = filter_computePower(i, false, false);
+      filterSdft_addNewInput(filter_getFirOutput());
+      filterSdft_getCurrentPowerValues(sdftPower);
+      uint16_t iirFrequency, sdftFrequency;
+      bool iirHit = detector_checkForHit(iirPower, &iirFrequency);
+      bool sdftHit = detector_checkForHit(sdftPower, &sdftFrequency);
+      if (iirHit != sdftHit || (iirHit && iirFrequency != sdftFrequency))
+        mismatchCount++;
+      if (iirHit && iirHitFrequency == FILTER_TEST_NO_HIT) {
+        iirHitFrequency = iirFrequency;
+        iirHitTime = firOutputCount;
+      }
+      if (sdftHit && sdftHitFrequency == FILTER_TEST_NO_HIT) {
+        sdftHitFrequency = sdftFrequency;
+        sdftHitTime = firOutputCount;
+      }
+      firOutputCount++;
+    }
+    if (printMessageFlag)
+      printf("tick count %2d: IIR hit %2d at %4d, sliding DFT hit %2d at %4d, "
+             "%4d decisions differ\n",
+             periodTickCount, iirHitFrequency, iirHitTime, sdftHitFrequency,
+             sdftHitTime, mismatchCount);
+    if (iirHitFrequency != sdftHitFrequency) {
+      printf("filterTest_runSdftHitTest: for tick count %d the IIR filters hit "
+             "on %d but the sliding DFT hit on %d (-1 is no hit).\n",
+             periodTickCount, iirHitFrequency, sdftHitFrequency);
+      success = false;
+    }
+  }
+  filterTest_resetFilters();
+  // Print informational messages.
+  if (printMessageFlag) {
+    printf("filterTest_runSdftHitTest ");
+    if (success)
+      printf("passed.\n");
+    else
+      printf("failed.\n");
+  }
+  return success;
+}
+
+// Runs the double-precision filters (filter.c) and the single-precision
+// filters (filterFloat.c) side by side on the square-wave test frequencies, a
+// pulse followed by the same length of silence, and applies the detector's hit
+// test to both sets of power values after every FIR output. Reports the
+// largest relative power error, counting only filters within
+// FILTER_TEST_FLOAT_POWER_RANGE of the strongest one (the rest can't affect a
+// hit), and how many hit decisions differ. Fails if the error is too large or
+// the first hits differ.
+#define FILTER_TEST_FLOAT_SAMPLE_COUNT (2 * FILTER_TEST_PULSE_WIDTH_LENGTH)
+#define FILTER_TEST_FLOAT_POWER_RANGE 1.0E-6 // 60 dB below the strongest.
+#define FILTER_TEST_FLOAT_MAX_RELATIVE_ERROR 1.0E-3
+bool filterTest_runFloatTest(bool printMessageFlag) {
+  if (!filterTest_initFlag) {
+    printf("Must call filterTest_init() before running any filter tests.\n");
+    return false;
+  }
+  bool success = true; // Be optimistic.
+  double worstPowerError = 0.0;
+  uint32_t totalMismatchCount = 0;
+  if (printMessageFlag)
+    printf("===== Starting filterTest_runFloatTest() =====\n");
+  for (uint16_t freq = 0; freq < FILTER_TEST_FIR_POWER_TEST_PERIOD_COUNT;
+       freq++) {
+    filterTest_resetFilters();
+    uint16_t periodTickCount = filterTest_firTestTickCounts[freq];
+    int32_t doubleHitFrequency = FILTER_TEST_NO_HIT;
+    int32_t floatHitFrequency = FILTER_TEST_NO_HIT;
+    uint32_t mismatchCount = 0; // FIR outputs where the decisions differ.
+    double maxPowerError = 0.0;
+    for (uint32_t tick = 0; tick < FILTER_TEST_FLOAT_SAMPLE_COUNT; tick++) {
+      double input = tick < FILTER_TEST_PULSE_WIDTH_LENGTH
+                         ? computeFilterInput(tick % periodTickCount,
+                                              periodTickCount)
+                         : 0.0;
+      filter_addNewInput(input);
+      filterFloat_addNewInput((float)input);
+      if (!filterTest_decimatingFirFilter()) // Keep both in lock-step.
+        continue;
+      filterFloat_firFilter();
+      double doublePower[FILTER_FREQUENCY_COUNT];
+      float floatOutput[FILTER_FREQUENCY_COUNT];
+      double floatPower[FILTER_FREQUENCY_COUNT];
+      filter_iirFilterBank(doublePower); // Outputs are overwritten below.
+      filterFloat_iirFilterBank(floatOutput);
+      double strongest = 0.0;
+      for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        doublePower[i] = filter_computePower(i, false, false);
+        floatPower[i] = filterFloat_computePower(i, false);
+        strongest = fmax(strongest, doublePower[i]);
+      }
+      for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        if (doublePower[i] > 0.0 &&
+            doublePower[i] >= FILTER_TEST_FLOAT_POWER_RANGE * strongest)
+          maxPowerError =
+              fmax(maxPowerError,
+                   fabs(floatPower[i] - doublePower[i]) / doublePower[i]);
+      }
+      uint16_t doubleFrequency, floatFrequency;
+      bool doubleHit = detector_checkForHit(doublePower, &doubleFrequency);
+      bool floatHit = detector_checkForHit(floatPower, &floatFrequency);
+      if (doubleHit != floatHit ||
+          (doubleHit && doubleFrequency != floatFrequency))
+        mismatchCount++;
+      if (doubleHit && doubleHitFrequency == FILTER_TEST_NO_HIT)
+        doubleHitFrequency = doubleFrequency;
+      if (floatHit && floatHitFrequency == FILTER_TEST_NO_HIT)
+        floatHitFrequency = floatFrequency;
+    }
+    if (printMessageFlag)
+      printf("tick count %2d: max relative power error %.2le, double hit %2d, "
+             "float hit %2d, %4d decisions differ\n",
+             periodTickCount, maxPowerError, doubleHitFrequency,
+             floatHitFrequency, mismatchCount);
+    if (maxPowerError > FILTER_TEST_FLOAT_MAX_RELATIVE_ERROR) {
+      printf("filterTest_runFloatTest: relative power error for tick count %d "
+             "is %.2le, should be at most %.2le.\n",
+             periodTickCount, maxPowerError,
+             FILTER_TEST_FLOAT_MAX_RELATIVE_ERROR);
+      success = false;
+    }
+    if (doubleHitFrequency != floatHitFrequency) {
+      printf("filterTest_runFloatTest: for tick count %d double hit on %d but "
+             "float hit on %d (-1 is no hit).\n",
+             periodTickCount, doubleHitFrequency, floatHitFrequency);
+      success = false;
+    }
+    worstPowerError = fmax(worstPowerError, maxPowerError);
+    totalMismatchCount += mismatchCount;
+  }
+  filterTest_resetFilters();
+  // Print informational messages.
+  if (printMessageFlag) {
+    printf("worst relative power error: %.2le, %d hit decisions differ\n",
+           worstPowerError, totalMismatchCount);
+    printf("filterTest_runFloatTest ");
+    if (success)
+      printf("passed.\n");
+    else
+      printf("failed.\n");
+  }
+  return success;
+}
+
+// Runs the double-precision filters (filter.c) and the fixed-point filters
+// (filterFixed.c) side by side on the square-wave test frequencies, a pulse
+// followed by the same length of silence, and applies the detector's hit test
+// to both sets of power values after every FIR output, the way the detector
+// does under FILTER_FIXED_POINT. Fails if the first hits differ or if the
+// fixed-point powers ever hit on a frequency other than the pulse's: the
+// small powers of the other filters must not round down to 0, or the median
+// threshold becomes 0 and any filter with power hits.
+#define FILTER_TEST_FIXED_HIT_SAMPLE_COUNT (2 * FILTER_TEST_PULSE_WIDTH_LENGTH)
+bool filterTest_runFixedPointHitTest(bool printMessageFlag) {
+  if (!filterTest_initFlag) {
+    printf("Must call filterTest_init() before running any filter tests.\n");
+    return false;
+  }
+  bool success = true; // Be optimistic.
+  if (printMessageFlag)
+    printf("===== Starting filterTest_runFixedPointHitTest() =====\n");
+  for (uint16_t freq = 0; freq < FILTER_TEST_FIR_POWER_TEST_PERIOD_COUNT;
+       freq++) {
+    filterTest_resetFilters();
+    uint16_t periodTickCount = filterTest_firTestTickCounts[freq];
+    int32_t doubleHitFrequency = FILTER_TEST_NO_HIT;
+    int32_t fixedHitFrequency = FILTER_TEST_NO_HIT;
+    uint32_t wrongHitCount = 0; // Fixed-point hits on another frequency.
+    for (uint32_t tick = 0; tick < FILTER_TEST_FIXED_HIT_SAMPLE_COUNT;
+         tick++) {
+      double input = tick < FILTER_TEST_PULSE_WIDTH_LENGTH
+                         ? computeFilterInput(tick % periodTickCount,
+                                              periodTickCount)
+                         : 0.0;
+      filter_addNewInput(input);
+      filterFixed_addNewInput(filterFixed_scaleInput(input));
+      if (!filterTest_decimatingFirFilter()) // Keep both in lock-step.
+        continue;
+      filterFixed_firFilter();
+      double doublePower[FILTER_FREQUENCY_COUNT];
+      double fixedPower[FILTER_FREQUENCY_COUNT];
+      filter_iirFilterBank(doublePower); // Outputs are overwritten below.
+      for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        filterFixed_iirFilter(i);
+        doublePower[i] = filter_computePower(i, false, false);
+        fixedPower[i] =
+            filterFixed_powerToDouble(filterFixed_computePower(i, false));
+      }
+      uint16_t doubleFrequency, fixedFrequency;
+      bool doubleHit = detector_checkForHit(doublePower, &doubleFrequency);
+      bool fixedHit = detector_checkForHit(fixedPower, &fixedFrequency);
+      if (fixedHit && fixedFrequency != freq)
+        wrongHitCount++;
+      if (doubleHit && doubleHitFrequency == FILTER_TEST_NO_HIT)
+        doubleHitFrequency = doubleFrequency;
+      if (fixedHit && fixedHitFrequency == FILTER_TEST_NO_HIT)
+        fixedHitFrequency = fixedFrequency;
+    }
+    if (printMessageFlag)
+      printf("tick count %2d: double hit %2d, fixed-point hit %2d, %4d "
+             "fixed-point hits on another frequency\n",
+             periodTickCount, doubleHitFrequency, fixedHitFrequency,
+             wrongHitCount);
+    if (doubleHitFrequency != fixedHitFrequency || wrongHitCount != 0) {
+      printf("filterTest_runFixedPointHitTest: for tick count %d double hit "
+             "on %d but fixed point hit on %d (-1 is no hit), %d times on "
+             "another frequency.\n",
+             periodTickCount, doubleHitFrequency, fixedHitFrequency,
+             wrongHitCount);
+      success = false;
+    }
+  }
+  filterTest_resetFilters();
+  // Print informational messages.
+  if (printMessageFlag) {
+    printf("filterTest_runFixedPointHitTest ");
+    if (success)
+      printf("passed.\n");
+    else
+      printf("failed.\n");
+  }
+  return success;
+}
+
+// Runs random inputs through the per-sample filters
+// (filter_decimatingFirFilter, filter_iirFilterBank, filter_computePower) and
+// then, from the same starting state, through the block versions in blocks of
+// varying size. The detector uses the block versions, so the FIR outputs, IIR
+// outputs and power values must be exactly the same. Checks one IIR filter per
+// pass to keep the reference small. Long enough for the power windows to wrap.
+#define FILTER_TEST_BLOCK_SAMPLE_COUNT                                         \
+  (FILTER_FIR_DECIMATION_FACTOR * (FILTER_INPUT_PULSE_WIDTH + 200))
+#define FILTER_TEST_BLOCK_OUTPUT_COUNT                                         \
+  (FILTER_TEST_BLOCK_SAMPLE_COUNT / FILTER_FIR_DECIMATION_FACTOR)
+#define FILTER_TEST_BLOCK_MAX_SIZE 400
+#define FILTER_TEST_BLOCK_SIZE_STEP 37 // Gives block sizes from 1 to MAX_SIZE.
+#define FILTER_TEST_BLOCK_SEED 390
+#define FILTER_TEST_BLOCK_SCALE 2.0 // Random inputs from -1 to 1.
+static double blockTestFir[FILTER_TEST_BLOCK_OUTPUT_COUNT];
+static double blockTestIir[FILTER_TEST_BLOCK_OUTPUT_COUNT];
+static double blockTestPower[FILTER_TEST_BLOCK_OUTPUT_COUNT];
+bool filterTest_runBlockTest(bool printMessageFlag) {
+  if (!filterTest_initFlag) {
+    printf("Must call filterTest_init() before running any filter tests.\n");
+    return false;
+  }
+  bool success = true; // Be optimistic.
+  if (printMessageFlag)
+    printf("===== Starting filterTest_runBlockTest() =====\n");
+  for (uint16_t filterNum = 0; filterNum < FILTER_FREQUENCY_COUNT;
+       filterNum++) {
+    // Per-sample reference.
+    filter_reset();
+    srand(FILTER_TEST_BLOCK_SEED);
+    uint32_t outputCount = 0;
+    for (uint32_t i = 0; i < FILTER_TEST_BLOCK_SAMPLE_COUNT; i++) {
+      double x = FILTER_TEST_BLOCK_SCALE * filterTest_randomValue0To1() - 1.0;
+      if (filter_decimatingFirFilter(x)) {
+        double iir[FILTER_FREQUENCY_COUNT];
+        filter_iirFilterBank(iir);
+        for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+          double power = filter_computePower(i, false, false);
+          if (i == filterNum)
+            blockTestPower[outputCount] = power;
+        }
+        blockTestFir[outputCount] = filter_getFirOutput();
+        blockTestIir[outputCount] = iir[filterNum];
+        outputCount++;
+      }
+    }
+    // Block version, same inputs.
+    filter_reset();
+    srand(FILTER_TEST_BLOCK_SEED);
+    double in[FILTER_TEST_BLOCK_MAX_SIZE];
+    double fir[FILTER_TEST_BLOCK_MAX_SIZE];
+    double iir[FILTER_TEST_BLOCK_MAX_SIZE][FILTER_FREQUENCY_COUNT];
+    double power[FILTER_TEST_BLOCK_MAX_SIZE][FILTER_FREQUENCY_COUNT];
+    uint32_t blockSize = 1;
+    uint32_t step = 0;
+    uint32_t sampleCount = 0;
+    while (success && sampleCount < FILTER_TEST_BLOCK_SAMPLE_COUNT) {
+      if (blockSize > FILTER_TEST_BLOCK_SAMPLE_COUNT - sampleCount)
+        blockSize = FILTER_TEST_BLOCK_SAMPLE_COUNT - sampleCount;
+      for (uint32_t i = 0; i < blockSize; i++) {
+        in[i] = FILTER_TEST_BLOCK_SCALE * filterTest_randomValue0To1() - 1.0;
+      }
+      uint32_t count = filter_decimatingFirFilterBlock(in, blockSize, fir);
+      filter_iirFilterBankBlock(fir, count, iir);
+      filter_computePowerBlock(iir, count, power);
+      for (uint32_t i = 0; i < count; i++, step++) {
+        double iirOut = iir[i][filterNum];
+        double powerOut = power[i][filterNum];
+        if (fir[i] != blockTestFir[step] || iirOut != blockTestIir[step] ||
+            powerOut != blockTestPower[step]) {
+          printf("filterTest_runBlockTest: filter %d differs at output %d: "
+                 "FIR %le/%le, IIR %le/%le, power %le/%le.\n",
+                 filterNum, step, fir[i], blockTestFir[step], iirOut,
+                 blockTestIir[step], powerOut, blockTestPower[step]);
+          success = false;
+          break;
+        }
+      }
+      sampleCount += blockSize;
+      blockSize = (blockSize + FILTER_TEST_BLOCK_SIZE_STEP) %
+                      FILTER_TEST_BLOCK_MAX_SIZE +
+                  1;
+    }
+    if (success && step != outputCount) {
+      printf("filterTest_runBlockTest: filter %d produced %d block outputs, "
+             "should be %d.\n",
+             filterNum, step, outputCount);
+      success = false;
+    }
+  }
+  filter_reset();
+  // Print informational messages.
+  if (printMessageFlag) {
+    printf("filterTest_runBlockTest ");
+    if (success)
+      printf("passed.\n");
+    else
+      printf("failed.\n");
+  }
+  return success;
+}
+
 // Copies powerValues to currentPowerValues, the same array
 // that is used to hold the values after power has been computed
 // by filter_computePower().
@@ -990,6 +1628,20 @@ bool filterTest_runTest() {
                                              PRINT_INFO_MESSAGES);
   // Verifies correct functionality of the power computation.
   success &= filterTest_runPowerTest();
+  // Runs the incremental power computation for a long time to check for drift.
+  success &= filterTest_runPowerSoakTest(PRINT_INFO_MESSAGES);
+  // Compares the fixed-point filters against the double-precision filters.
+  success &= filterTest_runFixedPointTest(PRINT_INFO_MESSAGES);
+  // Compares the second-order-section IIR filters against the direct form.
+  success &= filterTest_runIirSosTest(PRINT_INFO_MESSAGES);
+  // Compares the hit decisions of the sliding-DFT backend and the IIR filters.
+  success &= filterTest_runSdftHitTest(PRINT_INFO_MESSAGES);
+  // Compares the single-precision filters against the double filters.
+  success &= filterTest_runFloatTest(PRINT_INFO_MESSAGES);
+  // Compares the hit decisions of the fixed-point and double filters.
+  success &= filterTest_runFixedPointHitTest(PRINT_INFO_MESSAGES);
+  // Checks that the block filters match the per-sample filters exactly.
+  success &= filterTest_runBlockTest(PRINT_INFO_MESSAGES);
   // Plots the frequency response of the FIR filter against all user and other
   // test frequencies. All frequencies are expressed as a square wave.
   filterTest_runSquareWaveFirPowerTest(PRINT_INFO_MESSAGES, PLOT_INPUT);
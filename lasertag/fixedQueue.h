@@ -0,0 +1,150 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef FIXEDQUEUE_H_
+#define FIXEDQUEUE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// The macro below also compiles as C++.
+#ifdef __cplusplus
+#define FIXED_QUEUE_STATIC_ASSERT static_assert
+#else
+#define FIXED_QUEUE_STATIC_ASSERT _Static_assert
+#endif
+
+// Header-only queue with its capacity fixed at compile time. Same behavior as
+// queue_t (queue.h) but with no heap allocation, no name, and every operation
+// a static inline function, so the compiler can inline them into the caller.
+//
+// FIXED_QUEUE_DEFINE(prefix, elementType, capacity, trackFlags); declares the
+// type prefix_t and the functions prefix_init(), prefix_size(),
+// prefix_elementCount(), prefix_full(), prefix_empty(), prefix_push(),
+// prefix_pop(), prefix_overwritePush(), prefix_readElementAt(),
+// prefix_underflow() and prefix_overflow(). For example:
+//   FIXED_QUEUE_DEFINE(sampleQueue, double, 64, true);
+//   static sampleQueue_t q;
+//   sampleQueue_init(&q);
+//   sampleQueue_push(&q, 1.0);
+//
+// capacity must be a power of two and is the number of elements the queue
+// holds (there is no empty slot). indexIn and indexOut run freely and are
+// masked with capacity - 1 on access, so elementCount is indexIn - indexOut.
+// If trackFlags is false the underflow/overflow flags are never set and the
+// code to set them compiles away. Errors are not printed: pop() and
+// readElementAt() return 0 and push() returns false instead.
+#define FIXED_QUEUE_DEFINE(prefix, elementType, capacity, trackFlags)          \
+  typedef struct {                                                             \
+    uint32_t indexIn;  /* Next slot to write, before masking. */               \
+    uint32_t indexOut; /* Oldest element, before masking. */                   \
+    bool underflowFlag;                                                        \
+    bool overflowFlag;                                                         \
+    elementType data[capacity];                                                \
+  } prefix##_t;                                                                \
+                                                                               \
+  /* Empties the queue and clears the flags. */                                \
+  static inline void prefix##_init(prefix##_t *q) {                            \
+    q->indexIn = 0;                                                            \
+    q->indexOut = 0;                                                           \
+    q->underflowFlag = false;                                                  \
+    q->overflowFlag = false;                                                   \
+  }                                                                            \
+                                                                               \
+  /* Returns the capacity of the queue. */                                     \
+  static inline uint32_t prefix##_size(const prefix##_t *q) {                  \
+    (void)q;                                                                   \
+    return (capacity);                                                         \
+  }                                                                            \
+                                                                               \
+  /* Returns the number of elements in the queue. */                           \
+  static inline uint32_t prefix##_elementCount(const prefix##_t *q) {          \
+    return q->indexIn - q->indexOut;                                           \
+  }                                                                            \
+                                                                               \
+  /* Returns true if the queue is full. */                                     \
+  static inline bool prefix##_full(const prefix##_t *q) {                      \
+    return prefix##_elementCount(q) == (capacity);                             \
+  }                                                                            \
+                                                                               \
+  /* Returns true if the queue is empty. */                                    \
+  static inline bool prefix##_empty(const prefix##_t *q) {                     \
+    return q->indexIn == q->indexOut;                                          \
+  }                                                                            \
+                                                                               \
+  /* Adds value unless the queue is full (sets overflowFlag instead). */       \
+  /* Returns true if value was added. */                                       \
+  static inline bool prefix##_push(prefix##_t *q, elementType value) {         \
+    if (prefix##_full(q)) {                                                    \
+      if (trackFlags)                                                          \
+        q->overflowFlag = true;                                                \
+      return false;                                                            \
+    }                                                                          \
+    q->data[q->indexIn & ((capacity)-1)] = value;                              \
+    q->indexIn++;                                                              \
+    if (trackFlags)                                                            \
+      q->underflowFlag = false;                                                \
+    return true;                                                               \
+  }                                                                            \
+                                                                               \
+  /* Removes and returns the oldest element. Returns 0 and sets */             \
+  /* underflowFlag if the queue is empty. */                                   \
+  static inline elementType prefix##_pop(prefix##_t *q) {                      \
+    if (prefix##_empty(q)) {                                                   \
+      if (trackFlags)                                                          \
+        q->underflowFlag = true;                                               \
+      return (elementType)0;                                                   \
+    }                                                                          \
+    elementType value = q->data[q->indexOut & ((capacity)-1)];                 \
+    q->indexOut++;                                                             \
+    if (trackFlags)                                                            \
+      q->overflowFlag = false;                                                 \
+    return value;                                                              \
+  }                                                                            \
+                                                                               \
+  /* Adds value, dropping the oldest element first if the queue is full. */    \
+  static inline void prefix##_overwritePush(prefix##_t *q,                     \
+                                            elementType value) {               \
+    if (prefix##_full(q))                                                      \
+      q->indexOut++;                                                           \
+    q->data[q->indexIn & ((capacity)-1)] = value;                              \
+    q->indexIn++;                                                              \
+    if (trackFlags)                                                            \
+      q->underflowFlag = false;                                                \
+  }                                                                            \
+                                                                               \
+  /* Index 0 is the oldest element. Returns 0 if index is out of range. */     \
+  static inline elementType prefix##_readElementAt(const prefix##_t *q,        \
+                                                   uint32_t index) {           \
+    if (index >= prefix##_elementCount(q))                                     \
+      return (elementType)0;                                                   \
+    return q->data[(q->indexOut + index) & ((capacity)-1)];                    \
+  }                                                                            \
+                                                                               \
+  /* Returns true if pop() was called on an empty queue since the last */      \
+  /* push. */                                                                  \
+  static inline bool prefix##_underflow(const prefix##_t *q) {                 \
+    return q->underflowFlag;                                                   \
+  }                                                                            \
+                                                                               \
+  /* Returns true if push() was called on a full queue since the last pop. */  \
+  static inline bool prefix##_overflow(const prefix##_t *q) {                  \
+    return q->overflowFlag;                                                    \
+  }                                                                            \
+                                                                               \
+  FIXED_QUEUE_STATIC_ASSERT((capacity) > 0 &&                                  \
+                                ((capacity) & ((capacity)-1)) == 0,            \
+                            #prefix " capacity must be a power of two")
+
+// Checks a FIXED_QUEUE_DEFINE() queue against queue_t with random pushes,
+// pops and overwritePushes. Returns true if the test passes. Prints
+// informational messages if printMessageFlag is true.
+bool fixedQueue_runTest(bool printMessageFlag);
+
+#endif /* FIXEDQUEUE_H_ */
@@ -42,7 +42,7 @@ static char
 static bool initFlag =
     false; // Keep track whether histogram_init() has been called.
 // These are the default colors for the bars.
-const static uint16_t histogram_defaultBarColors[HISTOGRAM_MAX_BAR_COUNT] = {
+static const uint16_t histogram_defaultBarColors[HISTOGRAM_MAX_BAR_COUNT] = {
     DISPLAY_BLUE,    DISPLAY_RED,    DISPLAY_GREEN,   DISPLAY_CYAN,
     DISPLAY_MAGENTA, DISPLAY_YELLOW, DISPLAY_WHITE,   DISPLAY_BLUE,
     DISPLAY_RED,     DISPLAY_GREEN,  DISPLAY_BLUE,    DISPLAY_RED,
@@ -52,7 +52,7 @@ const static uint16_t histogram_defaultBarColors[HISTOGRAM_MAX_BAR_COUNT] = {
     DISPLAY_MAGENTA};
 static uint16_t histogram_barColors[HISTOGRAM_MAX_BAR_COUNT];
 // Default colors for the white dynamic labels.
-const static uint16_t
+static const uint16_t
     histogram_defaultBarTopLabelColors[HISTOGRAM_MAX_BAR_COUNT] = {
         DISPLAY_WHITE, DISPLAY_WHITE, DISPLAY_WHITE, DISPLAY_WHITE,
         DISPLAY_WHITE, DISPLAY_WHITE, DISPLAY_WHITE, DISPLAY_WHITE,
@@ -64,7 +64,7 @@ const static uint16_t
 static uint16_t histogram_barTopLabelColors[HISTOGRAM_MAX_BAR_COUNT];
 // Default labels for the histogram bars.
 // These labels do not change during operation.
-const static char histogram_defaultLabel[HISTOGRAM_MAX_BAR_COUNT]
+static const char histogram_defaultLabel[HISTOGRAM_MAX_BAR_COUNT]
                                         [HISTOGRAM_MAX_BAR_LABEL_WIDTH] = {
                                             {"0"}, {"1"}, {"2"}, {"3"}, {"4"},
                                             {"5"}, {"6"}, {"7"}, {"8"}, {"9"},
@@ -267,8 +267,7 @@ void histogram_updateDisplay() {
         previousBarData[i] = currentBarData[i]; // Old data and new data are the
                                                 // same after the update.
         // Old label and new label are the same after the update.
-        strncpy(oldTopLabel[i], topLabel[i],
-                HISTOGRAM_BAR_TOP_MAX_LABEL_WIDTH_IN_CHARS);
+        memcpy(oldTopLabel[i], topLabel[i], sizeof(oldTopLabel[i]));
       }
     } else if ((data != 0) &&
                strncmp(topLabel[i], oldTopLabel[i],
@@ -278,8 +277,7 @@ void histogram_updateDisplay() {
           true); // True means that the old label needs to be erased.
       // After the update, copy the label to old data so that it won't reupdate
       // until the next change.
-      strncpy(oldTopLabel[i], topLabel[i],
-              HISTOGRAM_BAR_TOP_MAX_LABEL_WIDTH_IN_CHARS);
+      memcpy(oldTopLabel[i], topLabel[i], sizeof(oldTopLabel[i]));
     }
   }
 }
@@ -287,7 +285,7 @@ void histogram_updateDisplay() {
 // Set the bar-color for each bar. This overwrites the defaults. Call
 // histogram_init() to restore the defaults.
 void histogram_setBarColor(histogram_index_t barIndex, uint16_t color) {
-  if (barIndex < 0 || barIndex > HISTOGRAM_MAX_BAR_COUNT) {
+  if (barIndex >= HISTOGRAM_MAX_BAR_COUNT) {
     printf("Error!!! histogram_setBarColor: barIndex(%d) not in range.\n",
            barIndex);
     return;
@@ -298,7 +296,7 @@ void histogram_setBarColor(histogram_index_t barIndex, uint16_t color) {
 // Set the bottom label drawn under each bar. This overwrites the default. Call
 // histogram_init() to restore the defaults.
 void histogram_setBarLabel(histogram_index_t barIndex, const char *label) {
-  if (barIndex < 0 || barIndex > HISTOGRAM_MAX_BAR_COUNT) {
+  if (barIndex >= HISTOGRAM_MAX_BAR_COUNT) {
     printf("Error!!! histogram_setBarColor: barIndex(%d) not in range.\n",
            barIndex);
     return;
@@ -307,7 +305,7 @@ void histogram_setBarLabel(histogram_index_t barIndex, const char *label) {
 }
 
 // Sets the size of the characters used in the bottom labels.
-void histogram_setBottomLabelTextSize(uint16_t size) {}
+void histogram_setBottomLabelTextSize(uint16_t size) { (void)size; }
 
 // Runs a short test that writes random values to the histogram bar-values as
 // specified by the #defines below.
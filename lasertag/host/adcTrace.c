@@ -0,0 +1,151 @@
+#include "adcTrace.h"
+#include <string.h>
+
+#define INIT_VAL 0
+#define HEADER_SIZE 16
+#define MAGIC "LTAD"
+#define MAGIC_SIZE 4
+#define VERSION_OFFSET 4
+#define VERSION_BYTES 2
+#define SAMPLE_BYTES_OFFSET 6
+#define ADC_MODE_OFFSET 7
+#define SAMPLE_RATE_OFFSET 8
+#define SAMPLE_RATE_BYTES 4
+#define BITS_PER_BYTE 8
+#define BYTE_MASK 0xFF
+#define ADC_MASK 0xFFF         // 12-bit ADC
+#define ADC_BIPOLAR_OFFSET 2048 // moves -2048:+2047 to 0:4095
+#define MAX_SAMPLE_BYTES 4
+#define IO_BLOCK_SAMPLES 4096 // samples converted per fread()/fwrite()
+
+// Reads a little-endian value of byteCount bytes starting at bytes[0].
+static uint32_t readLittleEndian(const uint8_t bytes[], uint8_t byteCount) {
+  uint32_t value = INIT_VAL;
+  for (uint8_t i = INIT_VAL; i < byteCount; i++) {
+    value |= (uint32_t)bytes[i] << (i * BITS_PER_BYTE);
+  }
+  return value;
+}
+
+// Writes value as byteCount little-endian bytes starting at bytes[0].
+static void writeLittleEndian(uint8_t bytes[], uint32_t value,
+                              uint8_t byteCount) {
+  for (uint8_t i = INIT_VAL; i < byteCount; i++) {
+    bytes[i] = (value >> (i * BITS_PER_BYTE)) & BYTE_MASK;
+  }
+}
+
+// Opens a trace for reading and checks its header.
+bool adcTrace_openRead(adcTrace_t *trace, const char *path) {
+  uint8_t header[HEADER_SIZE];
+  trace->file = fopen(path, "rb");
+  if (trace->file == NULL) {
+    printf("adcTrace: can't open %s\n", path);
+    return false;
+  }
+  if (fread(header, 1, HEADER_SIZE, trace->file) != HEADER_SIZE ||
+      memcmp(header, MAGIC, MAGIC_SIZE) != INIT_VAL) {
+    printf("adcTrace: %s is not an ADC trace\n", path);
+    adcTrace_close(trace);
+    return false;
+  }
+  uint32_t version = readLittleEndian(&header[VERSION_OFFSET], VERSION_BYTES);
+  trace->sampleBytes = header[SAMPLE_BYTES_OFFSET];
+  trace->adcMode = header[ADC_MODE_OFFSET];
+  trace->sampleRateInHz =
+      readLittleEndian(&header[SAMPLE_RATE_OFFSET], SAMPLE_RATE_BYTES);
+  if (version != ADC_TRACE_VERSION ||
+      (trace->sampleBytes != sizeof(uint16_t) &&
+       trace->sampleBytes != sizeof(uint32_t)) ||
+      trace->adcMode > ADC_TRACE_MODE_BIPOLAR) {
+    printf("adcTrace: %s has an unsupported header (version %u, %u bytes per "
+           "sample, ADC mode %u)\n",
+           path, version, trace->sampleBytes, trace->adcMode);
+    adcTrace_close(trace);
+    return false;
+  }
+  return true;
+}
+
+// Reads up to max samples, converted to unipolar 12-bit values.
+uint32_t adcTrace_read(adcTrace_t *trace, uint32_t samples[], uint32_t max) {
+  uint8_t bytes[IO_BLOCK_SAMPLES * MAX_SAMPLE_BYTES];
+  uint32_t count = INIT_VAL;
+  while (count < max) {
+    uint32_t want = max - count < IO_BLOCK_SAMPLES ? max - count
+                                                   : IO_BLOCK_SAMPLES;
+    uint32_t got = fread(bytes, trace->sampleBytes, want, trace->file);
+    for (uint32_t i = INIT_VAL; i < got; i++) {
+      uint32_t sample =
+          readLittleEndian(&bytes[i * trace->sampleBytes], trace->sampleBytes);
+      if (trace->adcMode == ADC_TRACE_MODE_BIPOLAR)
+        sample += ADC_BIPOLAR_OFFSET;
+      samples[count + i] = sample & ADC_MASK;
+    }
+    count += got;
+    if (got < want) // end of the trace
+      break;
+  }
+  return count;
+}
+
+// Creates a trace and writes its header.
+bool adcTrace_openWrite(adcTrace_t *trace, const char *path,
+                        uint32_t sampleRateInHz, uint8_t adcMode,
+                        uint8_t sampleBytes) {
+  uint8_t header[HEADER_SIZE] = {INIT_VAL};
+  trace->sampleBytes = sampleBytes;
+  trace->adcMode = adcMode;
+  trace->sampleRateInHz = sampleRateInHz;
+  trace->file = NULL;
+  // Same limits as adcTrace_openRead(); adcTrace_write() relies on them.
+  if ((sampleBytes != sizeof(uint16_t) && sampleBytes != sizeof(uint32_t)) ||
+      adcMode > ADC_TRACE_MODE_BIPOLAR) {
+    printf("adcTrace: can't create %s with %u bytes per sample and ADC mode "
+           "%u\n",
+           path, sampleBytes, adcMode);
+    return false;
+  }
+  trace->file = fopen(path, "wb");
+  if (trace->file == NULL) {
+    printf("adcTrace: can't create %s\n", path);
+    return false;
+  }
+  memcpy(header, MAGIC, MAGIC_SIZE);
+  writeLittleEndian(&header[VERSION_OFFSET], ADC_TRACE_VERSION, VERSION_BYTES);
+  header[SAMPLE_BYTES_OFFSET] = sampleBytes;
+  header[ADC_MODE_OFFSET] = adcMode;
+  writeLittleEndian(&header[SAMPLE_RATE_OFFSET], sampleRateInHz,
+                    SAMPLE_RATE_BYTES);
+  if (fwrite(header, 1, HEADER_SIZE, trace->file) != HEADER_SIZE) {
+    printf("adcTrace: can't write %s\n", path);
+    adcTrace_close(trace);
+    return false;
+  }
+  return true;
+}
+
+// Appends count samples to the trace.
+bool adcTrace_write(adcTrace_t *trace, const uint32_t samples[],
+                    uint32_t count) {
+  uint8_t bytes[IO_BLOCK_SAMPLES * MAX_SAMPLE_BYTES];
+  for (uint32_t done = INIT_VAL; done < count;) {
+    uint32_t block = count - done < IO_BLOCK_SAMPLES ? count - done
+                                                     : IO_BLOCK_SAMPLES;
+    for (uint32_t i = INIT_VAL; i < block; i++) {
+      writeLittleEndian(&bytes[i * trace->sampleBytes], samples[done + i],
+                        trace->sampleBytes);
+    }
+    if (fwrite(bytes, trace->sampleBytes, block, trace->file) != block)
+      return false;
+    done += block;
+  }
+  return true;
+}
+
+// Closes a trace opened for reading or writing.
+void adcTrace_close(adcTrace_t *trace) {
+  if (trace->file != NULL)
+    fclose(trace->file);
+  trace->file = NULL;
+}
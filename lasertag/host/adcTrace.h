@@ -0,0 +1,64 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef ADCTRACE_H_
+#define ADCTRACE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// ADC trace files hold raw ADC samples so that a capture can be replayed
+// through detector(). The file is a 16-byte header followed by the samples,
+// all little-endian:
+//   bytes 0-3    magic "LTAD"
+//   bytes 4-5    format version (ADC_TRACE_VERSION)
+//   byte  6      bytes per sample: 2 (uint16_t) or 4 (uint32_t)
+//   byte  7      ADC mode: ADC_TRACE_MODE_UNIPOLAR or ADC_TRACE_MODE_BIPOLAR
+//   bytes 8-11   sample rate in Hz
+//   bytes 12-15  reserved, write 0
+// The sample count is implied by the file size. Only the low 12 bits of each
+// sample are used. Bipolar samples are two's complement (-2048:+2047).
+
+#define ADC_TRACE_VERSION 1
+#define ADC_TRACE_MODE_UNIPOLAR 0 // 0V:1V -> 0:4095, what detector() expects.
+#define ADC_TRACE_MODE_BIPOLAR 1  // -0.5V:+0.5V -> -2048:+2047.
+
+typedef struct {
+  FILE *file;
+  uint8_t sampleBytes;     // 2 or 4.
+  uint8_t adcMode;         // ADC_TRACE_MODE_UNIPOLAR or ADC_TRACE_MODE_BIPOLAR.
+  uint32_t sampleRateInHz; // Rate the trace was recorded at.
+} adcTrace_t;
+
+// Opens a trace for reading and checks its header. Prints a message and
+// returns false if the file can't be opened or isn't a valid trace.
+bool adcTrace_openRead(adcTrace_t *trace, const char *path);
+
+// Reads up to max samples into samples[] and returns how many were read
+// (0 at the end of the trace). Samples are returned as unipolar 12-bit values
+// whatever the ADC mode of the trace, ready for isr_addDataToAdcBuffer().
+uint32_t adcTrace_read(adcTrace_t *trace, uint32_t samples[], uint32_t max);
+
+// Creates a trace and writes its header. sampleBytes must be 2 or 4 and adcMode
+// one of the ADC_TRACE_MODE values. Prints a message and returns false on
+// failure.
+bool adcTrace_openWrite(adcTrace_t *trace, const char *path,
+                        uint32_t sampleRateInHz, uint8_t adcMode,
+                        uint8_t sampleBytes);
+
+// Appends count samples to a trace opened with adcTrace_openWrite(). Returns
+// false on a write error.
+bool adcTrace_write(adcTrace_t *trace, const uint32_t samples[],
+                    uint32_t count);
+
+// Closes a trace opened for reading or writing.
+void adcTrace_close(adcTrace_t *trace);
+
+#endif /* ADCTRACE_H_ */
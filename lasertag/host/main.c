@@ -0,0 +1,298 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Command-line driver for the host build of the lasertag signal chain (see
+// platforms/host). Runs the unit tests, or pushes synthetic shots or a
+// recorded ADC trace (see adcTrace.h) through isr_function() and detector()
+// exactly as the board would, but as fast as the host can go.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adcTrace.h"
+#include "adpcm.h"
+#include "audioOut.h"
+#include "benchmark.h"
+#include "detector.h"
+#include "filter.h"
+#include "filterTest.h"
+#include "fixedQueue.h"
+#include "host.h"
+#include "isr.h"
+#include "queue.h"
+#include "soundMixer.h"
+#include "windowQueue.h"
+
+#define INIT_VAL 0
+#define SAMPLE_RATE_IN_HZ (FILTER_SAMPLE_FREQUENCY_IN_KHZ * 1000)
+#define SHOT_PULSE_SAMPLES 20000  // 200 ms, as sent by the transmitter
+#define SHOT_PERIOD_SAMPLES 100000 // one shot per second
+#define DETECTOR_CALL_SAMPLES 1000 // main loop runs detector() every 10 ms
+#define DEFAULT_SHOT_COUNT 10
+#define ADC_MIDSCALE 2048
+#define ADC_PULSE_AMPLITUDE 1024 // square wave at half of full scale
+#define ADC_NOISE_AMPLITUDE 64   // peak-to-peak uniform noise, in ADC counts
+#define RANDOM_SEED 1
+#define TRACE_BLOCK_SAMPLES 4096 // samples read or written at once
+
+// Prints how to call this program.
+static void printUsage(const char *programName) {
+  printf("usage: %s test\n", programName);
+  printf("       %s shoot <frequencyNumber> [shotCount] [iir|sdft]\n",
+         programName);
+  printf("       %s record <trace> <frequencyNumber> [shotCount]\n",
+         programName);
+  printf("       %s replay <trace> [iir|sdft] [detectorCallSamples] "
+         "[newest|oldest|resync] [median|adaptive]\n",
+         programName);
+  printf("       %s bench [csvFile]\n", programName);
+}
+
+// Returns the ADC overrun policy named by name ("newest", "oldest" or
+// "resync"), drop-newest by default.
+static isr_overrunPolicy_t parseOverrunPolicy(const char *name) {
+  if (strcmp(name, "oldest") == INIT_VAL)
+    return ISR_OVERRUN_DROP_OLDEST;
+  if (strcmp(name, "resync") == INIT_VAL)
+    return ISR_OVERRUN_RESYNC;
+  return ISR_OVERRUN_DROP_NEWEST;
+}
+
+// Prints the ADC buffer statistics.
+static void printBufferStats() {
+  isr_bufferStats_t stats;
+  isr_getBufferStats(&stats);
+  printf("ADC buffer: high-watermark %u of %u, %u samples lost to overrun, "
+         "%u resyncs discarding %u samples\n",
+         stats.highWatermark, stats.capacity, stats.overrunCount,
+         stats.resyncCount, stats.discardCount);
+}
+
+// Returns the threshold method named by name ("median" or "adaptive"), median
+// by default.
+static detector_threshold_t parseThresholdMode(const char *name) {
+  return strcmp(name, "adaptive") == INIT_VAL ? DETECTOR_THRESHOLD_ADAPTIVE
+                                              : DETECTOR_THRESHOLD_MEDIAN;
+}
+
+// Returns the backend named by name ("iir" or "sdft"), IIR by default.
+static detector_backend_t parseBackend(const char *name) {
+  return strcmp(name, "sdft") == INIT_VAL ? DETECTOR_BACKEND_SDFT
+                                          : DETECTOR_BACKEND_IIR;
+}
+
+// Returns the ADC value for sample n of a shot sequence at frequencyNumber:
+// a square wave for the first SHOT_PULSE_SAMPLES of every shot period, silence
+// otherwise, plus a little noise.
+static uint32_t shotAdcValue(uint32_t n, uint16_t frequencyNumber) {
+  int32_t value = ADC_MIDSCALE;
+  uint32_t tickCount = filter_frequencyTickTable[frequencyNumber];
+  if (n % SHOT_PERIOD_SAMPLES < SHOT_PULSE_SAMPLES)
+    value += (n % tickCount) < tickCount / 2 ? ADC_PULSE_AMPLITUDE
+                                             : -ADC_PULSE_AMPLITUDE;
+  value += rand() % ADC_NOISE_AMPLITUDE - ADC_NOISE_AMPLITUDE / 2;
+  return value;
+}
+
+// Runs the unit tests that do not need the board. Returns true if they pass.
+static bool runTests() {
+  bool success = true;
+  success &= queue_runTest();
+  success &= windowQueue_runTest(true);
+  success &= fixedQueue_runTest(true);
+  success &= filterTest_runTest();
+  detector_runTest();
+  success &= detector_runThresholdTest(false);
+  success &= adpcm_runTest(false);
+  success &= soundMixer_runTest(false);
+  success &= audioOut_runTest(false);
+  printf("host tests %s\n", success ? "passed" : "failed");
+  return success;
+}
+
+// Fires shotCount shots on frequencyNumber through the ISR and the detector
+// and reports the hits and how fast the host ran the signal chain.
+static void runShots(uint16_t frequencyNumber, uint32_t shotCount,
+                     detector_backend_t backend) {
+  bool ignoredFrequencies[FILTER_FREQUENCY_COUNT] = {false};
+  detector_hitCount_t hitCounts[FILTER_FREQUENCY_COUNT];
+  uint32_t sampleCount = shotCount * SHOT_PERIOD_SAMPLES;
+  srand(RANDOM_SEED);
+  isr_init();
+  detector_initWithBackend(ignoredFrequencies, backend);
+  double startTime = host_getTimeInSeconds();
+  for (uint32_t n = INIT_VAL; n < sampleCount; n++) {
+    host_setAdcData(shotAdcValue(n, frequencyNumber));
+    isr_function();
+    if ((n + 1) % DETECTOR_CALL_SAMPLES == INIT_VAL) {
+      detector(true);
+      if (detector_hitDetected())
+        detector_clearHit();
+    }
+  }
+  double elapsed = host_getTimeInSeconds() - startTime;
+  detector_getHitCounts(hitCounts);
+  printf("hit counts:");
+  for (uint16_t i = INIT_VAL; i < FILTER_FREQUENCY_COUNT; i++) {
+    printf(" %u", hitCounts[i]);
+  }
+  printf("\n");
+  printf("%u samples in %.3f s, %.1f x real time\n", sampleCount, elapsed,
+         (double)sampleCount / SAMPLE_RATE_IN_HZ / elapsed);
+  printBufferStats();
+  isr_printTimingStats();
+}
+
+// Writes the same shots that runShots() fires to a unipolar 16-bit trace.
+static bool recordShots(const char *path, uint16_t frequencyNumber,
+                        uint32_t shotCount) {
+  adcTrace_t trace;
+  uint32_t samples[TRACE_BLOCK_SAMPLES];
+  uint32_t sampleCount = shotCount * SHOT_PERIOD_SAMPLES;
+  if (!adcTrace_openWrite(&trace, path, SAMPLE_RATE_IN_HZ,
+                          ADC_TRACE_MODE_UNIPOLAR, sizeof(uint16_t)))
+    return false;
+  srand(RANDOM_SEED);
+  bool success = true;
+  for (uint32_t n = INIT_VAL; n < sampleCount && success;) {
+    uint32_t count = INIT_VAL;
+    for (; count < TRACE_BLOCK_SAMPLES && n < sampleCount; count++, n++) {
+      samples[count] = shotAdcValue(n, frequencyNumber);
+    }
+    success = adcTrace_write(&trace, samples, count);
+  }
+  adcTrace_close(&trace);
+  if (!success)
+    printf("can't write %s\n", path);
+  return success;
+}
+
+// Runs detector() on whatever the ISR has buffered and reports a hit, if any,
+// with the time of the newest sample and the power on every channel.
+static void runDetectorAndReportHit(uint64_t sampleNumber,
+                                    uint32_t sampleRateInHz) {
+  double powerValues[FILTER_FREQUENCY_COUNT];
+  detector(true);
+  if (!detector_hitDetected())
+    return;
+  detector_getCurrentPowerValues(powerValues);
+  printf("hit %.5f s sample %llu channel %u power", // one line per hit
+         (double)sampleNumber / sampleRateInHz,
+         (unsigned long long)sampleNumber,
+         detector_getFrequencyNumberOfLastHit());
+  for (uint16_t i = INIT_VAL; i < FILTER_FREQUENCY_COUNT; i++) {
+    printf(" %.6e", powerValues[i]);
+  }
+  printf("\n");
+  detector_clearHit();
+}
+
+// Pushes every sample of a trace through isr_function() and runs detector()
+// every detectorCallSamples samples, so hit times are accurate to that many
+// samples. Reports every hit, the final power on each channel and the
+// throughput of the signal chain (file reads are not timed).
+static bool replayTrace(const char *path, detector_backend_t backend,
+                        uint32_t detectorCallSamples) {
+  bool ignoredFrequencies[FILTER_FREQUENCY_COUNT] = {false};
+  double powerValues[FILTER_FREQUENCY_COUNT];
+  uint32_t samples[TRACE_BLOCK_SAMPLES];
+  adcTrace_t trace;
+  if (!adcTrace_openRead(&trace, path))
+    return false;
+  if (trace.sampleRateInHz != SAMPLE_RATE_IN_HZ)
+    printf("warning: trace sample rate is %u Hz, the detector assumes %u Hz\n",
+           trace.sampleRateInHz, SAMPLE_RATE_IN_HZ);
+  isr_init();
+  detector_initWithBackend(ignoredFrequencies, backend);
+  uint64_t sampleNumber = INIT_VAL;
+  double elapsed = INIT_VAL;
+  uint32_t count;
+  while ((count = adcTrace_read(&trace, samples, TRACE_BLOCK_SAMPLES)) >
+         INIT_VAL) {
+    double startTime = host_getTimeInSeconds();
+    for (uint32_t i = INIT_VAL; i < count; i++) {
+      host_setAdcData(samples[i]);
+      isr_function();
+      if (++sampleNumber % detectorCallSamples == INIT_VAL)
+        runDetectorAndReportHit(sampleNumber, trace.sampleRateInHz);
+    }
+    elapsed += host_getTimeInSeconds() - startTime;
+  }
+  runDetectorAndReportHit(sampleNumber, trace.sampleRateInHz); // leftovers
+  adcTrace_close(&trace);
+  detector_getCurrentPowerValues(powerValues);
+  printf("final power");
+  for (uint16_t i = INIT_VAL; i < FILTER_FREQUENCY_COUNT; i++) {
+    printf(" %.6e", powerValues[i]);
+  }
+  printf("\n");
+  printf("%llu samples in %.3f s, %.0f samples/s, %.1f x real time\n",
+         (unsigned long long)sampleNumber, elapsed, sampleNumber / elapsed,
+         (double)sampleNumber / trace.sampleRateInHz / elapsed);
+  printBufferStats();
+  detector_printThresholdStats();
+  return true;
+}
+
+// Runs the per-stage benchmark and optionally writes its results as CSV.
+static bool runBenchmark(const char *csvPath) {
+  benchmark_run(true);
+  if (csvPath == NULL)
+    return true;
+  FILE *csvFile = fopen(csvPath, "w");
+  if (csvFile == NULL) {
+    printf("can't create %s\n", csvPath);
+    return false;
+  }
+  benchmark_printCsv(csvFile);
+  fclose(csvFile);
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc >= 2 && strcmp(argv[1], "test") == INIT_VAL)
+    return runTests() ? EXIT_SUCCESS : EXIT_FAILURE;
+  if (argc >= 3 && strcmp(argv[1], "shoot") == INIT_VAL) {
+    int frequencyNumber = atoi(argv[2]);
+    int shotCount = argc >= 4 ? atoi(argv[3]) : DEFAULT_SHOT_COUNT;
+    detector_backend_t backend =
+        argc >= 5 ? parseBackend(argv[4]) : DETECTOR_BACKEND_IIR;
+    if (frequencyNumber >= INIT_VAL &&
+        frequencyNumber < FILTER_FREQUENCY_COUNT && shotCount > INIT_VAL) {
+      runShots(frequencyNumber, shotCount, backend);
+      return EXIT_SUCCESS;
+    }
+  }
+  if (argc >= 4 && strcmp(argv[1], "record") == INIT_VAL) {
+    int frequencyNumber = atoi(argv[3]);
+    int shotCount = argc >= 5 ? atoi(argv[4]) : DEFAULT_SHOT_COUNT;
+    if (frequencyNumber >= INIT_VAL &&
+        frequencyNumber < FILTER_FREQUENCY_COUNT && shotCount > INIT_VAL)
+      return recordShots(argv[2], frequencyNumber, shotCount) ? EXIT_SUCCESS
+                                                              : EXIT_FAILURE;
+  }
+  if (argc >= 3 && strcmp(argv[1], "replay") == INIT_VAL) {
+    detector_backend_t backend =
+        argc >= 4 ? parseBackend(argv[3]) : DETECTOR_BACKEND_IIR;
+    int detectorCallSamples = argc >= 5 ? atoi(argv[4]) : DETECTOR_CALL_SAMPLES;
+    isr_setOverrunPolicy(argc >= 6 ? parseOverrunPolicy(argv[5])
+                                   : ISR_OVERRUN_DROP_NEWEST);
+    detector_setThresholdMode(argc >= 7 ? parseThresholdMode(argv[6])
+                                        : DETECTOR_THRESHOLD_MEDIAN);
+    if (detectorCallSamples > INIT_VAL)
+      return replayTrace(argv[2], backend, detectorCallSamples) ? EXIT_SUCCESS
+                                                                : EXIT_FAILURE;
+  }
+  if (argc >= 2 && strcmp(argv[1], "bench") == INIT_VAL)
+    return runBenchmark(argc >= 3 ? argv[2] : NULL) ? EXIT_SUCCESS
+                                                    : EXIT_FAILURE;
+  printUsage(argv[0]);
+  return EXIT_FAILURE;
+}
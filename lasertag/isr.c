@@ -14,90 +14,270 @@
 // Converter (ADC) is implemented in isr.c Values are added to this buffer by
 // the code in isr.c. Values are removed from this queue by code in detector.c
 
-#define ADC_BUFFER_SIZE 100000
 #define INIT_VAL 0
 #define TEST_SIZE 20
 #define RUN_TEST_SIZE 5
-#define DECREMENT -1
+#define BITS_PER_WORD 32
+#define MICROSECONDS_PER_SECOND 1e6
+#define MILLISECONDS_PER_SECOND 1000
+
+// The buffer must hold every sample that arrives while the main loop is away
+// from detector(), and must be a power of two so indexes can be masked instead
+// of wrapped. The size is the smallest power of two that covers
+// ISR_MAX_DETECTOR_LATENCY_MS of samples.
+#define SAMPLES_PER_MILLISECOND (ISR_FREQUENCY_IN_HZ / MILLISECONDS_PER_SECOND)
+#define ADC_BUFFER_MIN_SIZE                                                    \
+  (ISR_MAX_DETECTOR_LATENCY_MS * SAMPLES_PER_MILLISECOND)
+#define SMEAR_BITS(x, shift) ((x) | ((x) >> (shift)))
+#define ROUND_UP_TO_POWER_OF_TWO(x)                                            \
+  (SMEAR_BITS(                                                                 \
+       SMEAR_BITS(SMEAR_BITS(SMEAR_BITS(SMEAR_BITS((x)-1, 1), 2), 4), 8),      \
+       16) +                                                                   \
+   1)
+#define ADC_BUFFER_SIZE ROUND_UP_TO_POWER_OF_TWO(ADC_BUFFER_MIN_SIZE)
+#define ADC_BUFFER_INDEX_MASK (ADC_BUFFER_SIZE - 1)
+_Static_assert((ADC_BUFFER_SIZE & ADC_BUFFER_INDEX_MASK) == 0,
+               "ADC_BUFFER_SIZE must be a power of two");
+_Static_assert(ADC_BUFFER_SIZE >= ADC_BUFFER_MIN_SIZE &&
+                   ADC_BUFFER_SIZE < 2 * ADC_BUFFER_MIN_SIZE,
+               "ADC_BUFFER_SIZE must be the smallest power of two that holds "
+               "ISR_MAX_DETECTOR_LATENCY_MS of samples");
+
+// The private timer is only there on the board and in the host build.
+#if defined(ISR_TIMING) && (defined(ZYBO_BOARD) || defined(HOST_BUILD))
+#define ISR_TIMING_ENABLED
+#endif
 
 // This implements a dedicated circular buffer for storing values
 // from the ADC until they are read and processed by detector().
-// adcBuffer_t is similar to a queue.
+// It is a single-producer/single-consumer ring: only isr_function() writes
+// indexIn and only the detector writes indexOut, so neither side has to
+// disable interrupts. The indexes run freely and are masked on access; the
+// element count is indexIn - indexOut, which can exceed ADC_BUFFER_SIZE under
+// ISR_OVERRUN_DROP_OLDEST until the detector skips over the lost samples.
 typedef struct {
-  uint32_t indexIn;               // New values go here.
-  uint32_t indexOut;              // Pull old values from here.
-  uint32_t elementCount;          // Number of elements in the buffer.
-  uint32_t data[ADC_BUFFER_SIZE]; // Values are stored here.
+  uint32_t indexIn;               // New values go here. Written by the ISR.
+  uint32_t indexOut;              // Pull old values from here. Detector only.
+  uint16_t data[ADC_BUFFER_SIZE]; // Values are stored here, 12-bit ADC.
 } adcBuffer_t;
 
 // This is the instantiation of adcBuffer.
 volatile static adcBuffer_t adcBuffer;
-uint32_t incrementIndex(uint32_t currIndex);
+
+static isr_timingStats_t timingStats;
+
+// Overrun accounting. The ISR writes overrunCount and highWatermark, the
+// detector writes the resync counts.
+static isr_overrunPolicy_t overrunPolicy = ISR_OVERRUN_DROP_NEWEST;
+volatile static uint32_t overrunCount;
+volatile static uint32_t highWatermark;
+static uint32_t resyncCount;
+static uint32_t discardCount;
+static uint32_t resyncedOverrunCount; // overrunCount at the last resync
 
 // Init adcBuffer.
 void adcBufferInit() {
   adcBuffer.indexIn = INIT_VAL;
   adcBuffer.indexOut = INIT_VAL;
-  adcBuffer.elementCount = INIT_VAL;
-  // initializes buffer with 0's
-  for (uint32_t i = INIT_VAL; i < ADC_BUFFER_SIZE; i++) {
-    adcBuffer.data[i] = INIT_VAL;
-  }
+  overrunCount = INIT_VAL;
+  highWatermark = INIT_VAL;
+  resyncCount = INIT_VAL;
+  discardCount = INIT_VAL;
+  resyncedOverrunCount = INIT_VAL;
+  // no need to clear data[], a slot is always written before it is read
 }
 
 // Performs inits for anything in isr.c
 void isr_init() {
   adcBufferInit(); // init functions
+  isr_resetTimingStats();
   trigger_init();
   lockoutTimer_init();
   transmitter_init();
   hitLedTimer_init();
 }
 
+// Returns the log2 histogram bucket for a tick count (see isr_timingStats_t).
+static inline uint32_t timingBucket(uint32_t ticks) {
+  uint32_t bucket = ticks ? BITS_PER_WORD - __builtin_clz(ticks) : INIT_VAL;
+  return bucket < ISR_TIMING_BUCKET_COUNT ? bucket
+                                          : ISR_TIMING_BUCKET_COUNT - 1;
+}
+
+#ifdef ISR_TIMING_ENABLED
+// Records one isr_function() call. The private timer counts down from
+// ticksPerPeriod and reloads when the interrupt fires, so the count at entry
+// says how late the ISR started. If the count at exit is higher than at entry
+// the timer reloaded while the ISR was running: the next deadline was missed.
+static inline void recordTiming(uint32_t entryCount, uint32_t exitCount) {
+  uint32_t period = timingStats.ticksPerPeriod;
+  uint32_t latency = entryCount < period ? period - entryCount : INIT_VAL;
+  uint32_t duration = entryCount - exitCount;
+  if (exitCount > entryCount) {
+    duration += period;
+    timingStats.missedDeadlineCount++;
+  }
+  timingStats.invocationCount++;
+  timingStats.latencyHistogram[timingBucket(latency)]++;
+  timingStats.durationHistogram[timingBucket(duration)]++;
+  if (latency > timingStats.worstLatency)
+    timingStats.worstLatency = latency;
+  if (duration > timingStats.worstDuration)
+    timingStats.worstDuration = duration;
+}
+#endif
+
 // This function is invoked by the timer interrupt at 100 kHz.
-void isr_function() {                              // Task 2
+void isr_function() { // Task 2
+#ifdef ISR_TIMING_ENABLED
+  uint32_t entryCount = interrupts_getPrivateTimerCounterValue();
+#endif
   isr_addDataToAdcBuffer(interrupts_getAdcData()); // adds ADC data to buffer
   trigger_tick();                                  // ticks begin
   transmitter_tick();
   hitLedTimer_tick();
   lockoutTimer_tick();
+#ifdef ISR_TIMING_ENABLED
+  recordTiming(entryCount, interrupts_getPrivateTimerCounterValue());
+#endif
+}
+
+// Copies the ISR timing statistics gathered since isr_init() into stats.
+void isr_getTimingStats(isr_timingStats_t *stats) { *stats = timingStats; }
+
+// Clears the ISR timing statistics.
+void isr_resetTimingStats() {
+  timingStats = (isr_timingStats_t){INIT_VAL};
+#ifdef ISR_TIMING_ENABLED
+  timingStats.ticksPerPeriod =
+      interrupts_getPrivateTimerTicksPerSecond() / ISR_FREQUENCY_IN_HZ;
+#endif
+}
+
+// Prints one histogram, skipping empty buckets.
+static void printTimingHistogram(const char *name, const uint32_t histogram[],
+                                 double microsecondsPerTick) {
+  printf("%s:\n", name);
+  for (uint32_t b = INIT_VAL; b < ISR_TIMING_BUCKET_COUNT; b++) {
+    if (histogram[b] == INIT_VAL)
+      continue;
+    uint32_t low = b ? 1 << (b - 1) : INIT_VAL; // first tick count in bucket
+    if (b == ISR_TIMING_BUCKET_COUNT - 1)
+      printf("  >= %8.3f us: %u\n", low * microsecondsPerTick, histogram[b]);
+    else
+      printf("  %8.3f - %8.3f us: %u\n", low * microsecondsPerTick,
+             (1 << b) * microsecondsPerTick, histogram[b]);
+  }
+}
+
+// Prints the ISR timing histograms, worst cases and missed deadlines.
+void isr_printTimingStats() {
+  if (timingStats.ticksPerPeriod == INIT_VAL) {
+    printf("ISR timing is not available in this build.\n");
+    return;
+  }
+  double microsecondsPerTick = MICROSECONDS_PER_SECOND / ISR_FREQUENCY_IN_HZ /
+                               timingStats.ticksPerPeriod;
+  printf("ISR timing over %u invocations:\n", timingStats.invocationCount);
+  printTimingHistogram("entry latency", timingStats.latencyHistogram,
+                       microsecondsPerTick);
+  printTimingHistogram("duration", timingStats.durationHistogram,
+                       microsecondsPerTick);
+  printf("worst latency %.3f us, worst duration %.3f us, %u missed deadlines\n",
+         timingStats.worstLatency * microsecondsPerTick,
+         timingStats.worstDuration * microsecondsPerTick,
+         timingStats.missedDeadlineCount);
 }
 
 // This adds data to the ADC queue. Data are removed from this queue and used by
-// the detector.
+// the detector. Producer side: only touches indexIn, never indexOut, since
+// moving indexOut here would race the detector. What happens to a sample that
+// arrives when the buffer is full depends on the overrun policy.
 void isr_addDataToAdcBuffer(uint32_t adcData) {
-  adcBuffer.data[adcBuffer.indexIn] = adcData;
-  adcBuffer.indexIn = incrementIndex(adcBuffer.indexIn);
-  // buffer full, overwrites to push on new value
-  if (adcBuffer.elementCount >= (ADC_BUFFER_SIZE + DECREMENT))
-    adcBuffer.indexOut = incrementIndex(adcBuffer.indexOut);
-  else {
-    ++(adcBuffer.elementCount);
+  uint32_t indexIn = adcBuffer.indexIn;
+  uint32_t count = indexIn - adcBuffer.indexOut;
+  if (count >= ADC_BUFFER_SIZE) { // buffer full
+    overrunCount++;
+    if (overrunPolicy != ISR_OVERRUN_DROP_OLDEST)
+      return;
+    count = ADC_BUFFER_SIZE - 1; // the oldest sample is overwritten below
   }
+  adcBuffer.data[indexIn & ADC_BUFFER_INDEX_MASK] = adcData;
+  adcBuffer.indexIn = indexIn + 1; // publish only after the data is written
+  if (count >= highWatermark)
+    highWatermark = count + 1;
 }
 
-// This removes a value from the ADC buffer.
+// Returns indexOut, moved past any samples that ISR_OVERRUN_DROP_OLDEST has
+// overwritten. Consumer side.
+static inline uint32_t oldestIndexOut(uint32_t indexIn) {
+  uint32_t indexOut = adcBuffer.indexOut;
+  if (indexIn - indexOut > ADC_BUFFER_SIZE)
+    indexOut = indexIn - ADC_BUFFER_SIZE;
+  return indexOut;
+}
+
+// This removes a value from the ADC buffer. Returns 0 if the buffer is empty.
 uint32_t isr_removeDataFromAdcBuffer() {
-  uint32_t currentIndex =
-      adcBuffer.indexOut; // saves current index for data reading
-  adcBuffer.indexOut = incrementIndex(adcBuffer.indexOut);
-  // lowers elementCount when read
-  if (adcBuffer.elementCount >= 1) {
-    --adcBuffer.elementCount;
+  uint32_t indexIn = adcBuffer.indexIn; // snapshot of the producer
+  uint32_t indexOut = oldestIndexOut(indexIn);
+  if (indexOut == indexIn) // empty
+    return INIT_VAL;
+  uint32_t data = adcBuffer.data[indexOut & ADC_BUFFER_INDEX_MASK];
+  adcBuffer.indexOut = indexOut + 1; // release the slot after reading it
+  return data;
+}
+
+// Copies up to max values from the ADC buffer into dst, oldest first, and
+// returns how many were copied. Consumer side: safe to call with interrupts
+// enabled, indexOut is only written once after all values are copied.
+uint32_t isr_drainAdcBuffer(uint32_t *dst, uint32_t max) {
+  uint32_t indexIn = adcBuffer.indexIn; // snapshot of the producer
+  uint32_t indexOut = oldestIndexOut(indexIn);
+  uint32_t count = indexIn - indexOut;
+  if (count > max)
+    count = max;
+  for (uint32_t i = INIT_VAL; i < count; i++) {
+    dst[i] = adcBuffer.data[(indexOut + i) & ADC_BUFFER_INDEX_MASK];
   }
-  return adcBuffer.data[currentIndex];
+  adcBuffer.indexOut = indexOut + count;
+  return count;
 }
 
 // This returns the number of values in the ADC buffer.
-uint32_t isr_adcBufferElementCount() { return adcBuffer.elementCount; }
+uint32_t isr_adcBufferElementCount() {
+  uint32_t count = adcBuffer.indexIn - adcBuffer.indexOut;
+  return count < ADC_BUFFER_SIZE ? count : ADC_BUFFER_SIZE;
+}
 
-// handles wrapping for indexes. Assumes increment by 1 only
-uint32_t incrementIndex(uint32_t currIndex) {
-  // controls wrapping around end of buffer
-  if (currIndex >= (ADC_BUFFER_SIZE + DECREMENT))
-    return INIT_VAL;
-  else
-    return ++currIndex;
+// Selects what happens when the ADC buffer is full.
+void isr_setOverrunPolicy(isr_overrunPolicy_t policy) {
+  overrunPolicy = policy;
+}
+
+// Copies the ADC buffer statistics into stats.
+void isr_getBufferStats(isr_bufferStats_t *stats) {
+  stats->policy = overrunPolicy;
+  stats->capacity = ADC_BUFFER_SIZE;
+  stats->elementCount = isr_adcBufferElementCount();
+  stats->highWatermark = highWatermark;
+  stats->overrunCount = overrunCount;
+  stats->resyncCount = resyncCount;
+  stats->discardCount = discardCount;
+}
+
+// Empties the ADC buffer if samples were lost since the last resync. Consumer
+// side: everything buffered came before the gap, so it is all thrown away.
+bool isr_resyncAfterOverrun() {
+  uint32_t overruns = overrunCount;
+  if (overrunPolicy != ISR_OVERRUN_RESYNC || overruns == resyncedOverrunCount)
+    return false;
+  resyncedOverrunCount = overruns;
+  uint32_t indexIn = adcBuffer.indexIn;
+  discardCount += indexIn - adcBuffer.indexOut;
+  adcBuffer.indexOut = indexIn;
+  resyncCount++;
+  return true;
 }
 
 // Testing function to make sure ADC Buffer is functional
@@ -114,7 +294,7 @@ uint32_t isr_bufferTest() {
   for (uint8_t i = 0; i < TEST_SIZE;
        i++) { // loops to remove and read values from buffer
     printf("CURRENT DATA:  %d \n", isr_removeDataFromAdcBuffer());
-    printf("INDEX OUT: %d\n", adcBuffer.indexOut);
+    printf("INDEX OUT: %d\n", adcBuffer.indexOut & ADC_BUFFER_INDEX_MASK);
     printf("\n");
     printf("%d\n", isr_adcBufferElementCount());
   }
@@ -9,11 +9,61 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 
 #ifndef ISR_H_
 #define ISR_H_
+#include <stdbool.h>
 #include <stdint.h>
 
+// Comment out to stop isr_function() from timing itself (see
+// isr_getTimingStats()). Timing reads the ARM private timer, so it is only
+// done on the board and in the host build.
+#define ISR_TIMING
+
+#define ISR_FREQUENCY_IN_HZ 100000
+// Longest the main loop may go without calling detector(), in ms. The ADC
+// buffer holds at least this many samples; anything longer loses samples.
+#define ISR_MAX_DETECTOR_LATENCY_MS 250
+#define ISR_TIMING_BUCKET_COUNT 16
+
 typedef uint32_t
     isr_AdcValue_t; // Used to represent ADC values in the ADC buffer.
 
+// What isr_addDataToAdcBuffer() does when the ADC buffer is full.
+typedef enum {
+  ISR_OVERRUN_DROP_NEWEST, // Keep the buffered samples, lose the new one.
+  // Overwrite the oldest sample; the detector skips ahead to the newest
+  // samples. Keeps the detector current at the cost of an occasional sample
+  // being overwritten while the detector is reading it.
+  ISR_OVERRUN_DROP_OLDEST,
+  // Drop the new sample like ISR_OVERRUN_DROP_NEWEST, then the next time the
+  // detector runs it throws away what is buffered and restarts its filters,
+  // so that they never see the gap (see isr_resyncAfterOverrun()).
+  ISR_OVERRUN_RESYNC
+} isr_overrunPolicy_t;
+
+// ADC buffer statistics since isr_init().
+typedef struct {
+  isr_overrunPolicy_t policy;
+  uint32_t capacity;      // Samples the buffer can hold.
+  uint32_t elementCount;  // Samples in the buffer now.
+  uint32_t highWatermark; // Most samples the buffer has held.
+  uint32_t overrunCount;  // Samples lost because the buffer was full.
+  uint32_t resyncCount;   // Times the detector restarted after an overrun.
+  uint32_t discardCount;  // Buffered samples thrown away by those restarts.
+} isr_bufferStats_t;
+
+// How long isr_function() takes and how late it starts, in private timer
+// ticks. The histograms are log2-bucketed: bucket 0 counts 0 ticks, bucket b
+// counts [2^(b-1), 2^b) ticks and the last bucket also counts anything longer.
+typedef struct {
+  uint32_t invocationCount;
+  uint32_t ticksPerPeriod; // Timer ticks between interrupts (10 us).
+  uint32_t latencyHistogram[ISR_TIMING_BUCKET_COUNT];  // Timer to entry.
+  uint32_t durationHistogram[ISR_TIMING_BUCKET_COUNT]; // Entry to exit.
+  uint32_t worstLatency;
+  uint32_t worstDuration;
+  // Invocations that were still running when the next interrupt was due.
+  uint32_t missedDeadlineCount;
+} isr_timingStats_t;
+
 // isr provides the isr_function() where you will place functions that require
 // accurate timing. A buffer for storing values from the Analog to Digital
 // Converter (ADC) is implemented in isr.c Values are added to this buffer by
@@ -26,14 +76,42 @@ void isr_init();
 void isr_function();
 
 // This adds data to the ADC queue. Data are removed from this queue and used by
-// the detector.
+// the detector. Only the low 16 bits are kept (ADC values are 12 bits).
 void isr_addDataToAdcBuffer(uint32_t adcData);
 
 // This removes a value from the ADC buffer.
 uint32_t isr_removeDataFromAdcBuffer();
 
+// Copies up to max values from the ADC buffer into dst (oldest first) and
+// returns the number copied. The buffer is a single-producer/single-consumer
+// ring, so this does not require interrupts to be disabled.
+uint32_t isr_drainAdcBuffer(uint32_t *dst, uint32_t max);
+
 // This returns the number of values in the ADC buffer.
 uint32_t isr_adcBufferElementCount();
 
+// Selects what happens when the ADC buffer is full. The default is
+// ISR_OVERRUN_DROP_NEWEST. Kept across isr_init().
+void isr_setOverrunPolicy(isr_overrunPolicy_t policy);
+
+// Copies the ADC buffer statistics into stats.
+void isr_getBufferStats(isr_bufferStats_t *stats);
+
+// Consumer side of ISR_OVERRUN_RESYNC. If samples have been lost since the
+// last call, empties the ADC buffer and returns true; the caller must then
+// restart its filters. Always false under the other policies.
+bool isr_resyncAfterOverrun();
+
+// Copies the ISR timing statistics gathered since isr_init() into stats. All
+// zero if ISR_TIMING is off.
+void isr_getTimingStats(isr_timingStats_t *stats);
+
+// Clears the ISR timing statistics.
+void isr_resetTimingStats();
+
+// Prints the ISR timing histograms, worst cases and missed deadlines to the
+// console, with times in microseconds.
+void isr_printTimingStats();
+
 uint32_t isr_bufferTest();
 #endif /* ISR_H_ */
@@ -30,6 +30,7 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #include <assert.h>
 #include <stdio.h>
 
+#include "benchmark.h"
 #include "buttons.h"
 #include "detector.h"
 #include "filter.h"
@@ -50,10 +51,16 @@ int main() {
 
 #ifdef RUNNING_MODE_TESTS
   // queue_runTest(); // M1
+  // windowQueue_runTest(true); // mirrored FIR history
+  // fixedQueue_runTest(true); // compile-time capacity queue
   // filterTest_runTest(); // M3 T1
   // transmitter_runTest(); // M3 T2
   // detector_runTest(); // M3 T3
+  // detector_runThresholdTest(true); // adaptive noise floor
   // sound_runTest(); // M4
+  // soundMixer_runTest(true); // voice pool
+  // adpcm_runTest(true); // compressed sounds
+  // benchmark_run(true); // detector hot path, per stage
 
 #endif
 
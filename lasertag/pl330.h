@@ -0,0 +1,89 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef PL330_H_
+#define PL330_H_
+
+// Registers and instruction encodings of the PL330 DMA controller in the Zynq
+// PS (the same values as xdmaps_hw.h, which only the board BSP has). Shared by
+// audioOut.c, which writes DMA programs for it, and the host build's model of
+// it in platforms/host/audioModel.c. See the CoreLink DMA-330 TRM.
+
+// Register offsets. The per-channel ones are for channel 0.
+#define PL330_DS_OFFSET 0x000        // DMA manager status.
+#define PL330_INTEN_OFFSET 0x020     // Bit n: DMASEV n raises irq n.
+#define PL330_INTSTATUS_OFFSET 0x028 // Raised irqs that are enabled.
+#define PL330_INTCLR_OFFSET 0x02C    // Write 1s to clear raised irqs.
+#define PL330_FSC_OFFSET 0x034       // Bit n: channel n has faulted.
+#define PL330_CS0_OFFSET 0x100       // Channel 0 status.
+#define PL330_CPC0_OFFSET 0x104      // Channel 0 program counter.
+#define PL330_DBGSTATUS_OFFSET 0xD00 // Bit 0: debug instruction busy.
+#define PL330_DBGCMD_OFFSET 0xD04    // Write 0 to run DBGINST0/1.
+#define PL330_DBGINST0_OFFSET 0xD08
+#define PL330_DBGINST1_OFFSET 0xD0C
+
+#define PL330_DBGSTATUS_BUSY 0x01
+#define PL330_CS_STATUS_MASK 0x0F // Channel status field of CSn.
+#define PL330_CS_STOPPED 0x0
+#define PL330_CS_EXECUTING 0x1
+#define PL330_CS_WAITING_FOR_PERIPHERAL 0x7
+#define PL330_CS_FAULTING 0xF
+#define PL330_DBGCMD_EXECUTE 0
+
+// DBGINST0 for the debug thread to run a two-byte instruction, b0 then b1,
+// as the manager (channelThread 0) or as channel ch.
+#define PL330_DBGINST0(b1, b0, ch, channelThread)                              \
+  (((uint32_t)(b1) << 24) | ((uint32_t)(b0) << 16) | (((ch)&0x7) << 8) |       \
+   ((channelThread)&0x1))
+
+// Instruction opcodes (first byte). Operand bits are ORed in as noted.
+#define PL330_DMAEND 0x00
+#define PL330_DMAKILL 0x01
+#define PL330_DMALD 0x04     // | PL330_COND_*.
+#define PL330_DMAST 0x08     // | PL330_COND_*.
+#define PL330_DMASTP 0x29    // | PL330_COND_SINGLE/BURST, then peripheral << 3.
+#define PL330_DMALP 0x20     // | lc << 1, then iterations - 1.
+// | nf << 4 | lc << 2 | PL330_COND_*, then jump. A DMALPEND that loops
+// forever (nf = 0) has to be PL330_COND_ALWAYS, the others are DMASTP/DMALDP.
+#define PL330_DMALPEND 0x28
+#define PL330_DMAWFP 0x30    // | PL330_WFP_*, then peripheral << 3.
+#define PL330_DMASEV 0x34    // Then event << 3.
+#define PL330_DMAFLUSHP 0x35 // Then peripheral << 3.
+#define PL330_DMAGO 0xA0     // | ns << 1, then channel, then address.
+#define PL330_DMAMOV 0xBC    // Then PL330_MOV_*, then a 32-bit value.
+
+#define PL330_COND_ALWAYS 0x0
+#define PL330_COND_SINGLE 0x1
+#define PL330_COND_BURST 0x3
+#define PL330_WFP_SINGLE 0x0
+#define PL330_WFP_PERIPHERAL 0x1
+#define PL330_WFP_BURST 0x2
+#define PL330_LPEND_NOT_FOREVER 0x10
+#define PL330_LPEND_LC1 0x04
+#define PL330_LP_LC1 0x02
+#define PL330_MOV_SAR 0
+#define PL330_MOV_CCR 1
+#define PL330_MOV_DAR 2
+#define PL330_LP_MAX_ITERATIONS 256
+#define PL330_MAX_JUMP 255 // Bytes a DMALPEND can jump back.
+
+// Channel control register (CCR) fields. Sizes are log2 of the bytes in a
+// beat, lengths are beats per burst minus one.
+#define PL330_CCR_SRC_INC 0x1
+#define PL330_CCR_SRC_SIZE(s) ((uint32_t)(s) << 1)
+#define PL330_CCR_SRC_BURST_LEN(l) ((uint32_t)(l) << 4)
+#define PL330_CCR_DST_INC (0x1 << 14)
+#define PL330_CCR_DST_SIZE(s) ((uint32_t)(s) << 15)
+#define PL330_CCR_DST_BURST_LEN(l) ((uint32_t)(l) << 18)
+#define PL330_CCR_GET_SRC_SIZE(ccr) (((ccr) >> 1) & 0x7)
+#define PL330_CCR_GET_SRC_BURST_LEN(ccr) (((ccr) >> 4) & 0xF)
+#define PL330_CCR_GET_DST_SIZE(ccr) (((ccr) >> 15) & 0x7)
+#define PL330_CCR_GET_DST_BURST_LEN(ccr) (((ccr) >> 18) & 0xF)
+
+#endif /* PL330_H_ */
@@ -7,7 +7,9 @@ source code for personal or educational use.
 For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 */
 
+#include "fixedQueue.h"
 #include "queue.h"
+#include "windowQueue.h"
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -624,3 +626,164 @@ bool queue_runTest() {
   }
   return testResult;
 }
+
+// Pushes random values into a windowQueue_t and a full queue_t of the same
+// size side by side. After each push, checks the value that left the window,
+// every element of windowQueue_window() for a few window lengths, and
+// windowQueue_readElementAt(), against the queue. Also checks that
+// windowQueue_fill() restarts both copies of the mirror. A float window from
+// WINDOW_QUEUE_DEFINE() gets the same pushes and checks.
+#define WINDOW_QUEUE_TEST_SIZE 81 // Same as the FIR history.
+#define WINDOW_QUEUE_TEST_PUSH_COUNT (10 * WINDOW_QUEUE_TEST_SIZE + 7)
+#define WINDOW_QUEUE_TEST_FILL_VALUE 0.5
+static const queue_size_t windowQueueTestCounts[] = {
+    1, 11, WINDOW_QUEUE_TEST_SIZE - 1, WINDOW_QUEUE_TEST_SIZE};
+#define WINDOW_QUEUE_TEST_COUNT_COUNT                                          \
+  (sizeof(windowQueueTestCounts) / sizeof(windowQueueTestCounts[0]))
+WINDOW_QUEUE_DEFINE(testFloatWindow, float, WINDOW_QUEUE_TEST_SIZE);
+bool windowQueue_runTest(bool printMessageFlag) {
+  bool success = true; // Be optimistic.
+  if (printMessageFlag)
+    printf("===== Starting windowQueue_runTest() =====\n");
+  windowQueue_t window;
+  testFloatWindow_t floatWindow;
+  queue_t reference;
+  windowQueue_init(&window, WINDOW_QUEUE_TEST_SIZE, "test_window");
+  queue_init(&reference, WINDOW_QUEUE_TEST_SIZE, "test_window_reference");
+  for (uint32_t pass = 0; pass < 2 && success; pass++) {
+    // Both start out full of the same value, zero the first time.
+    double fillValue = pass == 0 ? 0.0 : WINDOW_QUEUE_TEST_FILL_VALUE;
+    if (pass > 0)
+      windowQueue_fill(&window, fillValue);
+    testFloatWindow_fill(&floatWindow, (float)fillValue);
+    for (uint32_t i = 0; i < WINDOW_QUEUE_TEST_SIZE; i++)
+      queue_overwritePush(&reference, fillValue);
+    for (uint32_t i = 0; i < WINDOW_QUEUE_TEST_PUSH_COUNT && success; i++) {
+      double value = (double)rand() / (double)RAND_MAX;
+      double expectedOldest = queue_readElementAt(&reference, 0);
+      queue_overwritePush(&reference, value);
+      double oldest = windowQueue_push(&window, value);
+      if (oldest != expectedOldest) {
+        printf("windowQueue_push() returned %lf, should be %lf.\n", oldest,
+               expectedOldest);
+        success = false;
+      }
+      float floatOldest = testFloatWindow_push(&floatWindow, (float)value);
+      if (floatOldest != (float)expectedOldest) {
+        printf("testFloatWindow_push() returned %f, should be %f.\n",
+               floatOldest, (float)expectedOldest);
+        success = false;
+      }
+      for (uint32_t c = 0; c < WINDOW_QUEUE_TEST_COUNT_COUNT; c++) {
+        queue_size_t count = windowQueueTestCounts[c];
+        const double *w = windowQueue_window(&window, count);
+        const float *fw = testFloatWindow_window(&floatWindow, count);
+        for (queue_size_t j = 0; j < count; j++) {
+          double expected = queue_readElementAt(
+              &reference, WINDOW_QUEUE_TEST_SIZE - count + j);
+          if (w[j] != expected || fw[j] != (float)expected) {
+            printf("window(%u)[%u] is %lf (float %f), should be %lf.\n",
+                   count, j, w[j], fw[j], expected);
+            success = false;
+            break;
+          }
+        }
+      }
+      for (queue_index_t j = 0; j < WINDOW_QUEUE_TEST_SIZE; j++) {
+        if (windowQueue_readElementAt(&window, j) !=
+            queue_readElementAt(&reference, j)) {
+          printf("windowQueue_readElementAt(%u) doesn't match the queue.\n",
+                 j);
+          success = false;
+          break;
+        }
+      }
+    }
+  }
+  windowQueue_garbageCollect(&window);
+  queue_garbageCollect(&reference);
+  if (printMessageFlag)
+    printf("windowQueue_runTest %s.\n", success ? "passed" : "failed");
+  return success;
+}
+
+// Runs a random mix of push(), pop() and overwritePush() on a fixed queue and
+// a queue_t of the same capacity. After each operation, checks the element
+// count, full/empty, the flags and every element against the queue_t.
+// Pushing onto a full queue_t or popping an empty one prints an error, so
+// those cases are only run on the fixed queue and checked through its flags.
+#define FIXED_QUEUE_TEST_CAPACITY 64
+#define FIXED_QUEUE_TEST_OPERATION_COUNT 20000
+#define FIXED_QUEUE_TEST_OPERATION_KINDS 3 // push, pop, overwritePush
+FIXED_QUEUE_DEFINE(testFixedQueue, double, FIXED_QUEUE_TEST_CAPACITY, true);
+bool fixedQueue_runTest(bool printMessageFlag) {
+  bool success = true; // Be optimistic.
+  if (printMessageFlag)
+    printf("===== Starting fixedQueue_runTest() =====\n");
+  testFixedQueue_t q;
+  queue_t reference;
+  testFixedQueue_init(&q);
+  queue_init(&reference, FIXED_QUEUE_TEST_CAPACITY, "test_fixed_reference");
+  bool expectedUnderflow = false;
+  bool expectedOverflow = false;
+  for (uint32_t i = 0; i < FIXED_QUEUE_TEST_OPERATION_COUNT && success; i++) {
+    double value = (double)rand() / (double)RAND_MAX;
+    switch (rand() % FIXED_QUEUE_TEST_OPERATION_KINDS) {
+    case 0:
+      if (queue_full(&reference)) {
+        expectedOverflow = true;
+        if (testFixedQueue_push(&q, value)) {
+          printf("push() onto a full fixed queue succeeded.\n");
+          success = false;
+        }
+      } else {
+        expectedUnderflow = false;
+        queue_push(&reference, value);
+        testFixedQueue_push(&q, value);
+      }
+      break;
+    case 1:
+      if (queue_empty(&reference)) {
+        expectedUnderflow = true;
+        if (testFixedQueue_pop(&q) != 0.0) {
+          printf("pop() of an empty fixed queue didn't return 0.\n");
+          success = false;
+        }
+      } else {
+        expectedOverflow = false;
+        if (testFixedQueue_pop(&q) != queue_pop(&reference)) {
+          printf("pop() returned the wrong value.\n");
+          success = false;
+        }
+      }
+      break;
+    default:
+      expectedUnderflow = false;
+      queue_overwritePush(&reference, value);
+      testFixedQueue_overwritePush(&q, value);
+      break;
+    }
+    if (testFixedQueue_elementCount(&q) != queue_elementCount(&reference) ||
+        testFixedQueue_full(&q) != queue_full(&reference) ||
+        testFixedQueue_empty(&q) != queue_empty(&reference) ||
+        testFixedQueue_underflow(&q) != expectedUnderflow ||
+        testFixedQueue_overflow(&q) != expectedOverflow) {
+      printf("fixed queue status differs after operation %u: %u elements, "
+             "should be %u.\n",
+             i, testFixedQueue_elementCount(&q),
+             queue_elementCount(&reference));
+      success = false;
+    }
+    for (uint32_t j = 0; j < queue_elementCount(&reference) && success; j++) {
+      if (testFixedQueue_readElementAt(&q, j) !=
+          queue_readElementAt(&reference, j)) {
+        printf("readElementAt(%u) differs after operation %u.\n", j, i);
+        success = false;
+      }
+    }
+  }
+  queue_garbageCollect(&reference);
+  if (printMessageFlag)
+    printf("fixedQueue_runTest %s.\n", success ? "passed" : "failed");
+  return success;
+}
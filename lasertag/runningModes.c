@@ -107,6 +107,17 @@ void runningModes_printRunTimeStatistics() {
   display_print("Unprocessed elements in ADC queue:");
   uint32_t remainingElementCount = isr_adcBufferElementCount();
   display_printlnDecimalInt(remainingElementCount);
+  // Print out how full the ADC queue got and how many samples were lost.
+  isr_bufferStats_t bufferStats;
+  isr_getBufferStats(&bufferStats);
+  display_print("ADC queue high-watermark: ");
+  display_printlnDecimalInt(bufferStats.highWatermark);
+  display_print("ADC samples lost to overrun: ");
+  display_printlnDecimalInt(bufferStats.overrunCount);
+  if (bufferStats.resyncCount) {
+    display_print("Detector resyncs: ");
+    display_printlnDecimalInt(bufferStats.resyncCount);
+  }
   display_printChar('\n');
   double runningSeconds, isrRunningSeconds, mainLoopRunningSeconds;
   runningSeconds = intervalTimer_getTotalDurationInSeconds(TOTAL_RUNTIME_TIMER);
@@ -141,6 +152,13 @@ void runningModes_printRunTimeStatistics() {
   display_print("Total interrupts:            ");
   display_printlnDecimalInt(interruptCount);
   display_printChar('\n');
+  // Print out the ISR deadline misses; the full histograms go to the console.
+  isr_timingStats_t isrTimingStats;
+  isr_getTimingStats(&isrTimingStats);
+  display_print("Missed ISR deadlines: ");
+  display_printlnDecimalInt(isrTimingStats.missedDeadlineCount);
+  display_printChar('\n');
+  isr_printTimingStats();
   display_print("Detector invocation count: ");
   // Print out detector invocations per second.
   display_printlnDecimalInt(detectorInvocationCount);
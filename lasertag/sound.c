@@ -8,15 +8,9 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 */
 
 #include "sound.h"
+#include "audioOut.h"
 #include "interrupts.h" // Just for sound_runTest().
-#include "sounds/bcfire01_48k.wav.h"
-#include "sounds/gameBoyStartup.wav.h"
-#include "sounds/gameOver48k.wav.h"
-#include "sounds/gunEmpty48k.wav.h"
-#include "sounds/ouch48k.wav.h"
-#include "sounds/pacmanDeath.wav.h"
-#include "sounds/powerUp48k.wav.h"
-#include "sounds/screamAndDie48k.wav.h"
+#include "soundPack.h" // Generated from sounds/sounds.txt.
 #include "timer_ps.h"
 #include "xiicps.h"
 #include "xil_printf.h"
@@ -38,10 +32,43 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #define UART_BASEADDR XPAR_PS7_UART_1_BASEADDR
 
 #define SOUND_MULTIPLIER INT16_MAX / 3 // Primitive volume control.
-
-#define ONE_SECOND_OF_SOUND_ARRAY_SIZE                                         \
-  48000 // The sample rate is 48k so that is 1 second's worth.
-uint16_t soundOfSilence[ONE_SECOND_OF_SOUND_ARRAY_SIZE];
+#define SOUND_RENDER_BUFFER_SIZE 64 // Mixed samples rendered at once.
+
+// Comment this out to have sound_tick() write every sample into the TX FIFO
+// instead of the DMA (see audioOut.h).
+#define SOUND_DMA_OUTPUT
+
+// Voice priorities, see soundMixer_start(). Higher wins.
+#define SOUND_PRIORITY_SILENCE 0
+#define SOUND_PRIORITY_EFFECT 1 // Gun sounds.
+#define SOUND_PRIORITY_PLAYER 2 // Hits, game start.
+#define SOUND_PRIORITY_GAME 3   // Losing a life, game over.
+#define SOUND_PRIORITY_QUEUE SOUND_PRIORITY_GAME // See sound_queueSound().
+
+#define SOUND_SAMPLE_RATE SOUND_MIXER_SAMPLE_RATE // The CODEC's rate.
+#define MILLISECONDS_PER_SECOND 1000
+
+// sounds/sounds.txt lists every sound but silence, in sound_sounds_t order,
+// so a sound's value is its place in soundPack_index[].
+_Static_assert(SOUND_PACK_COUNT == sound_oneSecondSilence_e,
+               "sounds/sounds.txt must list the sounds before silence");
+_Static_assert(SOUND_PACK_SAMPLE_RATE == SOUND_SAMPLE_RATE,
+               "sounds must be packed at the CODEC's sample rate");
+
+// Mixer priority of each sound, in sound_sounds_t order.
+static const uint8_t sound_priorities[] = {
+    SOUND_PRIORITY_PLAYER,  // sound_gameStart_e
+    SOUND_PRIORITY_EFFECT,  // sound_gunFire_e
+    SOUND_PRIORITY_PLAYER,  // sound_hit_e
+    SOUND_PRIORITY_EFFECT,  // sound_gunClick_e
+    SOUND_PRIORITY_EFFECT,  // sound_gunReload_e
+    SOUND_PRIORITY_GAME,    // sound_loseLife_e
+    SOUND_PRIORITY_GAME,    // sound_gameOver_e
+    SOUND_PRIORITY_GAME,    // sound_returnToBase_e
+    SOUND_PRIORITY_SILENCE, // sound_oneSecondSilence_e
+};
+_Static_assert(sizeof(sound_priorities) == sound_oneSecondSilence_e + 1,
+               "one priority per sound");
 
 // Declared below the sound state-machine code.
 int AudioInitialize(u16 timerID, u16 iicID, u32 i2sAddr);
@@ -57,12 +84,21 @@ static bool sound_initFlag = false;
 // playing a sound.
 static volatile bool sound_playSoundFlag = false;
 
-// Keep track of the base pointer to the sound array with current sample-rate
-// and sample count.
-static uint16_t *sound_array; // Base pointer to the sound array.
+// Keep track of the sound set by sound_setSound(). Sounds are IMA-ADPCM
+// blocks in the sound pack (see adpcm.h), except for silence, which the mixer
+// generates as it plays.
+static soundMixer_segment_t sound_segment; // count is 0 until a sound is set.
+static uint8_t sound_priority;             // Mixer priority for this sound.
+
+// The voice that sound_queueSound() and friends queue behind.
+static soundMixer_handle_t sound_queueHandle = SOUND_MIXER_NO_VOICE;
 
-// static uint32_t sound_sampleRate;  // Sample rate for this sound.
-static uint32_t sound_sampleCount; // Number of samples in this sound.
+#ifndef SOUND_DMA_OUTPUT
+// Mixed samples waiting to go into the TX FIFO.
+static int16_t sound_renderBuffer[SOUND_RENDER_BUFFER_SIZE];
+static uint32_t sound_renderIndex; // Next sample to send.
+static uint32_t sound_renderCount; // Samples in sound_renderBuffer.
+#endif
 
 // Keep track of the current volume setting.
 static sound_volume_t sound_currentVolume = sound_minimumVolume_e;
@@ -106,9 +142,12 @@ sound_status_t sound_init() {
   // Setup the audio CODEC.
   AudioInitialize(SCU_TIMER_ID, AUDIO_IIC_ID, AUDIO_CTRL_BASEADDR);
   sound_initFlag = true;
-  // Initialize the silence array.
-  for (uint32_t i = 0; i < ONE_SECOND_OF_SOUND_ARRAY_SIZE; i++)
-    soundOfSilence[i] = NO_SOUND;
+  soundMixer_init();
+#ifdef SOUND_DMA_OUTPUT
+  audioOut_init();
+#else
+  sound_renderIndex = sound_renderCount = 0;
+#endif
   sound_setVolume(sound_minimumVolume_e); // Init the volume level.
   return SOUND_STATUS_OK;
 }
@@ -147,7 +186,6 @@ void debugStatePrint() {
 
 void sound_tick() {
   //  debugStatePrint();
-  static uint32_t arrayIndex = 0;
   // Action switch statement.
   switch (currentState) {
   case sound_init_st:
@@ -169,34 +207,49 @@ void sound_tick() {
     break;
   case sound_wait_st:
     if (sound_playSoundFlag) {
-      arrayIndex = 0;
       currentState = sound_play_st;
+#ifdef SOUND_DMA_OUTPUT
+      audioOut_start(); // Mix two blocks, enable the TX FIFO, start the DMA.
+#else
+      sound_renderIndex = sound_renderCount = 0;
       sound_resetTxFifo();  // Reset the TX FIFO.
       sound_enableTxFifo(); // Enable the TX FIFO, disable mute.
+#endif
     }
     break;
   case sound_play_st:
-    // Each time you enter this state, add as many samples as will fit in the
-    // FIFO.
-    if (sound_array == NULL) {
-      printf("ERROR, sound_tick: sound array has not been set.\n");
-      return;
+#ifdef SOUND_DMA_OUTPUT
+    // The DMA keeps the FIFO full, just mix the blocks it has finished.
+    audioOut_service();
+    // All done once every voice is and only silence is left to play.
+    if (soundMixer_activeVoiceCount() == 0 && audioOut_isSilent()) {
+      sound_playSoundFlag = false;
+      audioOut_stop();              // Stop the DMA, disable the TX FIFO.
+      currentState = sound_wait_st; // Go back to the wait state.
     }
+#else
+    // Each time you enter this state, add as many mixed samples as will fit in
+    // the FIFO.
     // This while-loop continues to load sound-data into the FIFOs until it is
-    // full or the sound data are exhausted.
+    // full or every voice is done.
     while (!(Xil_In32(AUDIO_CTRL_BASEADDR + I2S_FIFO_STS_REG) &
              0b0010)) { // while room in FIFO.
-      uint32_t sampleValue =
-          sound_array[arrayIndex] * sound_currentVolume; // Scale by volume.
-      sound_sendDataToBothChannels(
-          sampleValue); // Send the sound data to the left and right channels.
-      arrayIndex++;     // Go to next sample.
-      if (arrayIndex == sound_sampleCount) { // All done?
-        sound_playSoundFlag = false;         // Yes.
-        sound_disableTxFifo();               // Disable the TX FIFO.
-        currentState = sound_wait_st;        // Go back to the wait state.
+      if (sound_renderIndex == sound_renderCount) { // Need more samples?
+        if (soundMixer_activeVoiceCount() == 0) {   // All done?
+          sound_playSoundFlag = false;              // Yes.
+          sound_disableTxFifo();                    // Disable the TX FIFO.
+          currentState = sound_wait_st; // Go back to the wait state.
+          break;
+        }
+        soundMixer_render(sound_renderBuffer, SOUND_RENDER_BUFFER_SIZE);
+        sound_renderIndex = 0;
+        sound_renderCount = SOUND_RENDER_BUFFER_SIZE;
       }
+      // Send the mixed sample to the left and right channels.
+      sound_sendDataToBothChannels(
+          audioOut_fifoWord(sound_renderBuffer[sound_renderIndex++]));
     }
+#endif
     break;
   }
 }
@@ -206,67 +259,81 @@ bool sound_isBusy() {
   return (sound_playSoundFlag); // Busy if NOT in the wait state.
 }
 
-// Stops the sound and resets the state-machine to the wait state.
+// Stops all sounds and resets the state-machine to the wait state.
 void sound_stopSound() {
+  soundMixer_stopAll();
+#ifdef SOUND_DMA_OUTPUT
+  audioOut_stop(); // The DMA would keep replaying the last blocks.
+#endif
   sound_playSoundFlag = false; // disable the state-machine.
   currentState =
       sound_wait_st; // Force the state-machine back to the wait state.
 }
 
+// Returns the number of samples that last milliseconds.
+static uint32_t sound_millisecondsToSamples(uint32_t milliseconds) {
+  return (uint64_t)milliseconds * SOUND_SAMPLE_RATE / MILLISECONDS_PER_SECOND;
+}
+
+// Fills in the mixer segment that plays sound. Returns false if sound is not
+// a sound_sounds_t value.
+static bool sound_makeSegment(sound_sounds_t sound,
+                              soundMixer_segment_t *segment) {
+  if ((uint32_t)sound > sound_oneSecondSilence_e) {
+    printf("sound_setSound(): bogus sound value(%d)\n", sound);
+    return false;
+  }
+  if (sound == sound_oneSecondSilence_e) {
+    segment->kind = soundMixer_silence_e; // Generated, so it takes no memory.
+    segment->data = NULL;
+    segment->count = SOUND_SAMPLE_RATE; // 1 second's worth.
+  } else {
+    segment->kind = soundMixer_adpcm_e;
+    segment->data = &soundPack_data[soundPack_index[sound].offset];
+    segment->count = soundPack_index[sound].sampleCount;
+  }
+  segment->frequency = 0;
+  return true;
+}
+
 // Use this to set the base address for the array containing sound data.
-// Allow sounds to be interrupted.
+// Sounds that are already playing are mixed with it rather than interrupted.
 void sound_setSound(sound_sounds_t sound) {
-  if (sound_isBusy()) { // You are currently playing some sound.
-    sound_stopSound(); // Stop the sound and reset the state-machine, FIFO, etc.
-  }
-  sound_array =
-      NULL; // Set the pointer to NULL so you can detect it never being set.
-  switch (sound) {
-  case sound_gameStart_e:
-    sound_array = gameBoyStartup_wav; // Set the array holding the data.
-    sound_sampleCount =
-        GAMEBOYSTARTUP_WAV_NUMBER_OF_SAMPLES; // Size of the array.
-    break;
-  case sound_gunFire_e:
-    sound_array = bcfire01_48k_wav; // Set the array holding the data.
-    sound_sampleCount =
-        BCFIRE01_48K_WAV_NUMBER_OF_SAMPLES; // Size of the array.
-    break;
-  case sound_hit_e:
-    sound_array = ouch48k_wav; // You get the idea...
-    sound_sampleCount = OUCH48K_WAV_NUMBER_OF_SAMPLES;
-    break;
-  case sound_gunClick_e:
-    sound_array = gunEmpty48k_wav;
-    sound_sampleCount = GUNEMPTY48K_WAV_NUMBER_OF_SAMPLES;
-    break;
-  case sound_gunReload_e:
-    sound_array = powerUp48k_wav;
-    sound_sampleCount = POWERUP48K_WAV_NUMBER_OF_SAMPLES;
-    break;
-  case sound_loseLife_e:
-    sound_array = screamAndDie48k_wav;
-    sound_sampleCount = SCREAMANDDIE48K_WAV_NUMBER_OF_SAMPLES;
-    break;
-  case sound_gameOver_e:
-    sound_array = pacmanDeath_wav;
-    sound_sampleCount = PACMANDEATH_WAV_NUMBER_OF_SAMPLES;
-    break;
-  case sound_returnToBase_e:
-    sound_array = gameOver48k_wav;
-    sound_sampleCount = GAMEOVER48K_WAV_NUMBER_OF_SAMPLES;
-    break;
-  case sound_oneSecondSilence_e:
-    sound_array = soundOfSilence;
-    sound_sampleCount = ONE_SECOND_OF_SOUND_ARRAY_SIZE;
-    break;
-  default:
-    printf("sound_setSound(): bogus sound value(%d)\n", sound);
+  // Clear the count so you can detect the sound never being set.
+  sound_segment.count = 0;
+  if (sound_makeSegment(sound, &sound_segment))
+    sound_priority = sound_priorities[sound]; // Who wins a voice.
+}
+
+// Starts the sound set by sound_setSound() on a voice of its own.
+static soundMixer_handle_t sound_startVoice() {
+  if (sound_segment.count == 0) {
+    printf("ERROR, sound_startSound: sound array has not been set.\n");
+    return SOUND_MIXER_NO_VOICE;
   }
+  soundMixer_handle_t handle = soundMixer_startSegment(
+      &sound_segment, sound_currentVolume, sound_priority);
+  if (handle != SOUND_MIXER_NO_VOICE)
+    sound_playSoundFlag = true; // wake the state machine up if it is waiting
+  return handle;
 }
 
 // Tell the state machine to start playing the sound.
-void sound_startSound() { sound_playSoundFlag = true; }
+void sound_startSound() { sound_startVoice(); }
+
+// Starts playing sound on its own voice and returns its handle.
+soundMixer_handle_t sound_playVoice(sound_sounds_t sound) {
+  sound_setSound(sound);
+  return sound_startVoice();
+}
+
+// Stops one sound started by sound_playVoice().
+void sound_stopVoice(soundMixer_handle_t handle) { soundMixer_stop(handle); }
+
+// Returns true if the sound started by sound_playVoice() is still playing.
+bool sound_isVoicePlaying(soundMixer_handle_t handle) {
+  return soundMixer_isPlaying(handle);
+}
 
 // Returns true if the sound has been played. State machine will have returned
 // to its initial state.
@@ -278,6 +345,49 @@ void sound_playSound(sound_sounds_t sound) {
   sound_startSound();    // Start playing the sound.
 }
 
+// Plays 1 second of silence.
+void sound_playOneSecondSilence() { sound_playSound(sound_oneSecondSilence_e); }
+
+// Queues segment behind the last one queued, or starts a new queue if that
+// one has finished.
+static void sound_queueSegment(const soundMixer_segment_t *segment) {
+  if (soundMixer_queue(sound_queueHandle, segment))
+    return;
+  if (soundMixer_isPlaying(sound_queueHandle)) {
+    printf("ERROR, sound_queueSegment: the queue is full.\n");
+    return;
+  }
+  sound_queueHandle = soundMixer_startSegment(segment, sound_currentVolume,
+                                              SOUND_PRIORITY_QUEUE);
+  if (sound_queueHandle != SOUND_MIXER_NO_VOICE)
+    sound_playSoundFlag = true; // wake the state machine up if it is waiting
+}
+
+// Queues sound to play once everything queued before it has played.
+void sound_queueSound(sound_sounds_t sound) {
+  soundMixer_segment_t segment;
+  if (sound_makeSegment(sound, &segment))
+    sound_queueSegment(&segment);
+}
+
+// Queues milliseconds of silence.
+void sound_queueSilence(uint32_t milliseconds) {
+  soundMixer_segment_t segment = {soundMixer_silence_e, NULL,
+                                  sound_millisecondsToSamples(milliseconds), 0};
+  sound_queueSegment(&segment);
+}
+
+// Queues a square-wave tone of frequency Hz lasting milliseconds.
+void sound_queueTone(uint32_t frequency, uint32_t milliseconds) {
+  soundMixer_segment_t segment = {soundMixer_tone_e, NULL,
+                                  sound_millisecondsToSamples(milliseconds),
+                                  frequency};
+  sound_queueSegment(&segment);
+}
+
+#define SOUND_TEST_TONE_FREQUENCY 1000 // Hz.
+#define SOUND_TEST_TONE_MILLISECONDS 200
+
 // Plays several sounds.
 // To invoke, just place this in your main.
 // Completely stand alone, doesn't require interrupts, etc.
@@ -326,6 +436,27 @@ void sound_runTest() {
     if (!sound_isBusy())
       break;
   }
+  // The ouch should play out over the gunshots.
+  printf("playing hit_e with gunFire_e on top\n");
+  sound_playVoice(sound_hit_e);
+  for (uint32_t i = 0; i < SOUND_MIXER_VOICE_COUNT - 1; i++)
+    sound_playVoice(sound_gunFire_e);
+  while (1) {
+    sound_tick();
+    if (!sound_isBusy())
+      break;
+  }
+  // Queued all at once, these play one after another.
+  printf("playing gunFire_e, 1 second of silence, a beep and gunReload_e\n");
+  sound_queueSound(sound_gunFire_e);
+  sound_queueSound(sound_oneSecondSilence_e);
+  sound_queueTone(SOUND_TEST_TONE_FREQUENCY, SOUND_TEST_TONE_MILLISECONDS);
+  sound_queueSound(sound_gunReload_e);
+  while (1) {
+    sound_tick();
+    if (!sound_isBusy())
+      break;
+  }
   printf("done.\n");
 }
 
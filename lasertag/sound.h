@@ -10,6 +10,7 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #ifndef SOUND_H_
 #define SOUND_H_
 
+#include "soundMixer.h"
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -68,31 +69,63 @@ void sound_tick();
 // Returns true if the sound state machine is not back in its initial state.
 bool sound_isBusy();
 
-// Use this to set the base address for the array containing sound data.
+// Use this to set the base address for the array containing sound data, its
+// entry in the sound pack (see sounds/sounds.txt). Sounds that are already
+// playing keep playing.
 void sound_setSound(sound_sounds_t sound);
 
 // Set the sample rate. Should only do this when no sound is currently playing.
 sound_status_t sound_setSampleRate(uint32_t sampleRate);
 
-// Used to set the volume. Use one of the provided values.
+// Used to set the volume. Use one of the provided values. Applies to sounds
+// started afterwards.
 void sound_setVolume(sound_volume_t);
 
-// Tell the state machine to start playing the sound.
+// Tell the state machine to start playing the sound. It is mixed with any
+// sounds that are already playing (see soundMixer.h).
 void sound_startSound();
 
-// Tell the state machine to stop playing the sound.
+// Tell the state machine to stop playing all sounds.
 void sound_stopSound();
 
+// Starts playing sound on its own voice, mixed with whatever else is playing,
+// and returns its handle. Each sound has a fixed priority: if every voice is
+// busy, a voice playing a sound of lower (or the same) priority is taken over.
+// Returns SOUND_MIXER_NO_VOICE if the sound could not be started.
+soundMixer_handle_t sound_playVoice(sound_sounds_t sound);
+
+// Stops one sound started by sound_playVoice().
+void sound_stopVoice(soundMixer_handle_t handle);
+
+// Returns true if the sound started by sound_playVoice() is still playing.
+bool sound_isVoicePlaying(soundMixer_handle_t handle);
+
 // Returns true if the sound has been played. State machine will have returned
 // to its initial state.
 bool sound_isSoundComplete();
 
-// Sets the sound and starts playing it immediately.
+// Sets the sound and starts playing it immediately, mixed with any sounds that
+// are already playing.
 void sound_playSound(sound_sounds_t sound);
 
-// Plays 1 second of silence.
+// Plays 1 second of silence. The mixer generates it as it plays, so it takes
+// no memory.
 void sound_playOneSecondSilence();
 
+// Queues sound to play once everything queued before it has played, on one
+// voice and without a gap, so a sequence such as a gunshot, a second of
+// silence and a reload plays without the main loop waiting on it. Starts a
+// new queue if the last one has finished. Up to SOUND_MIXER_QUEUE_LENGTH
+// sounds can wait behind the one playing. Queues play at the priority of the
+// game sounds, so effects and hits don't cut them off.
+void sound_queueSound(sound_sounds_t sound);
+
+// Queues milliseconds of silence.
+void sound_queueSilence(uint32_t milliseconds);
+
+// Queues a square-wave tone of frequency Hz lasting milliseconds.
+void sound_queueTone(uint32_t frequency, uint32_t milliseconds);
+
 // Used to test sounds.
 void sound_runTest();
 
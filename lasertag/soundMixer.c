@@ -0,0 +1,443 @@
+#include "soundMixer.h"
+#include "adpcm.h"
+#include <stdio.h>
+
+#define INIT_VAL 0
+#define VOLUME_SHIFT 15 // volumes are Q15
+#define RENDER_BLOCK_SIZE 64 // samples mixed at once by soundMixer_render()
+// A handle is the voice index in the low bits and the voice's generation above
+// them, so a stale handle can't stop whatever plays on the voice next.
+#define HANDLE_INDEX_BITS 8
+#define HANDLE_INDEX_MASK ((1 << HANDLE_INDEX_BITS) - 1)
+#define QUEUE_INDEX_MASK (SOUND_MIXER_QUEUE_LENGTH - 1)
+#define TONE_AMPLITUDE (INT16_MAX / 2) // Square-wave peak before volume.
+#define TONE_PHASE_HALF 0x80000000 // A tone's phase wraps once per period.
+
+_Static_assert((SOUND_MIXER_QUEUE_LENGTH & QUEUE_INDEX_MASK) == INIT_VAL,
+               "SOUND_MIXER_QUEUE_LENGTH must be a power of 2");
+
+typedef struct {
+  bool playing;                 // False if the voice is free.
+  soundMixer_segment_t segment; // What the voice plays now.
+  uint32_t index;               // Next sample of segment to play.
+  adpcm_decoder_t decoder;      // Where an ADPCM segment is in its data.
+  uint32_t phase;               // Where a tone is in its period.
+  uint32_t phaseStep;           // How far a tone's phase moves per sample.
+  // Segments to play after this one. Only soundMixer_queue() moves queueTail
+  // and only the renderer moves queueHead; both only count up.
+  soundMixer_segment_t queue[SOUND_MIXER_QUEUE_LENGTH];
+  uint32_t queueHead; // Next queued segment to play.
+  uint32_t queueTail; // Where the next queued segment goes.
+  int16_t volume;
+  uint8_t priority;
+  uint32_t generation; // Counts starts on this voice, from 1.
+  uint32_t startOrder; // When it started, to steal the oldest voice first.
+} soundMixer_voice_t;
+
+// sound_tick() renders from an interrupt while the main loop starts and stops
+// sounds, so a voice is published by setting playing last.
+volatile static soundMixer_voice_t voices[SOUND_MIXER_VOICE_COUNT];
+static uint32_t startCount;
+
+// Must call this prior to using any soundMixer functions. Stops every voice.
+void soundMixer_init() {
+  for (uint32_t i = INIT_VAL; i < SOUND_MIXER_VOICE_COUNT; i++) {
+    voices[i].playing = false;
+    voices[i].generation = INIT_VAL;
+  }
+  startCount = INIT_VAL;
+}
+
+// Returns the voice playing handle, or NULL if it is no longer playing.
+static volatile soundMixer_voice_t *findVoice(soundMixer_handle_t handle) {
+  uint32_t index = handle & HANDLE_INDEX_MASK;
+  if (index >= SOUND_MIXER_VOICE_COUNT)
+    return NULL;
+  volatile soundMixer_voice_t *v = &voices[index];
+  if (!v->playing || v->generation != handle >> HANDLE_INDEX_BITS)
+    return NULL;
+  return v;
+}
+
+// Returns the index of a free voice, else of the voice to take over for a
+// sound at priority, else -1.
+static int32_t chooseVoice(uint8_t priority) {
+  int32_t chosen = -1;
+  for (uint32_t i = INIT_VAL; i < SOUND_MIXER_VOICE_COUNT; i++) {
+    volatile soundMixer_voice_t *v = &voices[i];
+    if (!v->playing)
+      return i;
+    if (v->priority > priority)
+      continue;
+    volatile soundMixer_voice_t *c =
+        chosen < INIT_VAL ? NULL : &voices[chosen];
+    if (c == NULL || v->priority < c->priority ||
+        (v->priority == c->priority &&
+         startCount - v->startOrder > startCount - c->startOrder))
+      chosen = i;
+  }
+  return chosen;
+}
+
+// Returns true if segment has what it needs to play.
+static bool isPlayable(const soundMixer_segment_t *segment) {
+  switch (segment->kind) {
+  case soundMixer_pcm_e:
+  case soundMixer_adpcm_e:
+    return segment->data != NULL;
+  case soundMixer_silence_e:
+    return true;
+  case soundMixer_tone_e: // 0 Hz would be DC, above Nyquist would alias
+    return segment->frequency > INIT_VAL &&
+           segment->frequency <= SOUND_MIXER_SAMPLE_RATE / 2;
+  default:
+    return false;
+  }
+}
+
+// Makes the voice play segment from its first sample.
+static void beginSegment(volatile soundMixer_voice_t *v,
+                         const soundMixer_segment_t *segment) {
+  v->segment = *segment;
+  v->index = INIT_VAL;
+  if (segment->kind == soundMixer_adpcm_e) {
+    adpcm_decoder_t decoder;
+    adpcm_initDecoder(&decoder, segment->data);
+    v->decoder = decoder;
+  } else if (segment->kind == soundMixer_tone_e) {
+    v->phase = INIT_VAL;
+    v->phaseStep = ((uint64_t)segment->frequency << 32) /
+                   SOUND_MIXER_SAMPLE_RATE; // 2^32 is a whole period
+  }
+}
+
+// Starts playing segment on a voice and returns its handle.
+soundMixer_handle_t soundMixer_startSegment(const soundMixer_segment_t *segment,
+                                            int16_t volume, uint8_t priority) {
+  if (!isPlayable(segment) || segment->count == INIT_VAL)
+    return SOUND_MIXER_NO_VOICE;
+  int32_t index = chooseVoice(priority);
+  if (index < INIT_VAL)
+    return SOUND_MIXER_NO_VOICE;
+  volatile soundMixer_voice_t *v = &voices[index];
+  v->playing = false; // stop a voice being taken over before changing it
+  beginSegment(v, segment);
+  v->queueHead = v->queueTail = INIT_VAL;
+  v->volume = volume;
+  v->priority = priority;
+  v->startOrder = startCount++;
+  // keep generation inside the handle and never 0, so no handle is 0
+  if (++v->generation >= (UINT32_MAX >> HANDLE_INDEX_BITS))
+    v->generation = INIT_VAL + 1;
+  v->playing = true; // publish only after the rest is written
+  return (v->generation << HANDLE_INDEX_BITS) | index;
+}
+
+// Starts playing samples[] on a voice and returns its handle.
+soundMixer_handle_t soundMixer_start(const uint16_t samples[], uint32_t count,
+                                     int16_t volume, uint8_t priority) {
+  soundMixer_segment_t segment = {soundMixer_pcm_e, samples, count, INIT_VAL};
+  return soundMixer_startSegment(&segment, volume, priority);
+}
+
+// Starts playing count samples of IMA-ADPCM data[] on a voice.
+soundMixer_handle_t soundMixer_startAdpcm(const uint8_t data[], uint32_t count,
+                                          int16_t volume, uint8_t priority) {
+  soundMixer_segment_t segment = {soundMixer_adpcm_e, data, count, INIT_VAL};
+  return soundMixer_startSegment(&segment, volume, priority);
+}
+
+// Queues segment to play on the voice of handle after what is already there.
+bool soundMixer_queue(soundMixer_handle_t handle,
+                      const soundMixer_segment_t *segment) {
+  volatile soundMixer_voice_t *v = findVoice(handle);
+  if (v == NULL || !isPlayable(segment) ||
+      v->queueTail - v->queueHead >= SOUND_MIXER_QUEUE_LENGTH)
+    return false;
+  v->queue[v->queueTail & QUEUE_INDEX_MASK] = *segment;
+  v->queueTail++; // publish only after the segment is written
+  // The renderer may have finished the voice before it saw the segment.
+  return findVoice(handle) != NULL;
+}
+
+// Stops the sound. Does nothing if handle is no longer playing.
+void soundMixer_stop(soundMixer_handle_t handle) {
+  volatile soundMixer_voice_t *v = findVoice(handle);
+  if (v)
+    v->playing = false;
+}
+
+// Stops every sound.
+void soundMixer_stopAll() {
+  for (uint32_t i = INIT_VAL; i < SOUND_MIXER_VOICE_COUNT; i++) {
+    voices[i].playing = false;
+  }
+}
+
+// Returns true if the sound is still playing.
+bool soundMixer_isPlaying(soundMixer_handle_t handle) {
+  return findVoice(handle) != NULL;
+}
+
+// Changes the volume of a sound that is playing.
+void soundMixer_setVolume(soundMixer_handle_t handle, int16_t volume) {
+  volatile soundMixer_voice_t *v = findVoice(handle);
+  if (v)
+    v->volume = volume;
+}
+
+// Returns the number of voices that are playing.
+uint32_t soundMixer_activeVoiceCount() {
+  uint32_t activeCount = INIT_VAL;
+  for (uint32_t i = INIT_VAL; i < SOUND_MIXER_VOICE_COUNT; i++) {
+    if (voices[i].playing)
+      activeCount++;
+  }
+  return activeCount;
+}
+
+// Adds the next count samples of the voice's segment into mix[].
+static void renderSegment(volatile soundMixer_voice_t *v, int32_t mix[],
+                          uint32_t count) {
+  int32_t volume = v->volume;
+  switch (v->segment.kind) {
+  case soundMixer_pcm_e: {
+    const uint16_t *s = (const uint16_t *)v->segment.data + v->index;
+    for (uint32_t j = INIT_VAL; j < count; j++) {
+      int32_t sample = (int32_t)s[j] - SOUND_MIXER_SAMPLE_MIDSCALE;
+      mix[j] += (sample * volume) >> VOLUME_SHIFT;
+    }
+    break;
+  }
+  case soundMixer_adpcm_e: {
+    int16_t decoded[RENDER_BLOCK_SIZE];
+    adpcm_decoder_t decoder = v->decoder;
+    adpcm_decode(&decoder, decoded, count);
+    v->decoder = decoder;
+    for (uint32_t j = INIT_VAL; j < count; j++) {
+      mix[j] += (decoded[j] * volume) >> VOLUME_SHIFT;
+    }
+    break;
+  }
+  case soundMixer_tone_e: {
+    int32_t high = (TONE_AMPLITUDE * volume) >> VOLUME_SHIFT;
+    uint32_t phase = v->phase;
+    uint32_t phaseStep = v->phaseStep;
+    for (uint32_t j = INIT_VAL; j < count; j++) {
+      mix[j] += phase < TONE_PHASE_HALF ? high : -high;
+      phase += phaseStep;
+    }
+    v->phase = phase;
+    break;
+  }
+  default: // silence adds nothing
+    break;
+  }
+}
+
+// Moves the voice on to its next queued segment. Returns false if there is
+// none.
+static bool nextSegment(volatile soundMixer_voice_t *v) {
+  if (v->queueHead == v->queueTail)
+    return false;
+  soundMixer_segment_t segment = v->queue[v->queueHead & QUEUE_INDEX_MASK];
+  beginSegment(v, &segment);
+  v->queueHead++; // only now can soundMixer_queue() reuse the slot
+  return true;
+}
+
+// Mixes up to RENDER_BLOCK_SIZE samples, voice by voice, into out[].
+static void renderBlock(int16_t out[], uint32_t count) {
+  int32_t mix[RENDER_BLOCK_SIZE] = {INIT_VAL};
+  for (uint32_t i = INIT_VAL; i < SOUND_MIXER_VOICE_COUNT; i++) {
+    volatile soundMixer_voice_t *v = &voices[i];
+    // a voice runs from one segment into the next within the block
+    for (uint32_t done = INIT_VAL; done < count && v->playing;) {
+      uint32_t remaining = v->segment.count - v->index;
+      uint32_t n = remaining < count - done ? remaining : count - done;
+      renderSegment(v, mix + done, n);
+      v->index += n;
+      done += n;
+      if (v->index >= v->segment.count && !nextSegment(v))
+        v->playing = false; // done, free the voice
+    }
+  }
+  for (uint32_t j = INIT_VAL; j < count; j++) {
+    int32_t m = mix[j];
+    out[j] = m > INT16_MAX ? INT16_MAX : m < INT16_MIN ? INT16_MIN : m;
+  }
+}
+
+// Mixes the next count samples of every playing sound into out[].
+void soundMixer_render(int16_t out[], uint32_t count) {
+  while (count > INIT_VAL) {
+    uint32_t n = count < RENDER_BLOCK_SIZE ? count : RENDER_BLOCK_SIZE;
+    renderBlock(out, n);
+    out += n;
+    count -= n;
+  }
+}
+
+/*******************************************************
+ ****************** Test Routines **********************
+ ******************************************************/
+
+#define TEST_SAMPLE_COUNT 100
+#define TEST_RENDER_COUNT 150 // past the end of the test sounds
+#define TEST_LOUD_OFFSET 30000
+#define TEST_QUIET_OFFSET 1000
+#define TEST_HALF_VOLUME (INT16_MAX / 2)
+#define TEST_LOW_PRIORITY 1
+#define TEST_HIGH_PRIORITY 2
+#define TEST_SEGMENT_COUNT 40 // samples in each queued segment
+#define TEST_TONE_PERIOD 8    // samples, so the tone's phase steps are exact
+#define TEST_TONE_FREQUENCY (SOUND_MIXER_SAMPLE_RATE / TEST_TONE_PERIOD)
+
+static uint16_t testLoud[TEST_SAMPLE_COUNT];
+static uint16_t testQuiet[TEST_SAMPLE_COUNT];
+static uint16_t testNegative[TEST_SAMPLE_COUNT];
+static int16_t testSigned[TEST_SAMPLE_COUNT];
+static int16_t testDecoded[TEST_SAMPLE_COUNT];
+static uint8_t testAdpcm[ADPCM_ENCODED_SIZE(TEST_SAMPLE_COUNT)];
+
+// Returns what one voice adds for sample at volume.
+static int32_t testContribution(uint16_t sample, int16_t volume) {
+  return ((int32_t)(sample - SOUND_MIXER_SAMPLE_MIDSCALE) * volume) >>
+         VOLUME_SHIFT;
+}
+
+// Returns what a tone voice adds at volume, sample samples into the tone.
+static int32_t testTone(uint32_t sample, int16_t volume) {
+  int32_t high = (TONE_AMPLITUDE * volume) >> VOLUME_SHIFT;
+  return sample % TEST_TONE_PERIOD < TEST_TONE_PERIOD / 2 ? high : -high;
+}
+
+// Checks mixing, saturation, handles, voice stealing, ADPCM voices and queued
+// segments.
+bool soundMixer_runTest(bool printMessageFlag) {
+  bool success = true;
+  int16_t out[TEST_RENDER_COUNT];
+  for (uint32_t i = INIT_VAL; i < TEST_SAMPLE_COUNT; i++) {
+    testLoud[i] = SOUND_MIXER_SAMPLE_MIDSCALE + TEST_LOUD_OFFSET;
+    testQuiet[i] = SOUND_MIXER_SAMPLE_MIDSCALE + TEST_QUIET_OFFSET + i;
+    testNegative[i] = SOUND_MIXER_SAMPLE_MIDSCALE - TEST_LOUD_OFFSET;
+  }
+  soundMixer_init();
+  // two voices add, then fall silent once both are done
+  soundMixer_handle_t a = soundMixer_start(testQuiet, TEST_SAMPLE_COUNT,
+                                           INT16_MAX, TEST_LOW_PRIORITY);
+  soundMixer_handle_t b = soundMixer_start(
+      testQuiet, TEST_SAMPLE_COUNT / 2, TEST_HALF_VOLUME, TEST_LOW_PRIORITY);
+  soundMixer_render(out, TEST_RENDER_COUNT);
+  for (uint32_t i = INIT_VAL; i < TEST_RENDER_COUNT; i++) {
+    int32_t expected = INIT_VAL;
+    if (i < TEST_SAMPLE_COUNT)
+      expected += testContribution(testQuiet[i], INT16_MAX);
+    if (i < TEST_SAMPLE_COUNT / 2)
+      expected += testContribution(testQuiet[i], TEST_HALF_VOLUME);
+    if (out[i] != expected)
+      success = false;
+  }
+  if (soundMixer_isPlaying(a) || soundMixer_isPlaying(b) ||
+      soundMixer_activeVoiceCount() != INIT_VAL)
+    success = false;
+  // loud voices saturate in both directions rather than wrap
+  for (uint32_t i = INIT_VAL; i < SOUND_MIXER_VOICE_COUNT; i++) {
+    soundMixer_start(testLoud, TEST_SAMPLE_COUNT / 2, INT16_MAX,
+                     TEST_LOW_PRIORITY);
+  }
+  soundMixer_render(out, TEST_SAMPLE_COUNT / 2);
+  if (out[INIT_VAL] != INT16_MAX)
+    success = false;
+  for (uint32_t i = INIT_VAL; i < SOUND_MIXER_VOICE_COUNT; i++) {
+    soundMixer_start(testNegative, TEST_SAMPLE_COUNT / 2, INT16_MAX,
+                     TEST_LOW_PRIORITY);
+  }
+  soundMixer_render(out, TEST_SAMPLE_COUNT / 2);
+  if (out[INIT_VAL] != INT16_MIN)
+    success = false;
+  // a full pool refuses a lower priority, steals for an equal or higher one
+  soundMixer_handle_t handles[SOUND_MIXER_VOICE_COUNT];
+  for (uint32_t i = INIT_VAL; i < SOUND_MIXER_VOICE_COUNT; i++) {
+    handles[i] = soundMixer_start(testQuiet, TEST_SAMPLE_COUNT, INT16_MAX,
+                                  TEST_LOW_PRIORITY);
+  }
+  if (soundMixer_start(testQuiet, TEST_SAMPLE_COUNT, INT16_MAX,
+                       TEST_LOW_PRIORITY - 1) != SOUND_MIXER_NO_VOICE)
+    success = false;
+  soundMixer_handle_t high = soundMixer_start(
+      testLoud, TEST_SAMPLE_COUNT, INT16_MAX, TEST_HIGH_PRIORITY);
+  if (high == SOUND_MIXER_NO_VOICE || soundMixer_isPlaying(handles[INIT_VAL]) ||
+      !soundMixer_isPlaying(handles[INIT_VAL + 1]))
+    success = false; // the oldest voice should have been taken over
+  // a stale handle doesn't stop the sound now on its voice
+  soundMixer_stop(handles[INIT_VAL]);
+  if (!soundMixer_isPlaying(high))
+    success = false;
+  soundMixer_stop(high);
+  if (soundMixer_isPlaying(high) ||
+      soundMixer_activeVoiceCount() != SOUND_MIXER_VOICE_COUNT - 1)
+    success = false;
+  soundMixer_stopAll();
+  if (soundMixer_activeVoiceCount() != INIT_VAL)
+    success = false;
+  // an ADPCM voice mixes what adpcm_decode() gives
+  for (uint32_t i = INIT_VAL; i < TEST_SAMPLE_COUNT; i++) {
+    testSigned[i] = testQuiet[i] - SOUND_MIXER_SAMPLE_MIDSCALE;
+  }
+  adpcm_encode(testSigned, TEST_SAMPLE_COUNT, testAdpcm);
+  adpcm_decoder_t decoder;
+  adpcm_initDecoder(&decoder, testAdpcm);
+  adpcm_decode(&decoder, testDecoded, TEST_SAMPLE_COUNT);
+  soundMixer_startAdpcm(testAdpcm, TEST_SAMPLE_COUNT, TEST_HALF_VOLUME,
+                        TEST_LOW_PRIORITY);
+  soundMixer_render(out, TEST_RENDER_COUNT);
+  for (uint32_t i = INIT_VAL; i < TEST_RENDER_COUNT; i++) {
+    int32_t expected = i < TEST_SAMPLE_COUNT
+                           ? (testDecoded[i] * TEST_HALF_VOLUME) >> VOLUME_SHIFT
+                           : INIT_VAL;
+    if (out[i] != expected)
+      success = false;
+  }
+  if (soundMixer_activeVoiceCount() != INIT_VAL)
+    success = false;
+  // queued segments follow each other without a gap: samples, silence, tone
+  soundMixer_segment_t silence = {soundMixer_silence_e, NULL,
+                                  TEST_SEGMENT_COUNT, INIT_VAL};
+  soundMixer_segment_t tone = {soundMixer_tone_e, NULL, TEST_SEGMENT_COUNT,
+                               TEST_TONE_FREQUENCY};
+  soundMixer_handle_t sequence = soundMixer_start(
+      testQuiet, TEST_SEGMENT_COUNT, INT16_MAX, TEST_LOW_PRIORITY);
+  if (!soundMixer_queue(sequence, &silence) ||
+      !soundMixer_queue(sequence, &tone))
+    success = false;
+  soundMixer_render(out, TEST_SEGMENT_COUNT * 2); // through the silence
+  if (!soundMixer_isPlaying(sequence))
+    success = false;
+  soundMixer_render(out + TEST_SEGMENT_COUNT * 2,
+                    TEST_RENDER_COUNT - TEST_SEGMENT_COUNT * 2);
+  for (uint32_t i = INIT_VAL; i < TEST_RENDER_COUNT; i++) {
+    int32_t expected = INIT_VAL;
+    if (i < TEST_SEGMENT_COUNT)
+      expected = testContribution(testQuiet[i], INT16_MAX);
+    else if (i >= TEST_SEGMENT_COUNT * 2 && i < TEST_SEGMENT_COUNT * 3)
+      expected = testTone(i - TEST_SEGMENT_COUNT * 2, INT16_MAX);
+    if (out[i] != expected)
+      success = false;
+  }
+  if (soundMixer_isPlaying(sequence) || soundMixer_queue(sequence, &silence))
+    success = false; // nothing can be queued on a finished sound
+  // a voice holds SOUND_MIXER_QUEUE_LENGTH waiting segments, no more
+  sequence = soundMixer_startSegment(&silence, INT16_MAX, TEST_LOW_PRIORITY);
+  for (uint32_t i = INIT_VAL; i < SOUND_MIXER_QUEUE_LENGTH; i++) {
+    if (!soundMixer_queue(sequence, &tone))
+      success = false;
+  }
+  if (soundMixer_queue(sequence, &tone))
+    success = false;
+  soundMixer_stopAll();
+  if (printMessageFlag)
+    printf("%u voices\n", SOUND_MIXER_VOICE_COUNT);
+  printf("Sound mixer test %s\n", success ? "passed" : "failed");
+  return success;
+}
@@ -0,0 +1,106 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef SOUNDMIXER_H_
+#define SOUNDMIXER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Software mixer for sound.c: a fixed pool of voices, each playing one sound
+// array at its own volume and priority. soundMixer_render() adds the voices
+// together into signed 16-bit samples, saturating instead of wrapping, so
+// sounds can overlap (a gunshot no longer cuts off the "ouch").
+// Sound arrays hold 16-bit offset-binary samples as written by wav2c:
+// SOUND_MIXER_SAMPLE_MIDSCALE is silence. Voices can also play IMA-ADPCM
+// arrays (see adpcm.h), which are decoded as they are mixed, and silences and
+// tones, which are generated as they are mixed and take no memory.
+// Each voice plays a segment, then any segments queued on it after that one,
+// in order and without a gap: a gunshot, a second of silence, a reload.
+
+#define SOUND_MIXER_VOICE_COUNT 4 // Sounds that can play at once.
+#define SOUND_MIXER_QUEUE_LENGTH 8 // Segments that can wait on one voice.
+#define SOUND_MIXER_SAMPLE_MIDSCALE 0x8000 // Offset-binary zero.
+#define SOUND_MIXER_SAMPLE_RATE 48000 // Samples per second, for tones.
+
+// What a segment plays.
+typedef enum {
+  soundMixer_pcm_e,     // 16-bit offset-binary samples from data.
+  soundMixer_adpcm_e,   // IMA-ADPCM blocks from data.
+  soundMixer_silence_e, // Nothing, for count samples.
+  soundMixer_tone_e     // A square wave of frequency Hz.
+} soundMixer_kind_t;
+
+// Part of what a voice plays. data must stay valid while it plays.
+typedef struct {
+  soundMixer_kind_t kind;
+  const void *data;   // Samples, for soundMixer_pcm_e and soundMixer_adpcm_e.
+  uint32_t count;     // Samples the segment lasts.
+  uint32_t frequency; // Hz, for soundMixer_tone_e.
+} soundMixer_segment_t;
+
+// Identifies one started sound. A handle stays invalid once its sound has
+// finished or been stopped, even after the voice is reused.
+typedef uint32_t soundMixer_handle_t;
+#define SOUND_MIXER_NO_VOICE 0 // Never a valid handle.
+
+// Must call this prior to using any soundMixer functions. Stops every voice.
+void soundMixer_init();
+
+// Starts playing count samples from samples[] at volume (Q15, INT16_MAX is
+// full scale) and returns its handle. If every voice is busy, the voice with
+// the lowest priority is taken over (the oldest of those if there is a tie),
+// but only if its priority is not higher than priority. Returns
+// SOUND_MIXER_NO_VOICE if no voice was free. samples[] must stay valid while
+// the sound plays.
+soundMixer_handle_t soundMixer_start(const uint16_t samples[], uint32_t count,
+                                     int16_t volume, uint8_t priority);
+
+// Same as soundMixer_start(), but plays count samples from IMA-ADPCM blocks
+// (see adpcm.h), decoding them as they are mixed.
+soundMixer_handle_t soundMixer_startAdpcm(const uint8_t data[], uint32_t count,
+                                          int16_t volume, uint8_t priority);
+
+// Same as soundMixer_start(), but plays any kind of segment. The segment is
+// copied, so it need not stay valid.
+soundMixer_handle_t soundMixer_startSegment(const soundMixer_segment_t *segment,
+                                            int16_t volume, uint8_t priority);
+
+// Queues segment to play on the voice of handle once everything started or
+// queued on it before has played. The segment is copied. Returns false if
+// handle is no longer playing or SOUND_MIXER_QUEUE_LENGTH segments are
+// already waiting; segment will not play then.
+bool soundMixer_queue(soundMixer_handle_t handle,
+                      const soundMixer_segment_t *segment);
+
+// Stops the sound. Does nothing if handle is no longer playing.
+void soundMixer_stop(soundMixer_handle_t handle);
+
+// Stops every sound.
+void soundMixer_stopAll();
+
+// Returns true if the sound, or anything queued after it, is still playing.
+bool soundMixer_isPlaying(soundMixer_handle_t handle);
+
+// Changes the volume of a sound that is playing.
+void soundMixer_setVolume(soundMixer_handle_t handle, int16_t volume);
+
+// Returns the number of voices that are playing.
+uint32_t soundMixer_activeVoiceCount();
+
+// Mixes the next count samples of every playing sound into out[]. Voices
+// that run out are freed; out[] is silence (0) once none are playing.
+void soundMixer_render(int16_t out[], uint32_t count);
+
+// Checks mixing, saturation, handles, voice stealing, ADPCM voices and queued
+// segments. Returns true if the test passes. Prints informational messages if
+// printMessageFlag is true.
+bool soundMixer_runTest(bool printMessageFlag);
+
+#endif /* SOUNDMIXER_H_ */
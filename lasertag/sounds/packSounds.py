@@ -0,0 +1,190 @@
+#!/usr/bin/python3
+
+"""Packs the sounds listed in a manifest into one IMA-ADPCM blob with an index
+table, soundPack.c and soundPack.h, for sound_setSound().
+
+Each manifest line is the name of a sound and its source file: a .wav, or a
+.wav.c written by wav2c, whose rate is read from the .wav.h next to it. A
+rate after the file name overrides the source's own. Every sound is
+brought to one sample rate, the one sound.c plays at, trimmed of the silence
+before and after it, and encoded like wav2adpcm.py does. Sounds that come out
+identical are stored once and share an index entry's data. Each sound starts
+on a block boundary, so its data can be handed straight to
+soundMixer_startAdpcm().
+"""
+
+import argparse
+import math
+import pathlib
+import re
+import sys
+
+import wav2adpcm
+
+BYTES_PER_LINE = 16
+
+# Samples no further than this from zero (about -54 dBFS) count as silence
+# when trimming the ends of a sound.
+DEFAULT_SILENCE_THRESHOLD = 64
+
+# Zero crossings of the windowed-sinc kernel on each side of a resampled
+# sample, at the lower of the two rates.
+RESAMPLE_HALF_WIDTH = 16
+
+
+def read_manifest(path):
+    """Returns the (name, source path, rate or None) entries of a manifest."""
+    entries = []
+    for number, line in enumerate(path.read_text().splitlines(), 1):
+        fields = line.split("#", 1)[0].split()
+        if not fields:
+            continue
+        if len(fields) not in (2, 3) or (len(fields) == 3 and not fields[2].isdigit()):
+            sys.exit("{}:{}: expected: name file [rate]".format(path, number))
+        rate = int(fields[2]) if len(fields) == 3 else None
+        entries.append((fields[0], path.parent / fields[1], rate))
+    names = [name for name, _, _ in entries]
+    if len(set(names)) != len(names):
+        sys.exit("{}: sound names must be unique".format(path))
+    return entries
+
+
+def read_source(path, rate):
+    """Returns the signed 16-bit samples of a source file and their rate."""
+    if not path.name.endswith(".wav.c"):
+        samples, own_rate = wav2adpcm.read_wav(path)
+        return samples, rate or own_rate
+    if rate is None:
+        header = path.with_suffix(".h")
+        found = re.search(r"_SAMPLE_RATE\s+(\d+)", header.read_text()) if header.exists() else None
+        if not found:
+            sys.exit("{}: no sample rate in {}".format(path, header.name))
+        rate = int(found.group(1))
+    return wav2adpcm.read_wav2c(path), rate
+
+
+def resample(samples, from_rate, to_rate):
+    """Resamples with a Hann-windowed sinc, low-passed below both Nyquist rates."""
+    if from_rate == to_rate:
+        return list(samples)
+    step = from_rate / to_rate  # Source samples per output sample.
+    cutoff = min(1.0, 1.0 / step)  # Relative to the source Nyquist rate.
+    half_width = RESAMPLE_HALF_WIDTH / cutoff  # In source samples.
+    out = []
+    for j in range(int(len(samples) / step)):
+        t = j * step
+        acc = 0.0
+        first = max(0, math.floor(t - half_width) + 1)
+        for k in range(first, min(len(samples), math.ceil(t + half_width))):
+            x = t - k
+            window = 0.5 + 0.5 * math.cos(math.pi * x / half_width)
+            acc += samples[k] * cutoff * sinc(x * cutoff) * window
+        out.append(max(-32768, min(32767, round(acc))))
+    return out
+
+
+def sinc(x):
+    return 1.0 if x == 0 else math.sin(math.pi * x) / (math.pi * x)
+
+
+def trim(samples, threshold):
+    """Drops the samples within threshold of zero at both ends."""
+    loud = [i for i, s in enumerate(samples) if abs(s) > threshold]
+    return samples[loud[0] : loud[-1] + 1] if loud else []
+
+
+def macro_name(name):
+    """gameStart -> SOUND_PACK_GAME_START."""
+    return "SOUND_PACK_" + re.sub(r"(?<=[a-z0-9])(?=[A-Z])", "_", name).upper()
+
+
+def write_pack(out_dir, data, index, rate, statement):
+    """Writes soundPack.c and soundPack.h; index holds (name, offset, count, note)."""
+    comment = "// This file was generated by executing this statement: {}\n".format(statement)
+    defines = [
+        "#define {} {}\n".format(macro_name(entry[0]), i) for i, entry in enumerate(index)
+    ]
+    lines = [
+        ",".join("0x{:02x}".format(b) for b in data[i : i + BYTES_PER_LINE])
+        for i in range(0, len(data), BYTES_PER_LINE)
+    ]
+    entries = [
+        "    {{{}, {}}}, // {}: {}".format(offset, count, name, note)
+        for name, offset, count, note in index
+    ]
+    (out_dir / "soundPack.c").write_text(
+        comment
+        + '\n#include "soundPack.h"\n\n'
+        + "const uint8_t soundPack_data[SOUND_PACK_SIZE] = {\n"
+        + ",\n".join(lines)
+        + "\n};\n\n"
+        + "const soundPack_entry_t soundPack_index[SOUND_PACK_COUNT] = {\n"
+        + "\n".join(entries)
+        + "\n};\n"
+    )
+    (out_dir / "soundPack.h").write_text(
+        comment
+        + "#ifndef SOUNDPACK_H_\n#define SOUNDPACK_H_\n\n"
+        + "#include <stdint.h>\n\n"
+        + "#define SOUND_PACK_SAMPLE_RATE {}\n".format(rate)
+        + "#define SOUND_PACK_COUNT {}\n".format(len(index))
+        + "#define SOUND_PACK_SIZE {}\n\n".format(len(data))
+        + "// Where each sound is in soundPack_index[].\n"
+        + "".join(defines)
+        + "\n// Where a sound's IMA-ADPCM blocks (see adpcm.h) start in soundPack_data[]\n"
+        + "// and how many samples they hold.\n"
+        + "typedef struct {\n  uint32_t offset;\n  uint32_t sampleCount;\n} soundPack_entry_t;\n\n"
+        + "extern const uint8_t soundPack_data[SOUND_PACK_SIZE];\n"
+        + "extern const soundPack_entry_t soundPack_index[SOUND_PACK_COUNT];\n\n"
+        + "#endif /* SOUNDPACK_H_ */\n"
+    )
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("manifest", type=pathlib.Path, help="sounds.txt")
+    parser.add_argument(
+        "--rate",
+        type=int,
+        default=wav2adpcm.DEFAULT_SAMPLE_RATE,
+        help="sample rate of the pack (default %(default)s)",
+    )
+    parser.add_argument(
+        "--silence",
+        type=int,
+        default=DEFAULT_SILENCE_THRESHOLD,
+        help="largest sample trimmed as silence (default %(default)s)",
+    )
+    parser.add_argument(
+        "--out-dir",
+        type=pathlib.Path,
+        default=pathlib.Path("."),
+        help="where to write soundPack.c/.h (default .)",
+    )
+    args = parser.parse_args()
+
+    data = bytearray()
+    offsets = {}  # Encoded sound -> its offset in data.
+    index = []
+    for name, path, rate in read_manifest(args.manifest):
+        samples, from_rate = read_source(path, rate)
+        samples = trim(resample(wav2adpcm.unwrap(samples), from_rate, args.rate), args.silence)
+        if not samples:
+            sys.exit("{}: {} is silent".format(args.manifest, path.name))
+        encoded = wav2adpcm.encode(samples)
+        note = path.name
+        if encoded in offsets:
+            note += ", shared"
+        else:
+            offsets[encoded] = len(data)
+            data += encoded
+        index.append((name, offsets[encoded], len(samples), note))
+        print("{}: {} samples ({})".format(name, len(samples), note))
+    args.out_dir.mkdir(parents=True, exist_ok=True)
+    statement = "packSounds.py {} --rate {}".format(args.manifest.name, args.rate)
+    write_pack(args.out_dir, data, index, args.rate, statement)
+    print("soundPack.c: {} sounds, {} bytes".format(len(index), len(data)))
+
+
+if __name__ == "__main__":
+    main()
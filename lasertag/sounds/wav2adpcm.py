@@ -0,0 +1,189 @@
+#!/usr/bin/python3
+
+"""Writes sounds as IMA-ADPCM arrays for lasertag/adpcm.h, a quarter of the
+size of the 16-bit arrays that wav2c writes.
+
+Each input is a .wav file (8 or 16-bit PCM, stereo is mixed down to mono) or
+a .wav.c file written by wav2c. For NAME.wav or NAME.wav.c this writes
+NAME.adpcm.c, holding the array NAME_adpcm, and NAME.adpcm.h next to it, or
+into --out-dir.
+Samples that wrapped around (a jump of more than half the range, as in
+ouch48k.wav.c where the waveform overshot full scale) are clamped to full
+scale first: ADPCM can't follow the jump and they were clicks anyway. The
+encoder matches adpcm_encode() bit for bit; adpcm_runTest() checks that
+against ouch48k.adpcm.c. The sounds sound.c plays are packed into one array
+by packSounds.py, which encodes with this module.
+"""
+
+import argparse
+import pathlib
+import re
+import sys
+import wave
+
+BLOCK_SIZE = 256
+BLOCK_HEADER_SIZE = 4
+SAMPLES_PER_BLOCK = 2 * (BLOCK_SIZE - BLOCK_HEADER_SIZE) + 1
+BYTES_PER_LINE = 16
+
+# wav2c arrays are offset-binary and don't hold their rate, so the rate of a
+# .wav.c input is given on the command line.
+WAV2C_MIDSCALE = 0x8000
+DEFAULT_SAMPLE_RATE = 48000
+
+STEP_TABLE = [
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41,
+    45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209,
+    230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876,
+    963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749,
+    3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630,
+    9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385,
+    24623, 27086, 29794, 32767,
+]
+INDEX_TABLE = [-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8]
+
+
+def decode_nibble(predictor, step_index, nibble):
+    """Returns the predictor and step index after one 4-bit code."""
+    step = STEP_TABLE[step_index]
+    diff = step >> 3
+    if nibble & 0x4:
+        diff += step
+    if nibble & 0x2:
+        diff += step >> 1
+    if nibble & 0x1:
+        diff += step >> 2
+    predictor = predictor - diff if nibble & 0x8 else predictor + diff
+    predictor = max(-32768, min(32767, predictor))
+    step_index = max(0, min(len(STEP_TABLE) - 1, step_index + INDEX_TABLE[nibble]))
+    return predictor, step_index
+
+
+def encode(samples):
+    """Encodes signed 16-bit samples into blocks, like adpcm_encode()."""
+    out = bytearray()
+    step_index = 0
+    for start in range(0, len(samples), SAMPLES_PER_BLOCK):
+        block = bytearray(BLOCK_SIZE)
+        predictor = samples[start]
+        block[0] = predictor & 0xFF
+        block[1] = (predictor >> 8) & 0xFF
+        block[2] = step_index
+        for i in range(1, min(SAMPLES_PER_BLOCK, len(samples) - start)):
+            step = STEP_TABLE[step_index]
+            diff = samples[start + i] - predictor
+            nibble = 0
+            if diff < 0:
+                nibble = 0x8
+                diff = -diff
+            if diff >= step:
+                nibble |= 0x4
+                diff -= step
+            if diff >= step >> 1:
+                nibble |= 0x2
+                diff -= step >> 1
+            if diff >= step >> 2:
+                nibble |= 0x1
+            predictor, step_index = decode_nibble(predictor, step_index, nibble)
+            code = BLOCK_HEADER_SIZE + ((i - 1) >> 1)
+            block[code] |= nibble << 4 if (i - 1) & 1 else nibble
+        out += block
+    return bytes(out)
+
+
+def unwrap(samples):
+    """Clamps samples that wrapped around to full scale, on the side they came from."""
+    out = list(samples)
+    for i in range(1, len(out)):
+        if abs(out[i] - out[i - 1]) > 32767:
+            out[i] = 32767 if out[i - 1] > 0 else -32768
+    return out
+
+
+def read_wav(path):
+    """Returns the samples of a .wav file as signed 16-bit mono, and its rate."""
+    with wave.open(str(path), "rb") as w:
+        width = w.getsampwidth()
+        channels = w.getnchannels()
+        frames = w.readframes(w.getnframes())
+        rate = w.getframerate()
+    if width == 1:
+        values = [(b - 128) << 8 for b in frames]
+    elif width == 2:
+        values = [
+            int.from_bytes(frames[i : i + 2], "little", signed=True)
+            for i in range(0, len(frames), 2)
+        ]
+    else:
+        sys.exit("{}: only 8 and 16-bit samples are supported".format(path))
+    samples = [
+        sum(values[i : i + channels]) // channels for i in range(0, len(values), channels)
+    ]
+    return samples, rate
+
+
+def read_wav2c(path):
+    """Returns the samples of a wav2c .wav.c file as signed 16-bit values."""
+    text = path.read_text()
+    body = text[text.index("{") + 1 : text.rindex("}")]
+    return [int(v) - WAV2C_MIDSCALE for v in re.findall(r"-?\d+", body)]
+
+
+def write_sound(path, out_dir, samples, rate, statement):
+    """Writes NAME.adpcm.c and NAME.adpcm.h for the input file path into out_dir."""
+    base = path.name[: -len(".wav.c")] if path.name.endswith(".wav.c") else path.stem
+    name = re.sub(r"\W", "_", base) + "_adpcm"
+    data = encode(samples)
+    lines = [
+        ",".join("0x{:02x}".format(b) for b in data[i : i + BYTES_PER_LINE])
+        for i in range(0, len(data), BYTES_PER_LINE)
+    ]
+    comment = "// This file was generated by executing this statement: {}\n".format(statement)
+    c_file = out_dir / (base + ".adpcm.c")
+    c_file.write_text(
+        comment
+        + "\n#include <stdint.h>\n\n"
+        + "const uint8_t {}[{}] = {{\n".format(name, len(data))
+        + ",\n".join(lines)
+        + "\n};\n"
+    )
+    macro = name.upper()
+    (out_dir / (base + ".adpcm.h")).write_text(
+        comment
+        + "#include <stdint.h>\n"
+        + "extern const uint8_t {}[];\n".format(name)
+        + "#define {}_SAMPLE_RATE {}\n".format(macro, rate)
+        + "#define {}_NUMBER_OF_SAMPLES {}\n".format(macro, len(samples))
+        + "#define {}_SIZE {}\n".format(macro, len(data))
+    )
+    print("{}: {} samples, {} bytes".format(c_file.name, len(samples), len(data)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("files", nargs="+", type=pathlib.Path, help=".wav or .wav.c files")
+    parser.add_argument(
+        "--rate",
+        type=int,
+        default=DEFAULT_SAMPLE_RATE,
+        help="sample rate of .wav.c inputs (default %(default)s)",
+    )
+    parser.add_argument(
+        "--out-dir",
+        type=pathlib.Path,
+        help="where to write the arrays (default next to each input)",
+    )
+    args = parser.parse_args()
+
+    for path in args.files:
+        if path.name.endswith(".wav.c"):
+            samples, rate = read_wav2c(path), args.rate
+        else:
+            samples, rate = read_wav(path)
+        out_dir = args.out_dir or path.parent
+        out_dir.mkdir(parents=True, exist_ok=True)
+        write_sound(path, out_dir, unwrap(samples), rate, "wav2adpcm.py " + path.name)
+
+
+if __name__ == "__main__":
+    main()
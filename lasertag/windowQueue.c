@@ -0,0 +1,63 @@
+#include "windowQueue.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INIT_VAL 0
+#define INIT_VAL_DOUBLE 0.0
+#define MIRROR_COUNT 2 // Each value is stored twice, see windowQueue.h.
+
+// Allocates the data array and fills the window with zeros.
+void windowQueue_init(windowQueue_t *q, queue_size_t size, const char *name) {
+  q->size = size;
+  q->data = malloc(MIRROR_COUNT * size * sizeof(queue_data_t));
+  if (q->data == NULL) {
+    printf("windowQueue_init(): malloc failed for window %s.\n", name);
+    assert(false);
+  }
+  strncpy(q->name, name, QUEUE_MAX_NAME_SIZE - 1);
+  q->name[QUEUE_MAX_NAME_SIZE - 1] = '\0';
+  windowQueue_fill(q, INIT_VAL_DOUBLE);
+}
+
+// Get the user-assigned name for the window.
+const char *windowQueue_name(windowQueue_t *q) { return q->name; }
+
+// Returns the number of values in the window.
+queue_size_t windowQueue_size(windowQueue_t *q) { return q->size; }
+
+// Overwrites every value in the window (both copies) with fillValue.
+void windowQueue_fill(windowQueue_t *q, queue_data_t fillValue) {
+  for (queue_index_t i = INIT_VAL; i < MIRROR_COUNT * q->size; i++) {
+    q->data[i] = fillValue;
+  }
+  q->index = INIT_VAL;
+}
+
+// Index 0 is the oldest value, size - 1 the newest.
+queue_data_t windowQueue_readElementAt(windowQueue_t *q, queue_index_t index) {
+  if (index >= q->size) {
+    printf("windowQueue_readElementAt(): index %u is out of range for window "
+           "%s of size %u.\n",
+           index, q->name, q->size);
+    return QUEUE_RETURN_ERROR_VALUE;
+  }
+  return q->data[q->index + index];
+}
+
+// Frees the storage that windowQueue_init() malloc'd.
+void windowQueue_garbageCollect(windowQueue_t *q) {
+  free(q->data);
+  q->data = NULL;
+}
+
+// Prints the contents of the window, oldest value first.
+void windowQueue_print(windowQueue_t *q) {
+  const queue_data_t *window = windowQueue_window(q, q->size);
+  printf("window %s:", q->name);
+  for (queue_index_t i = INIT_VAL; i < q->size; i++) {
+    printf(" %lf", window[i]);
+  }
+  printf("\n");
+}
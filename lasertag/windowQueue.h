@@ -0,0 +1,145 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef WINDOWQUEUE_H_
+#define WINDOWQUEUE_H_
+
+#include "queue.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// A fixed-size history of the last size values, for filters that read a
+// sliding window of their inputs. Unlike queue_t it is always full (it starts
+// out filled with zeros) and every push overwrites the oldest value.
+// Each value is stored twice, at index and index + size, so the last size
+// values are always contiguous in memory starting at &data[index] (oldest
+// first). windowQueue_window() returns a pointer to them that can be indexed
+// directly, with no modulo per element.
+typedef struct {
+  // Next slot to write, which also holds the oldest value.
+  queue_index_t index;
+  // Number of values in the window. The data array is twice this size.
+  queue_size_t size;
+  // Points to a dynamically-allocated array of 2 * size values.
+  queue_data_t *data;
+  // Name for debugging purposes.
+  char name[QUEUE_MAX_NAME_SIZE];
+} windowQueue_t;
+
+// Allocates the data array and fills the window with zeros. Prints out an
+// error message if malloc() fails and calls assert(false) to die.
+void windowQueue_init(windowQueue_t *q, queue_size_t size, const char *name);
+
+// Get the user-assigned name for the window.
+const char *windowQueue_name(windowQueue_t *q);
+
+// Returns the number of values in the window.
+queue_size_t windowQueue_size(windowQueue_t *q);
+
+// Overwrites every value in the window with fillValue.
+void windowQueue_fill(windowQueue_t *q, queue_data_t fillValue);
+
+// The mirrored ring itself, shared by windowQueue_t and the windows that
+// WINDOW_QUEUE_DEFINE() generates. WINDOW_QUEUE_MIRROR_PUSH() writes both
+// copies of value and advances index, wrapping it at size without a modulo.
+// WINDOW_QUEUE_MIRROR_WINDOW() is the address of the last count values.
+#define WINDOW_QUEUE_MIRROR_PUSH(data, index, size, value)                     \
+  do {                                                                         \
+    (data)[(index)] = (value);                                                 \
+    (data)[(index) + (size)] = (value);                                        \
+    if (++(index) >= (size))                                                   \
+      (index) = 0;                                                             \
+  } while (0)
+#define WINDOW_QUEUE_MIRROR_WINDOW(data, index, size, count)                   \
+  (&(data)[(index) + (size) - (count)])
+
+// Adds value as the newest element and returns the oldest one, which has just
+// left the window. Inline so per-sample pushes don't cost a call.
+static inline queue_data_t windowQueue_push(windowQueue_t *q,
+                                            queue_data_t value) {
+  queue_data_t oldest = q->data[q->index];
+  WINDOW_QUEUE_MIRROR_PUSH(q->data, q->index, q->size, value);
+  return oldest;
+}
+
+// Returns the last count (at most size) values as a contiguous array, oldest
+// first: [0] is the value pushed count pushes ago and [count - 1] is the
+// newest. The pointer is valid until the next push or fill.
+static inline const queue_data_t *windowQueue_window(windowQueue_t *q,
+                                                     queue_size_t count) {
+  return WINDOW_QUEUE_MIRROR_WINDOW(q->data, q->index, q->size, count);
+}
+
+// Same indexing as queue_readElementAt() on a full queue: index 0 is the
+// oldest value and size - 1 the newest. Prints an error message and returns
+// QUEUE_RETURN_ERROR_VALUE if index is out of range.
+queue_data_t windowQueue_readElementAt(windowQueue_t *q, queue_index_t index);
+
+// Frees the storage that windowQueue_init() malloc'd.
+void windowQueue_garbageCollect(windowQueue_t *q);
+
+// Prints the contents of the window, oldest value first.
+void windowQueue_print(windowQueue_t *q);
+
+// WINDOW_QUEUE_DEFINE() below also compiles as C++.
+#ifdef __cplusplus
+#define WINDOW_QUEUE_STATIC_ASSERT static_assert
+#else
+#define WINDOW_QUEUE_STATIC_ASSERT _Static_assert
+#endif
+
+// Same window as windowQueue_t for any element type (float and Q15 inputs in
+// filterFloat.c and filterFixed.c), with its size fixed at compile time and
+// its storage in the struct, so there is no malloc(), no name and every
+// operation is static inline, like FIXED_QUEUE_DEFINE() in fixedQueue.h.
+//
+// WINDOW_QUEUE_DEFINE(prefix, elementType, windowSize); declares the type
+// prefix_t and the functions prefix_fill(), prefix_push() and
+// prefix_window(), which behave like their windowQueue_ counterparts. A
+// prefix_t is not usable until prefix_fill() has been called. For example:
+//   WINDOW_QUEUE_DEFINE(inputWindow, float, 81);
+//   static inputWindow_t w;
+//   inputWindow_fill(&w, 0.0f);
+//   inputWindow_push(&w, 1.0f);
+//   const float *x = inputWindow_window(&w, 81); // oldest first
+#define WINDOW_QUEUE_DEFINE(prefix, elementType, windowSize)                   \
+  typedef struct {                                                             \
+    uint32_t index; /* Next slot to write, also the oldest value. */           \
+    elementType data[2 * (windowSize)]; /* Each value is stored twice. */      \
+  } prefix##_t;                                                                \
+                                                                               \
+  /* Overwrites every value in the window with fillValue. */                   \
+  static inline void prefix##_fill(prefix##_t *q, elementType fillValue) {     \
+    for (uint32_t i = 0; i < 2 * (windowSize); i++)                            \
+      q->data[i] = fillValue;                                                  \
+    q->index = 0;                                                              \
+  }                                                                            \
+                                                                               \
+  /* Adds value as the newest element and returns the oldest one. */           \
+  static inline elementType prefix##_push(prefix##_t *q, elementType value) {  \
+    elementType oldest = q->data[q->index];                                    \
+    WINDOW_QUEUE_MIRROR_PUSH(q->data, q->index, (windowSize), value);          \
+    return oldest;                                                             \
+  }                                                                            \
+                                                                               \
+  /* Returns the last count values as a contiguous array, oldest first. */     \
+  static inline const elementType *prefix##_window(const prefix##_t *q,        \
+                                                   uint32_t count) {           \
+    return WINDOW_QUEUE_MIRROR_WINDOW(q->data, q->index, (windowSize), count); \
+  }                                                                            \
+                                                                               \
+  WINDOW_QUEUE_STATIC_ASSERT((windowSize) > 0,                                 \
+                             #prefix " window size must be positive")
+
+// Checks windowQueue_t against queue_t with random pushes and window reads.
+// Returns true if the test passes. Prints informational messages if
+// printMessageFlag is true.
+bool windowQueue_runTest(bool printMessageFlag);
+
+#endif /* WINDOWQUEUE_H_ */
@@ -0,0 +1,345 @@
+#include "host.h"
+#include "pl330.h"
+#include "sound.h" // I2S register offsets.
+#include "xil_io.h"
+#include "xparameters.h"
+#include <stddef.h>
+
+// Register model of the audio output path for the host build: the I2S
+// controller's TX FIFO and channel 0 of the secure PL330 DMA controller, which
+// runs its program from host memory. Xil_In32() and Xil_Out32() go here. Time
+// only passes in host_runAudio(), one stereo frame at a time.
+
+#define INIT_VAL 0
+#define AUDIO_CTRL_BASEADDR XPAR_AXI_I2S_ADI_1_S_AXI_BASEADDR
+#define DMA_BASEADDR XPAR_XDMAPS_1_BASEADDR
+#define I2S_TX_FIFO_DEPTH 32 // words
+#define I2S_TX_FIFO_RESET 0b010
+#define I2S_TX_ENABLE 0b001
+#define I2S_FIFO_STS_TX_FULL 0b010
+#define I2S_DMA_PERIPHERAL 0 // DMA0_REQ
+#define CHANNELS_PER_FRAME 2
+#define CAPTURE_SIZE 8192 // words kept for host_readAudio()
+#define REGION_COUNT 4
+#define REGION_BASE 0x00100000 // first stand-in address
+#define REGION_ALIGN 0x1000
+#define MFIFO_SIZE 16        // words the channel can hold between LD and ST
+#define STEPS_PER_FRAME 1000 // instructions the channel may run each frame
+#define WORD_SIZE_LOG2 2     // the only beat size modelled
+#define MOV_SIZE 6
+#define TWO_BYTE_SIZE 2
+
+typedef struct {
+  const void *p;
+  uint32_t bytes;
+  uint32_t address;
+} audioModel_region_t;
+
+// TX FIFO and what the I2S controller has sent out of it.
+static uint32_t txFifo[I2S_TX_FIFO_DEPTH];
+static uint32_t txFifoCount;
+static uint32_t txFifoOut; // Index of the oldest word.
+static uint32_t i2sCtrl;
+static uint32_t capture[CAPTURE_SIZE];
+static uint32_t captureCount;
+static uint32_t underrunCount;
+
+// DMA controller, channel 0 only.
+static audioModel_region_t regions[REGION_COUNT];
+static uint32_t regionCount;
+static uint32_t dbgInst0, dbgInst1;
+static uint32_t intEnable, intRaw;
+static uint32_t channelStatus;
+static uint32_t pc, sar, dar, ccr;
+static uint32_t loopCounter[2];
+static bool burstRequest; // Request type of the last DMAWFP.
+static uint32_t mfifo[MFIFO_SIZE];
+static uint32_t mfifoCount;
+
+// Returns a 32-bit address for the DMA program to reach bytes at p.
+uint32_t host_getDmaAddress(const void *p, uint32_t bytes) {
+  uint32_t address = REGION_BASE;
+  for (uint32_t i = INIT_VAL; i < regionCount; i++) {
+    if (regions[i].p == p && regions[i].bytes >= bytes)
+      return regions[i].address;
+    address = (regions[i].address + regions[i].bytes + REGION_ALIGN - 1) &
+              ~(REGION_ALIGN - 1);
+  }
+  if (regionCount == REGION_COUNT)
+    return INIT_VAL; // faults if the DMA uses it
+  regions[regionCount++] = (audioModel_region_t){p, bytes, address};
+  return address;
+}
+
+// Returns the host memory behind bytes at a DMA address, or NULL.
+static uint8_t *resolve(uint32_t address, uint32_t bytes) {
+  for (uint32_t i = INIT_VAL; i < regionCount; i++) {
+    audioModel_region_t *r = &regions[i];
+    if (address >= r->address && address - r->address + bytes <= r->bytes)
+      return (uint8_t *)r->p + (address - r->address);
+  }
+  return NULL;
+}
+
+// Stops and clears everything but the DMA address map.
+void host_resetAudio() {
+  txFifoCount = txFifoOut = i2sCtrl = INIT_VAL;
+  captureCount = underrunCount = INIT_VAL;
+  intEnable = intRaw = INIT_VAL;
+  channelStatus = PL330_CS_STOPPED;
+  mfifoCount = INIT_VAL;
+}
+
+// Adds word to the TX FIFO. Dropped if the FIFO is full, like the hardware.
+static void pushTxFifo(uint32_t word) {
+  if (txFifoCount == I2S_TX_FIFO_DEPTH)
+    return;
+  txFifo[(txFifoOut + txFifoCount++) % I2S_TX_FIFO_DEPTH] = word;
+}
+
+// Stops the channel because of a bad instruction or access.
+static void fault() { channelStatus = PL330_CS_FAULTING; }
+
+// The I2S controller asks for a burst while the FIFO has room for one.
+static bool peripheralRequesting(uint8_t peripheral, bool burst) {
+  uint32_t words = burst ? PL330_CCR_GET_DST_BURST_LEN(ccr) + 1 : 1;
+  return peripheral == I2S_DMA_PERIPHERAL &&
+         I2S_TX_FIFO_DEPTH - txFifoCount >= words;
+}
+
+// DMALD: reads a burst from SAR into the channel's MFIFO.
+static void load() {
+  uint32_t beats = PL330_CCR_GET_SRC_BURST_LEN(ccr) + 1;
+  uint8_t *src = resolve(sar, beats * sizeof(uint32_t));
+  if (PL330_CCR_GET_SRC_SIZE(ccr) != WORD_SIZE_LOG2 || src == NULL ||
+      mfifoCount + beats > MFIFO_SIZE) {
+    fault();
+    return;
+  }
+  for (uint32_t i = INIT_VAL; i < beats; i++) {
+    mfifo[mfifoCount++] = ((uint32_t *)src)[(ccr & PL330_CCR_SRC_INC) ? i : 0];
+  }
+  if (ccr & PL330_CCR_SRC_INC)
+    sar += beats * sizeof(uint32_t);
+}
+
+// DMAST: writes a burst from the MFIFO to DAR, which has to be the TX FIFO.
+static void store() {
+  uint32_t beats = PL330_CCR_GET_DST_BURST_LEN(ccr) + 1;
+  if (PL330_CCR_GET_DST_SIZE(ccr) != WORD_SIZE_LOG2 || mfifoCount < beats ||
+      (ccr & PL330_CCR_DST_INC) ||
+      dar != AUDIO_CTRL_BASEADDR + I2S_TX_FIFO_REG) {
+    fault();
+    return;
+  }
+  for (uint32_t i = INIT_VAL; i < beats; i++) {
+    pushTxFifo(mfifo[i]);
+  }
+  mfifoCount -= beats;
+  for (uint32_t i = INIT_VAL; i < mfifoCount; i++) {
+    mfifo[i] = mfifo[i + beats];
+  }
+}
+
+// Returns false if a conditional (single/burst) instruction doesn't run.
+static bool conditionHolds(uint8_t op) {
+  switch (op & PL330_COND_BURST) {
+  case PL330_COND_SINGLE:
+    return !burstRequest;
+  case PL330_COND_BURST:
+    return burstRequest;
+  default:
+    return true;
+  }
+}
+
+// Runs the instruction at pc. Returns false if the channel has stopped or
+// is waiting for the peripheral.
+static bool step() {
+  uint8_t *code = resolve(pc, 1);
+  if (code == NULL) {
+    fault();
+    return false;
+  }
+  uint8_t op = code[0];
+  uint32_t size = op == PL330_DMAMOV ? MOV_SIZE : TWO_BYTE_SIZE;
+  if (op == PL330_DMAEND || (op & ~PL330_COND_BURST) == PL330_DMALD ||
+      (op & ~PL330_COND_BURST) == PL330_DMAST)
+    size = 1;
+  if ((code = resolve(pc, size)) == NULL) {
+    fault();
+    return false;
+  }
+  if (op == PL330_DMAEND) {
+    channelStatus = PL330_CS_STOPPED;
+    return false;
+  } else if (op == PL330_DMAMOV) {
+    uint32_t value = code[2] | code[3] << 8 | code[4] << 16 |
+                     (uint32_t)code[5] << 24;
+    if (code[1] == PL330_MOV_SAR)
+      sar = value;
+    else if (code[1] == PL330_MOV_CCR)
+      ccr = value;
+    else if (code[1] == PL330_MOV_DAR)
+      dar = value;
+    else
+      fault();
+  } else if ((op & ~PL330_LP_LC1) == PL330_DMALP) {
+    loopCounter[(op & PL330_LP_LC1) ? 1 : 0] = code[1];
+  } else if ((op & ~PL330_COND_BURST) == PL330_DMALD) {
+    if (conditionHolds(op))
+      load();
+  } else if ((op & ~PL330_COND_BURST) == PL330_DMAST) {
+    if (conditionHolds(op))
+      store();
+  } else if (op == PL330_DMASTP || op == (PL330_DMASTP | PL330_COND_BURST)) {
+    if (conditionHolds(op))
+      store();
+  } else if ((op & ~(PL330_LPEND_NOT_FOREVER | PL330_LPEND_LC1 |
+                     PL330_COND_BURST)) == PL330_DMALPEND) {
+    uint32_t *lc = &loopCounter[(op & PL330_LPEND_LC1) ? 1 : 0];
+    bool forever = !(op & PL330_LPEND_NOT_FOREVER);
+    if (conditionHolds(op) && (forever || *lc != INIT_VAL)) {
+      if (!forever)
+        (*lc)--;
+      pc -= code[1];
+      return true;
+    }
+  } else if ((op & ~(PL330_WFP_BURST | PL330_WFP_PERIPHERAL)) == PL330_DMAWFP) {
+    bool burst = op & (PL330_WFP_BURST | PL330_WFP_PERIPHERAL);
+    if (!peripheralRequesting(code[1] >> 3, burst)) {
+      channelStatus = PL330_CS_WAITING_FOR_PERIPHERAL;
+      return false;
+    }
+    channelStatus = PL330_CS_EXECUTING;
+    burstRequest = burst;
+  } else if (op == PL330_DMASEV) {
+    intRaw |= (1 << (code[1] >> 3)) & intEnable;
+  } else if (op == PL330_DMAFLUSHP) {
+    // no requests are held, so nothing to flush
+  } else {
+    fault();
+  }
+  if (channelStatus == PL330_CS_FAULTING)
+    return false;
+  pc += size;
+  return true;
+}
+
+// Runs the channel until it waits, stops or has used up its steps.
+static void runChannel() {
+  if (channelStatus != PL330_CS_EXECUTING &&
+      channelStatus != PL330_CS_WAITING_FOR_PERIPHERAL)
+    return;
+  for (uint32_t i = INIT_VAL; i < STEPS_PER_FRAME && step(); i++)
+    ;
+}
+
+// Runs the instruction written to DBGINST0 and DBGINST1: DMAGO from the
+// manager thread or DMAKILL for channel 0.
+static void runDebugInstruction() {
+  uint8_t b0 = (dbgInst0 >> 16) & 0xFF;
+  uint8_t b1 = dbgInst0 >> 24;
+  bool channelThread = dbgInst0 & 0x1;
+  uint32_t channel = channelThread ? (dbgInst0 >> 8) & 0x7 : b1 & 0x7;
+  if (channel != INIT_VAL)
+    return;
+  if (!channelThread && (b0 & ~0x2) == PL330_DMAGO) {
+    pc = dbgInst1;
+    mfifoCount = INIT_VAL;
+    loopCounter[0] = loopCounter[1] = INIT_VAL;
+    channelStatus = PL330_CS_EXECUTING;
+  } else if (channelThread && b0 == PL330_DMAKILL) {
+    channelStatus = PL330_CS_STOPPED;
+  }
+}
+
+// Plays frames stereo frames: the DMA fills the FIFO, then the I2S
+// controller sends one left and one right word from it.
+void host_runAudio(uint32_t frames) {
+  for (uint32_t f = INIT_VAL; f < frames; f++) {
+    runChannel();
+    if (!(i2sCtrl & I2S_TX_ENABLE))
+      continue;
+    if (txFifoCount < CHANNELS_PER_FRAME) {
+      underrunCount++;
+      continue;
+    }
+    for (uint32_t c = INIT_VAL; c < CHANNELS_PER_FRAME; c++) {
+      if (captureCount < CAPTURE_SIZE)
+        capture[captureCount++] = txFifo[txFifoOut];
+      txFifoOut = (txFifoOut + 1) % I2S_TX_FIFO_DEPTH;
+      txFifoCount--;
+    }
+  }
+}
+
+// Moves up to maxCount of the words sent so far into words[].
+uint32_t host_readAudio(uint32_t words[], uint32_t maxCount) {
+  uint32_t count = captureCount < maxCount ? captureCount : maxCount;
+  for (uint32_t i = INIT_VAL; i < captureCount; i++) {
+    if (i < count)
+      words[i] = capture[i];
+    else
+      capture[i - count] = capture[i];
+  }
+  captureCount -= count;
+  return count;
+}
+
+// Returns the frames the I2S controller found the TX FIFO empty.
+uint32_t host_getAudioUnderrunCount() { return underrunCount; }
+
+/********************************** xil_io.h *******************************/
+
+uint32_t Xil_In32(uint32_t Addr) {
+  switch (Addr) {
+  case AUDIO_CTRL_BASEADDR + I2S_CTRL_REG:
+    return i2sCtrl;
+  case AUDIO_CTRL_BASEADDR + I2S_FIFO_STS_REG:
+    return txFifoCount == I2S_TX_FIFO_DEPTH ? I2S_FIFO_STS_TX_FULL : INIT_VAL;
+  case DMA_BASEADDR + PL330_INTEN_OFFSET:
+    return intEnable;
+  case DMA_BASEADDR + PL330_INTSTATUS_OFFSET:
+    return intRaw & intEnable;
+  case DMA_BASEADDR + PL330_FSC_OFFSET:
+    return channelStatus == PL330_CS_FAULTING;
+  case DMA_BASEADDR + PL330_CS0_OFFSET:
+    return channelStatus;
+  case DMA_BASEADDR + PL330_CPC0_OFFSET:
+    return pc;
+  default:
+    return INIT_VAL; // includes DBGSTATUS, never busy
+  }
+}
+
+void Xil_Out32(uint32_t Addr, uint32_t Value) {
+  switch (Addr) {
+  case AUDIO_CTRL_BASEADDR + I2S_RESET_REG:
+    if (Value & I2S_TX_FIFO_RESET)
+      txFifoCount = txFifoOut = INIT_VAL;
+    break;
+  case AUDIO_CTRL_BASEADDR + I2S_CTRL_REG:
+    i2sCtrl = Value;
+    break;
+  case AUDIO_CTRL_BASEADDR + I2S_TX_FIFO_REG:
+    pushTxFifo(Value);
+    break;
+  case DMA_BASEADDR + PL330_INTEN_OFFSET:
+    intEnable = Value;
+    break;
+  case DMA_BASEADDR + PL330_INTCLR_OFFSET:
+    intRaw &= ~Value;
+    break;
+  case DMA_BASEADDR + PL330_DBGINST0_OFFSET:
+    dbgInst0 = Value;
+    break;
+  case DMA_BASEADDR + PL330_DBGINST1_OFFSET:
+    dbgInst1 = Value;
+    break;
+  case DMA_BASEADDR + PL330_DBGCMD_OFFSET:
+    if (Value == PL330_DBGCMD_EXECUTE)
+      runDebugInstruction();
+    break;
+  }
+}
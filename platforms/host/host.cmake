@@ -0,0 +1,8 @@
+# Host builds are for profiling and regression testing, so optimize unless
+# a build type was asked for.
+if (NOT CMAKE_BUILD_TYPE)
+    set(CMAKE_BUILD_TYPE Release)
+endif()
+
+# add_compile_options("-Wall")
+# add_compile_options("-pg")
@@ -0,0 +1,51 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef HOST_H_
+#define HOST_H_
+
+#include <stdint.h>
+
+// Host-native (e.g. x86 Linux) build of the lasertag signal chain. The board
+// drivers (interrupts, mio, leds, buttons, switches, display) are stubs that
+// do nothing, utils_msDelay() returns immediately and intervalTimer reads the
+// host's monotonic clock. The private timer counter also runs off the host
+// clock and restarts at every host_setAdcData(), so isr_function() timing
+// measures the real host time. Build with "cmake -DHOST=1".
+
+// Sets the value that interrupts_getAdcData() returns and restarts the private
+// timer count, as the timer interrupt would. Call this before each
+// isr_function() to feed samples through the ISR.
+void host_setAdcData(uint32_t adcData);
+
+// Returns the host's monotonic clock in seconds.
+double host_getTimeInSeconds();
+
+// Model of the audio output path (audioModel.c): the I2S controller's TX FIFO
+// and channel 0 of the secure PL330 DMA controller, reached through
+// Xil_In32() and Xil_Out32(). The DMA program runs from host memory, which it
+// reaches through the 32-bit addresses host_getDmaAddress() hands out.
+
+// Returns the address a DMA program uses to reach bytes at p.
+uint32_t host_getDmaAddress(const void *p, uint32_t bytes);
+
+// Stops the DMA channel, empties the TX FIFO and clears what was captured.
+void host_resetAudio();
+
+// Plays frames stereo frames, running the DMA channel as it goes.
+void host_runAudio(uint32_t frames);
+
+// Moves up to maxCount of the words the I2S controller has sent (left, right,
+// left, ...) into words[] and returns how many were moved.
+uint32_t host_readAudio(uint32_t words[], uint32_t maxCount);
+
+// Returns the frames the I2S controller found the TX FIFO empty.
+uint32_t host_getAudioUnderrunCount();
+
+#endif /* HOST_H_ */
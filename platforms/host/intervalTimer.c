@@ -0,0 +1,78 @@
+#include "intervalTimer.h"
+#include "host.h"
+#include <stdbool.h>
+
+// intervalTimer for the host build, backed by the monotonic clock instead of
+// the AXI timers. Same semantics: start/stop accumulate, reset clears.
+
+#define INIT_VAL 0
+#define TIMER_COUNT 3
+
+typedef struct {
+  bool running;
+  double startTime;     // When the timer was last started, in seconds.
+  double totalDuration; // Accumulated over all start/stop pairs, in seconds.
+} intervalTimer_t;
+
+static intervalTimer_t timers[TIMER_COUNT];
+
+intervalTimer_status_t intervalTimer_init(uint32_t timerNumber) {
+  if (timerNumber >= TIMER_COUNT)
+    return INTERVAL_TIMER_STATUS_FAIL;
+  timers[timerNumber] = (intervalTimer_t){INIT_VAL};
+  return INTERVAL_TIMER_STATUS_OK;
+}
+
+intervalTimer_status_t intervalTimer_initAll() {
+  for (uint32_t i = INIT_VAL; i < TIMER_COUNT; i++) {
+    intervalTimer_init(i);
+  }
+  return INTERVAL_TIMER_STATUS_OK;
+}
+
+void intervalTimer_start(uint32_t timerNumber) {
+  if (timerNumber >= TIMER_COUNT || timers[timerNumber].running)
+    return;
+  timers[timerNumber].running = true;
+  timers[timerNumber].startTime = host_getTimeInSeconds();
+}
+
+void intervalTimer_stop(uint32_t timerNumber) {
+  if (timerNumber >= TIMER_COUNT || !timers[timerNumber].running)
+    return;
+  timers[timerNumber].running = false;
+  timers[timerNumber].totalDuration +=
+      host_getTimeInSeconds() - timers[timerNumber].startTime;
+}
+
+void intervalTimer_reset(uint32_t timerNumber) {
+  if (timerNumber >= TIMER_COUNT)
+    return;
+  timers[timerNumber].totalDuration = INIT_VAL;
+  timers[timerNumber].startTime = host_getTimeInSeconds();
+}
+
+void intervalTimer_resetAll() {
+  for (uint32_t i = INIT_VAL; i < TIMER_COUNT; i++) {
+    intervalTimer_reset(i);
+  }
+}
+
+intervalTimer_status_t intervalTimer_test(uint32_t timerNumber) {
+  return timerNumber < TIMER_COUNT ? INTERVAL_TIMER_STATUS_OK
+                                   : INTERVAL_TIMER_STATUS_FAIL;
+}
+
+intervalTimer_status_t intervalTimer_testAll() {
+  return INTERVAL_TIMER_STATUS_OK;
+}
+
+// Includes the time since the last start if the timer is still running.
+double intervalTimer_getTotalDurationInSeconds(uint32_t timerNumber) {
+  if (timerNumber >= TIMER_COUNT)
+    return INIT_VAL;
+  double total = timers[timerNumber].totalDuration;
+  if (timers[timerNumber].running)
+    total += host_getTimeInSeconds() - timers[timerNumber].startTime;
+  return total;
+}
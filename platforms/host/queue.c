@@ -0,0 +1,120 @@
+#include "queue.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// queue for the host build. The board and emulator builds link the
+// precompiled libqueue instead.
+
+#define INIT_VAL 0
+#define EXTRA_SLOT 1 // One array slot is kept empty, see queue.h.
+
+// Allocates memory for the queue (the data* pointer) and initializes all
+// parts of the data structure. Prints out an error message if malloc() fails
+// and exits.
+// The queue is empty after initialization.
+void queue_init(queue_t *q, queue_size_t size, const char *name) {
+  q->indexIn = INIT_VAL;
+  q->indexOut = INIT_VAL;
+  q->elementCount = INIT_VAL;
+  q->size = size + EXTRA_SLOT;
+  q->underflowFlag = false;
+  q->overflowFlag = false;
+  q->data = malloc(q->size * sizeof(queue_data_t));
+  if (q->data == NULL) {
+    printf("queue_init(): malloc failed for queue %s.\n", name);
+    exit(EXIT_FAILURE);
+  }
+  strncpy(q->name, name, QUEUE_MAX_NAME_SIZE - 1);
+  q->name[QUEUE_MAX_NAME_SIZE - 1] = '\0';
+}
+
+// Get the user-assigned name for the queue.
+const char *queue_name(queue_t *q) { return q->name; }
+
+// Returns the capacity of the queue.
+queue_size_t queue_size(queue_t *q) { return q->size - EXTRA_SLOT; }
+
+// Returns true if the queue is full.
+bool queue_full(queue_t *q) { return q->elementCount == queue_size(q); }
+
+// Returns true if the queue is empty.
+bool queue_empty(queue_t *q) { return q->elementCount == INIT_VAL; }
+
+// If the queue is not full, pushes a new element into the queue and clears
+// the underflowFlag. IF the queue is full, set the overflowFlag, print an
+// error message and DO NOT change the queue.
+void queue_push(queue_t *q, queue_data_t value) {
+  if (queue_full(q)) {
+    q->overflowFlag = true;
+    printf("queue_push(): queue %s is full.\n", q->name);
+    return;
+  }
+  q->data[q->indexIn] = value;
+  q->indexIn = (q->indexIn + 1) % q->size;
+  q->elementCount++;
+  q->underflowFlag = false;
+}
+
+// If the queue is not empty, remove and return the oldest element in the
+// queue. If the queue is empty, set the underflowFlag, print an error message,
+// and DO NOT change the queue.
+queue_data_t queue_pop(queue_t *q) {
+  if (queue_empty(q)) {
+    q->underflowFlag = true;
+    printf("queue_pop(): queue %s is empty.\n", q->name);
+    return QUEUE_RETURN_ERROR_VALUE;
+  }
+  queue_data_t value = q->data[q->indexOut];
+  q->indexOut = (q->indexOut + 1) % q->size;
+  q->elementCount--;
+  q->overflowFlag = false;
+  return value;
+}
+
+// If the queue is full, call queue_pop() and then call queue_push().
+// If the queue is not full, just call queue_push().
+void queue_overwritePush(queue_t *q, queue_data_t value) {
+  if (queue_full(q))
+    queue_pop(q);
+  queue_push(q, value);
+}
+
+// Provides random-access read capability to the queue.
+// Low-valued indexes access older queue elements while higher-value indexes
+// access newer elements (according to the order that they were added). Print
+// a meaningful error message if an error condition is detected.
+queue_data_t queue_readElementAt(queue_t *q, queue_index_t index) {
+  if (index >= q->elementCount) {
+    printf("queue_readElementAt(): index %u is out of range for queue %s.\n",
+           index, q->name);
+    return QUEUE_RETURN_ERROR_VALUE;
+  }
+  return q->data[(q->indexOut + index) % q->size];
+}
+
+// Returns a count of the elements currently contained in the queue.
+queue_size_t queue_elementCount(queue_t *q) { return q->elementCount; }
+
+// Returns true if an underflow has occurred (queue_pop() called on an empty
+// queue).
+bool queue_underflow(queue_t *q) { return q->underflowFlag; }
+
+// Returns true if an overflow has occurred (queue_push() called on a full
+// queue).
+bool queue_overflow(queue_t *q) { return q->overflowFlag; }
+
+// Frees the storage that you malloc'd before.
+void queue_garbageCollect(queue_t *q) {
+  free(q->data);
+  q->data = NULL;
+}
+
+// Prints the current contents of the queue. Handles formatting and wrapping.
+void queue_print(queue_t *q) {
+  printf("%s:", q->name);
+  for (queue_index_t i = INIT_VAL; i < q->elementCount; i++) {
+    printf(" %lf", queue_readElementAt(q, i));
+  }
+  printf("\n");
+}
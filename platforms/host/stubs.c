@@ -0,0 +1,119 @@
+#include "buttons.h"
+#include "display.h"
+#include "host.h"
+#include "interrupts.h"
+#include "leds.h"
+#include "mio.h"
+#include "switches.h"
+#include "utils.h"
+#include <time.h>
+
+// Hardware stubs for the host build. Everything reads as idle: no buttons
+// pressed, all switches off, the display is never drawn.
+
+#define INIT_VAL 0
+#define STATUS_OK 0
+#define DISPLAY_WIDTH 320
+#define DISPLAY_HEIGHT 240
+#define NANOSECONDS_PER_SECOND 1000000000ULL
+#define PRIVATE_TIMER_TICKS_PER_SECOND 333333333 // half the Zybo CPU clock
+#define TIMER_INTERRUPTS_PER_SECOND 100000
+
+static uint32_t adcData;
+static uint64_t interruptTicks; // private timer ticks at the last interrupt
+
+volatile int interrupts_isrFlagGlobal;
+
+// Returns the host's monotonic clock in private timer ticks.
+static uint64_t readPrivateTimerTicks() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * PRIVATE_TIMER_TICKS_PER_SECOND +
+         (uint64_t)now.tv_nsec * PRIVATE_TIMER_TICKS_PER_SECOND /
+             NANOSECONDS_PER_SECOND;
+}
+
+// Sets the value that interrupts_getAdcData() returns. This is where the timer
+// interrupt happens as far as the private timer counter is concerned.
+void host_setAdcData(uint32_t data) {
+  adcData = data;
+  interruptTicks = readPrivateTimerTicks();
+}
+
+// Returns the host's monotonic clock in seconds.
+double host_getTimeInSeconds() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + (double)now.tv_nsec / NANOSECONDS_PER_SECOND;
+}
+
+/********************************** interrupts.h ***************************/
+
+int interrupts_initAll(bool printFailedStatusFlag) { return STATUS_OK; }
+void interrupts_setPrivateTimerLoadValue(u32 loadValue) {}
+u32 interrupts_getPrivateTimerTicksPerSecond() {
+  return PRIVATE_TIMER_TICKS_PER_SECOND;
+}
+
+// Counts down like the private timer, reloading every 10 us of host time
+// since the last host_setAdcData().
+u32 interrupts_getPrivateTimerCounterValue(void) {
+  u32 period = PRIVATE_TIMER_TICKS_PER_SECOND / TIMER_INTERRUPTS_PER_SECOND;
+  return period - 1 - (readPrivateTimerTicks() - interruptTicks) % period;
+}
+int interrupts_enableArmInts() { return STATUS_OK; }
+int interrupts_disableArmInts() { return STATUS_OK; }
+int interrupts_startArmPrivateTimer() { return STATUS_OK; }
+int interrupts_stopArmPrivateTimer() { return STATUS_OK; }
+u32 interrupts_isrInvocationCount() { return INIT_VAL; }
+void interrupts_enableTimerGlobalInts() {}
+void interrupts_disableTimerGlobalInts() {}
+uint32_t interrupts_getAdcData() { return adcData; }
+
+/********************************** mio.h **********************************/
+
+int mio_init(bool printFailedStatusFlag) { return STATUS_OK; }
+u8 mio_readPin(u8 mioPinNumber) { return INIT_VAL; }
+void mio_writePin(u8 mioPinNumber, u8 value) {}
+void mio_WriteBank0(u32 value) {}
+uint16_t mio_readBank0() { return INIT_VAL; }
+void mio_setPinAsInput(u8 mioPinNo) {}
+void mio_setPinAsOutput(u8 mioPinNo) {}
+
+/********************************** leds.h *********************************/
+
+int leds_init(bool printFailedStatusFlag) { return STATUS_OK; }
+void leds_write(int ledValue) {}
+void leds_writeLd4(int ledValue) {}
+int leds_runTest() { return STATUS_OK; }
+
+/************************** buttons.h, switches.h **************************/
+
+int32_t buttons_init() { return BUTTONS_INIT_STATUS_OK; }
+int32_t buttons_read() { return INIT_VAL; }
+void buttons_runTest() {}
+int32_t switches_init() { return SWITCHES_INIT_STATUS_OK; }
+int32_t switches_read() { return INIT_VAL; }
+void switches_runTest() {}
+
+/********************************** utils.h ********************************/
+
+// Returns immediately so that tests run at full host speed.
+void utils_msDelay(long ms) {}
+void utils_sleep() {}
+
+/******************************** display.h ********************************/
+
+void display_init() {}
+void display_drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                      uint16_t color) {}
+void display_fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                      uint16_t color) {}
+void display_fillScreen(uint16_t color) {}
+void display_setCursor(int16_t x, int16_t y) {}
+void display_setTextColor(uint16_t c) {}
+void display_setTextSize(uint8_t s) {}
+void display_setRotation(uint8_t r) {}
+int16_t display_height() { return DISPLAY_HEIGHT; }
+int16_t display_width() { return DISPLAY_WIDTH; }
+size_t display_print(const char str[]) { return INIT_VAL; }